@@ -0,0 +1,152 @@
+/***************************************************************************************************
+BriteTree
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This loads a .brkeg file as a KEGG BRITE hierarchy with an integer ID for every node.
+		 It is shared by 'getKegResults' (gene -> categories) and 'FormatKegResults' (counts).
+		 The levels follow KEGG:
+		 	A - top level (e.g. Metabolism), 'A' lines of the .brkeg
+		 	B - functional category (e.g. Carbohydrate metabolism), 'C' lines of the .brkeg
+		 	C - pathway or BRITE table (e.g. Glycolysis / Gluconeogenesis), 'P' lines of the .brkeg
+		 'G' lines list the genes of the node above them (the pathway, or the category if no pathway
+		 is open). Older .brkeg files that only have 'C' and 'G' lines load as a tree with just the
+		 B level.
+
+		 Categories are written to the 'getKegResults' output as their path from the top of the tree,
+		 the names joined by '>' (e.g. METABOLISM>CARBOHYDRATE METABOLISM>GLYCOLYSIS / GLUCONEOGENESIS)
+****************************************************************************************************/
+#ifndef BRITE_TREE_H
+#define BRITE_TREE_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <algorithm>
+#include <unordered_map>
+#include <ctype.h>
+
+enum briteLevel {BRITE_A = 0, BRITE_B = 1, BRITE_C = 2};
+const int BRITE_LEVELS = 3;
+const int BRITE_ROOT = -1; //parent of the top level nodes
+const char BRITE_PATH_SEPARATOR = '>'; //can't be part of a name, names are written between '<' and '>'
+
+struct briteNode{
+	std::string name; //upper case
+	int level; //briteLevel
+	int parent; //node ID of the level above, BRITE_ROOT if there is none
+};
+
+struct briteTree{
+	std::vector<briteNode> nodes; //node IDs are indices, in .brkeg order (parents before children)
+	std::unordered_map<std::string, int> paths; //path from the top of the tree -> node ID
+	std::unordered_map<std::string, int> names; //name -> first node with that name
+	std::unordered_map<std::string, std::vector<int> > genes; //gene -> nodes the gene is listed under
+	int levelSize[BRITE_LEVELS]; //number of nodes at each level
+};
+
+//takes a line from a .brkeg file and parses out the upper case text between '<' and '>'
+inline std::string parseBriteLine(std::string line){
+	size_t start = line.find("<");
+	if (start == std::string::npos){
+		return "";
+	}
+	size_t end = line.find(">", start+1);
+	std::string name = line.substr(start+1, (end == std::string::npos) ? std::string::npos : end-start-1);
+	std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+	return name;
+}
+
+//returns the path of a node from the top of the tree
+inline std::string getBritePath(briteTree& tree, int node){
+	std::string path = tree.nodes[node].name;
+	for (int parent = tree.nodes[node].parent; parent != BRITE_ROOT; parent = tree.nodes[parent].parent){
+		path = tree.nodes[parent].name + BRITE_PATH_SEPARATOR + path;
+	}
+	return path;
+}
+
+//adds a node below 'parent' (or returns the existing node with the same path) and returns its ID
+inline int addBriteNode(briteTree& tree, std::string name, int level, int parent){
+	std::string path = (parent == BRITE_ROOT) ? name : getBritePath(tree, parent) + BRITE_PATH_SEPARATOR + name;
+	std::unordered_map<std::string, int>::iterator found = tree.paths.find(path);
+	if (found != tree.paths.end()){
+		return found->second;
+	}
+	briteNode node;
+	node.name = name;
+	node.level = level;
+	node.parent = parent;
+	tree.nodes.push_back(node);
+	int id = tree.nodes.size()-1;
+	tree.paths[path] = id;
+	if (tree.names.find(name) == tree.names.end()){
+		tree.names[name] = id;
+	}
+	tree.levelSize[level]++;
+	return id;
+}
+
+//parses a .brkeg file into the tree
+inline void parseBriteTree(std::istream& kegFile, briteTree& tree){
+	std::string line;
+	int currentA = BRITE_ROOT, currentB = BRITE_ROOT, currentC = BRITE_ROOT;
+	for (int level = 0; level < BRITE_LEVELS; level++){
+		tree.levelSize[level] = 0;
+	}
+	while (getline(kegFile, line)){
+		if (line.length() == 0){
+			continue;
+		}
+		switch (line[0]){
+			case 'A' : currentA = addBriteNode(tree, parseBriteLine(line), BRITE_A, BRITE_ROOT);
+					   currentB = BRITE_ROOT;
+					   currentC = BRITE_ROOT;
+					   break;
+			case 'C' : currentB = addBriteNode(tree, parseBriteLine(line), BRITE_B, currentA);
+					   currentC = BRITE_ROOT;
+					   break;
+			case 'P' : if (currentB != BRITE_ROOT){
+						   currentC = addBriteNode(tree, parseBriteLine(line), BRITE_C, currentB);
+					   }
+					   break;
+			case 'G' : {
+					   int node = (currentC != BRITE_ROOT) ? currentC : currentB;
+					   if (node != BRITE_ROOT){
+						   std::vector<int>& geneNodes = tree.genes[parseBriteLine(line)];
+						   if (std::find(geneNodes.begin(), geneNodes.end(), node) == geneNodes.end()){
+							   geneNodes.push_back(node);
+						   }
+					   }
+					   break;
+			}
+		}
+	}
+}
+
+//finds the node of a category written by 'getKegResults'. The full path is tried first, then the names
+//in the path from the bottom up (so results written with a .brkeg that has more or fewer levels still
+//match the deepest category this tree knows). returns -1 if not found
+inline int findBriteNode(briteTree& tree, const std::string& path){
+	std::unordered_map<std::string, int>::iterator found = tree.paths.find(path);
+	if (found != tree.paths.end()){
+		return found->second;
+	}
+	size_t end = path.length();
+	while (end > 0){
+		size_t separator = path.rfind(BRITE_PATH_SEPARATOR, end-1);
+		size_t start = (separator == std::string::npos) ? 0 : separator+1;
+		found = tree.names.find(path.substr(start, end-start));
+		if (found != tree.names.end()){
+			return found->second;
+		}
+		if (separator == std::string::npos){
+			break;
+		}
+		end = separator;
+	}
+	return -1;
+}
+
+#endif
@@ -0,0 +1,155 @@
+/***************************************************************************************************
+BufferedWriter
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is a small output writer shared by the programs that write large result files.
+		 Records are collected in a large buffer that is only written to the file when it is full
+		 (or the writer is closed), and numbers are formatted with std::to_chars instead of the
+		 stream formatting machinery. It is used like an ofstream ('<<'), but there is no endl:
+		 write "\n" and the buffer is flushed when needed.
+
+		 Numbers are formatted the same way an ofstream formats them by default (doubles with 6
+		 significant digits, bools as 0/1) so output files do not change.
+
+		 It can also collect the output in a string instead of a file (attach(std::string&)), which is
+		 how libsynteny (see Synteny.h) returns its results in memory with the same formatting.
+****************************************************************************************************/
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <charconv>
+
+class BufferedWriter{
+	public:
+		static const size_t BUFFER_SIZE = 1 << 20; //bytes collected before each write to the file
+
+		BufferedWriter() : file(NULL), text(NULL), ownsFile(false), used(0), written(0) {}
+		~BufferedWriter(){ close(); }
+
+		//opens a file for writing, returns false if it can't be opened
+		bool open(const char* fileName){
+			close();
+			file = fopen(fileName, "wb");
+			ownsFile = true;
+			written = 0;
+			buffer.resize(BUFFER_SIZE);
+			return file != NULL;
+		}
+
+		//writes to an already open stream (e.g. stdout). the stream is flushed but not closed by close()
+		void attach(FILE* stream){
+			close();
+			file = stream;
+			ownsFile = false;
+			written = 0;
+			buffer.resize(BUFFER_SIZE);
+		}
+
+		//appends everything written to a string. the string must outlive the writer (or close())
+		void attach(std::string& output){
+			close();
+			text = &output;
+			ownsFile = false;
+			written = 0;
+			buffer.resize(BUFFER_SIZE);
+		}
+
+		bool is_open() const { return file != NULL || text != NULL; }
+
+		//bytes written since the file was opened (or attached), including the ones still in the buffer
+		long long tell() const { return written + used; }
+
+		void flush(){
+			if (file != NULL && used > 0){
+				fwrite(&buffer[0], 1, used, file);
+			}else if (text != NULL && used > 0){
+				text->append(&buffer[0], used);
+			}
+			written += used;
+			used = 0;
+			if (file != NULL){
+				fflush(file);
+			}
+		}
+
+		void close(){
+			if (file != NULL){
+				flush();
+				if (ownsFile){
+					fclose(file);
+				}
+			}else if (text != NULL){
+				flush();
+			}
+			file = NULL;
+			text = NULL;
+		}
+
+		void write(const char* data, size_t length){
+			if (used + length > buffer.size()){
+				flush();
+				if (length > buffer.size()){ //too big to buffer, written directly
+					if (file != NULL){
+						fwrite(data, 1, length, file);
+					}else if (text != NULL){
+						text->append(data, length);
+					}
+					written += length;
+					return;
+				}
+			}
+			memcpy(&buffer[used], data, length);
+			used += length;
+		}
+
+		BufferedWriter& operator<<(const std::string& value){ write(value.data(), value.length()); return *this; }
+		BufferedWriter& operator<<(const char* value){ write(value, strlen(value)); return *this; }
+		BufferedWriter& operator<<(char c){ reserve(1); buffer[used++] = c; return *this; }
+		BufferedWriter& operator<<(bool value){ return *this << (value ? '1' : '0'); }
+		BufferedWriter& operator<<(int value){ return writeNumber(value); }
+		BufferedWriter& operator<<(long value){ return writeNumber(value); }
+		BufferedWriter& operator<<(unsigned int value){ return writeNumber(value); }
+		BufferedWriter& operator<<(unsigned long value){ return writeNumber(value); }
+		BufferedWriter& operator<<(long long value){ return writeNumber(value); }
+		BufferedWriter& operator<<(unsigned long long value){ return writeNumber(value); }
+		BufferedWriter& operator<<(double value){
+			reserve(32);
+			std::to_chars_result result = std::to_chars(&buffer[used], &buffer[used] + 32, value, std::chars_format::general, 6);
+			used = result.ptr - &buffer[0];
+			return *this;
+		}
+
+	private:
+		FILE* file;
+		std::string* text; //output string when attached to one instead of a file
+		bool ownsFile;
+		std::vector<char> buffer;
+		size_t used; //bytes of the buffer in use
+		long long written; //bytes passed to the file
+
+		BufferedWriter(const BufferedWriter&); //not copyable
+		BufferedWriter& operator=(const BufferedWriter&);
+
+		//makes sure there is room for 'length' more bytes in the buffer
+		void reserve(size_t length){
+			if (used + length > buffer.size()){
+				flush();
+			}
+		}
+
+		template <typename T>
+		BufferedWriter& writeNumber(T value){
+			reserve(24);
+			std::to_chars_result result = std::to_chars(&buffer[used], &buffer[used] + 24, value);
+			used = result.ptr - &buffer[0];
+			return *this;
+		}
+};
+
+#endif
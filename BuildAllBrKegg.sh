@@ -8,11 +8,30 @@
 #Purpose: This is a script made to construct the functional databases used downstream to
 #		  categorize genes into functions. It calls 'ConstructBrKegg.py' for all keg files
 #
-#Arguments: None
+#		 When a local copy of the BRITE links is given, every .brkeg is built by 'BuildBrKegg'
+#		 instead, without a network connection and in parallel
+#
+#Arguments: optional: (1)BRITE link file (the downloads of rest.kegg.jp/link/<org>/brite of the
+#		   organisms, concatenated or as @<list file>)
 ###########################################################################################
+links=$1
+
+if [ -n "$links" ]
+then
+	g++ -O2 -std=c++17 BuildBrKegg.cpp -o BuildBrKegg -lz -pthread
+	set --
+	for species in fastas/*/*; do
+		speciesName=${species%.*}
+		speciesName=${speciesName##*/}
+		set -- "$@" ${species}/*.keg ${species}/${speciesName}.brkeg
+	done
+	./BuildBrKegg $links "$@"
+	exit
+fi
+
 for species in fastas/*/*; do
 		speciesName=${species%.*}
 		speciesName=${speciesName##*/}
 		./ConstructBrKegg.py ${species}/*.keg ${species}/${speciesName}.brkeg
 done
-	
+
@@ -0,0 +1,372 @@
+/***************************************************************************************************
+BuildBrKegg
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This builds the .brkeg file of every organism without a network connection, the same
+		 .brkeg 'ConstructBrKegg.py' writes. Instead of downloading rest.kegg.jp/link/<org>/brite
+		 for each organism, the BRITE links are read from local copies of those downloads (any number
+		 of them, concatenated or in separate files). The links are parsed once into a hash index of
+		 (organism, BRITE table) -> genes shared by every organism, and the organisms are built in
+		 parallel (one thread per organism, up to the number of cores).
+		 Link lines are 'br:<table> <tab> <org>:<gene>' (either order)
+
+Arguments: (1)BRITE link file, or @<list file> naming one link file per line
+		   (2...)pairs of .keg file and output .brkeg, e.g. c_jejuni.keg c_jejuni.brkeg c_coli.keg c_coli.brkeg
+****************************************************************************************************/
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+
+using namespace std;
+
+struct briteLinks{ //genes of every BRITE table of every organism
+	unordered_map<string, vector<string> > genes; //"<org>\t<table>" -> genes, in link file order
+	unordered_map<string, long long> organisms; //org -> number of links
+	long long links;
+};
+
+struct kegCategory{ //a functional category (B line of the .keg) with its pathways in .keg order
+	string name;
+	string topLevel; //name of the A line above the category when it was first seen
+	vector<string> pathways; //"" (genes before the first pathway) is always first
+	unordered_map<string, vector<string> > pathwayGenes; //pathway -> genes
+};
+
+struct brkeggJob{
+	string kegFile;
+	string outputFile;
+	string org; //KEGG organism code from the #ENTRY line
+	int status; //buildStatus
+	long long genes;
+};
+
+enum buildStatus {BUILD_DONE = 0, BUILD_NO_KEG = 1, BUILD_NO_OUTPUT = 2, BUILD_NO_LINKS = 3};
+
+
+//takes the link file argument (a file or an @list file) and returns the link files to read
+vector<string> getLinkFiles(string input);
+
+//parses the BRITE link files into the (organism, table) index. returns false if a file can't be opened
+bool parseBriteLinks(vector<string>& files, briteLinks& links);
+
+//takes one link line and adds the gene to the index
+void addBriteLink(string line, briteLinks& links);
+
+//builds every .brkeg on its own thread (up to the number of cores)
+void buildAllBrKegg(vector<brkeggJob>& jobs, briteLinks& links);
+
+//reads the .keg of one organism, adds the genes of its BRITE tables and writes its .brkeg
+void buildBrKegg(brkeggJob& job, briteLinks& links);
+
+//finds the KEGG organism code in the #ENTRY line of a .keg file (the letters after '#ENTRY')
+string getOrganismCode(vector<string>& kegLines);
+
+//parses the categories, pathways and genes of a .keg file in the order 'ConstructBrKegg.py' does
+void parseKegCategories(vector<string>& kegLines, string org, briteLinks& links, vector<kegCategory>& categories);
+
+//gets the name of a pathway (or BRITE table) from a C level line of the kegg file
+//e.g. 'C    00010 Glycolysis / Gluconeogenesis [PATH:ko00010]' -> 'Glycolysis / Gluconeogenesis'
+string getPathwayName(string line);
+
+//gets the text between '<b>' and '</b>' of an A or B line
+string getBoldName(string line);
+
+//writes the categories to a .brkeg file (A = top level, C = category, P = pathway, G = gene)
+void outputBrKegg(vector<kegCategory>& categories, BufferedWriter& output);
+
+
+////////////////////////////MAIN//////////////////////////////////////////////////////
+int main(int argc, char *argv[]){
+	if (argc < 4 || argc % 2 != 0){
+		cout << "missing arguments! Provide: BRITE link file (or @<list file>) and pairs of .keg file and output .brkeg" << endl;
+		return 0;
+	}
+	vector<string> linkFiles = getLinkFiles(argv[1]);
+	briteLinks links;
+	cout << "Reading BRITE links..." << endl;
+	if (linkFiles.empty() || !parseBriteLinks(linkFiles, links)){
+		return 0;
+	}
+	cout << links.links << " links of " << links.organisms.size() << " organisms" << endl;
+
+	vector<brkeggJob> jobs;
+	for (int i = 2; i+1 < argc; i += 2){
+		brkeggJob job;
+		job.kegFile = argv[i];
+		job.outputFile = argv[i+1];
+		job.status = BUILD_DONE;
+		job.genes = 0;
+		jobs.push_back(job);
+	}
+	cout << "Building " << jobs.size() << " .brkeg files..." << endl;
+	buildAllBrKegg(jobs, links);
+
+	//reported in argument order once every thread is done
+	for (int x = 0; x < jobs.size(); x++){
+		if (jobs[x].status == BUILD_NO_KEG){
+			cout << "!!!!!!!!!!!!!BuildBrKegg ERROR:failed to read " << jobs[x].kegFile << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		}else if (jobs[x].status == BUILD_NO_OUTPUT){
+			cout << "!!!!!!!!!!!!!BuildBrKegg ERROR:failed to open " << jobs[x].outputFile << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		}else{
+			if (jobs[x].status == BUILD_NO_LINKS){
+				cout << "!!!!!!!!!!!!!BuildBrKegg ERROR:no BRITE links for '" << jobs[x].org << "' (" << jobs[x].kegFile
+					 << "), only the genes of the .keg are used!!!!!!!!!!!!!!!!!!!!!" << endl;
+			}
+			cout << "Done with " << jobs[x].org << " (" << jobs[x].genes << " genes)" << endl;
+		}
+	}
+	return 0;
+}
+
+
+////////////////////FUNCTIONS////////////////////////////////////////////////////////////////
+
+vector<string> getLinkFiles(string input){
+	vector<string> files;
+	if (input.length() > 1 && input[0] == '@'){ //list file
+		ifstream list(input.substr(1).c_str());
+		string line;
+		while(getline(list, line)){
+			if (line.length() > 0){
+				files.push_back(line);
+			}
+		}
+	}else{
+		files.push_back(input);
+	}
+	return files;
+}
+
+bool parseBriteLinks(vector<string>& files, briteLinks& links){
+	links.links = 0;
+	for (int x = 0; x < files.size(); x++){
+		CompressedInput data; //inputs may be gzip or zstd compressed
+		data.open(files[x].c_str());
+		if (!data.is_open()){
+			cout << "!!!!!!!!!!!!!BuildBrKegg ERROR:failed to open " << files[x] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return false;
+		}
+		for (string line; getline(data, line);){
+			addBriteLink(line, links);
+		}
+		if (data.failed()){
+			cout << "!!!!!!!!!!!!!BuildBrKegg ERROR:failed to read " << files[x] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void addBriteLink(string line, briteLinks& links){
+	if (line.length() > 0 && line[line.length()-1] == '\r'){
+		line.erase(line.length()-1);
+	}
+	size_t tab = line.find('\t');
+	if (tab == string::npos){
+		return;
+	}
+	string brite = line.substr(0, tab);
+	string gene = line.substr(tab+1);
+	if (gene.compare(0, 3, "br:") == 0){ //link/brite/<org> lists the gene first
+		swap(brite, gene);
+	}
+	size_t briteColon = brite.find(':');
+	size_t geneColon = gene.find(':');
+	if (briteColon == string::npos || geneColon == string::npos){
+		return;
+	}
+	string key = gene.substr(0, geneColon) + "\t" + brite.substr(briteColon+1);
+	links.genes[key].push_back(gene.substr(geneColon+1));
+	links.organisms[gene.substr(0, geneColon)]++;
+	links.links++;
+}
+
+void buildAllBrKegg(vector<brkeggJob>& jobs, briteLinks& links){
+	atomic<int> next(0);
+	int threadCount = min<int>(max<int>(thread::hardware_concurrency(), 1), jobs.size());
+	vector<thread> workers;
+	for (int t = 0; t < threadCount; t++){
+		workers.push_back(thread([&](){
+			for (int x = next++; x < jobs.size(); x = next++){
+				buildBrKegg(jobs[x], links);
+			}
+		}));
+	}
+	for (int t = 0; t < workers.size(); t++){
+		workers[t].join();
+	}
+}
+
+void buildBrKegg(brkeggJob& job, briteLinks& links){
+	CompressedInput kegFile;
+	kegFile.open(job.kegFile.c_str());
+	if (!kegFile.is_open()){
+		job.status = BUILD_NO_KEG;
+		return;
+	}
+	vector<string> kegLines;
+	for (string line; getline(kegFile, line);){
+		kegLines.push_back(line);
+	}
+	if (kegFile.failed()){
+		job.status = BUILD_NO_KEG;
+		return;
+	}
+	job.org = getOrganismCode(kegLines);
+
+	//the index is only read by the threads, so it is shared without a lock
+	if (links.organisms.find(job.org) == links.organisms.end()){
+		job.status = BUILD_NO_LINKS;
+	}
+
+	vector<kegCategory> categories;
+	parseKegCategories(kegLines, job.org, links, categories);
+	for (int x = 0; x < categories.size(); x++){
+		for (unordered_map<string, vector<string> >::iterator it = categories[x].pathwayGenes.begin(); it != categories[x].pathwayGenes.end(); it++){
+			job.genes += it->second.size();
+		}
+	}
+
+	BufferedWriter output;
+	if (!output.open(job.outputFile.c_str())){
+		job.status = BUILD_NO_OUTPUT;
+		return;
+	}
+	outputBrKegg(categories, output);
+	output.close();
+}
+
+string getOrganismCode(vector<string>& kegLines){
+	string org = "";
+	for (int x = 0; x < kegLines.size(); x++){
+		size_t pos = kegLines[x].find("#ENTRY");
+		if (pos != string::npos){
+			org = "";
+			for (pos += 7; pos < kegLines[x].length(); pos++){
+				if (isalpha(kegLines[x][pos])){
+					org += kegLines[x][pos];
+				}
+			}
+		}
+	}
+	return org;
+}
+
+void parseKegCategories(vector<string>& kegLines, string org, briteLinks& links, vector<kegCategory>& categories){
+	unordered_map<string, int> categoryIndex; //name -> position in 'categories'
+	string topName = "";
+	for (int x = 0; x < kegLines.size(); x++){
+		string& line = kegLines[x];
+		if (line.length() == 0 || line.find("</b>") == string::npos){
+			continue;
+		}
+		if (line[0] == 'A'){
+			topName = getBoldName(line);
+		}
+		if (line[0] != 'B' || line.find("Overview") != string::npos){
+			continue;
+		}
+		string name = getBoldName(line);
+		if (categoryIndex.find(name) == categoryIndex.end()){
+			categoryIndex[name] = categories.size();
+			kegCategory category;
+			category.name = name;
+			category.topLevel = topName;
+			category.pathways.push_back("");
+			categories.push_back(category);
+		}
+		kegCategory& category = categories[categoryIndex[name]];
+		string pathway = ""; //genes before the first pathway belong to the category itself
+		//the category runs to the next B line (or the '!' at the end of the file)
+		for (int y = x+1; y < kegLines.size() && (kegLines[y].length() == 0 || (kegLines[y][0] != 'B' && kegLines[y][0] != '!')); y++){
+			string& entry = kegLines[y];
+			if (entry.length() == 0){
+				continue;
+			}
+			if (entry[0] == 'C'){
+				pathway = getPathwayName(entry);
+				if (find(category.pathways.begin()+1, category.pathways.end(), pathway) == category.pathways.end()){
+					category.pathways.push_back(pathway);
+				}
+				size_t table = entry.find("[BR:");
+				if (table != string::npos){ //BRITE table, its genes come from the links
+					string br = entry.substr(table+4);
+					br = br.substr(0, br.find("]"));
+					unordered_map<string, vector<string> >::iterator found = links.genes.find(org + "\t" + br);
+					if (found != links.genes.end()){
+						vector<string>& genes = category.pathwayGenes[pathway];
+						genes.insert(genes.end(), found->second.begin(), found->second.end());
+					}
+				}
+			}else if (entry[0] == 'D'){
+				size_t start = entry.find(" ");
+				if (start == string::npos || start+6 >= entry.length()){
+					continue;
+				}
+				string gene = entry.substr(start+6);
+				category.pathwayGenes[pathway].push_back(gene.substr(0, gene.find(" ")));
+			}
+		}
+	}
+}
+
+string getPathwayName(string line){
+	//strips the level letter and surrounding whitespace
+	size_t start = line.find_first_not_of(" \t\r", 1);
+	size_t end = line.find_last_not_of(" \t\r");
+	string name = (start == string::npos) ? "" : line.substr(start, end-start+1);
+	name = name.substr(name.find(" ")+1); //removes the pathway number
+	if (name.find(" [") != string::npos){
+		name = name.substr(0, name.find(" ["));
+	}
+	name.erase(remove(name.begin(), name.end(), '<'), name.end());
+	name.erase(remove(name.begin(), name.end(), '>'), name.end());
+	return name;
+}
+
+string getBoldName(string line){
+	size_t start = line.find("<b>");
+	size_t end = line.find("</b>");
+	start = (start == string::npos) ? 0 : start+3;
+	return (end == string::npos || end < start) ? "" : line.substr(start, end-start);
+}
+
+void outputBrKegg(vector<kegCategory>& categories, BufferedWriter& output){
+	string currentTop = "";
+	bool topWritten = false;
+	for (int x = 0; x < categories.size(); x++){
+		kegCategory& category = categories[x];
+		if ((!topWritten || category.topLevel != currentTop) && category.topLevel != ""){
+			currentTop = category.topLevel;
+			topWritten = true;
+			output << "A\t<" << currentTop << ">\n";
+		}
+		output << "C\t<" << category.name << ">\n";
+		for (int y = 0; y < category.pathways.size(); y++){
+			string& pathway = category.pathways[y];
+			unordered_map<string, vector<string> >::iterator genes = category.pathwayGenes.find(pathway);
+			if (pathway != "" && (genes == category.pathwayGenes.end() || genes->second.empty())){
+				continue; //pathways without genes in this organism
+			}
+			if (pathway != ""){
+				output << "P\t<" << pathway << ">\n";
+			}
+			if (genes == category.pathwayGenes.end()){
+				continue;
+			}
+			for (int z = 0; z < genes->second.size(); z++){
+				output << "G\t<" << genes->second[z] << ">\n";
+			}
+		}
+	}
+}
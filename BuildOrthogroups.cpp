@@ -0,0 +1,438 @@
+/***************************************************************************************************
+BuildOrthogroups
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This groups the proteins of every organism of a genus into orthogroups and classifies the
+		 movement of every orthogroup in every pair of organisms in one pass. Proteins that are each
+		 other's best blast hit (reciprocal best hits, matched as 'CompareOrthologs' matches them)
+		 are joined with a union-find, so a group links proteins of organisms that were never blasted
+		 against each other directly. Every orthogroup gets an integer ID and the gene order of each
+		 organism is written as a sequence of orthogroup IDs.
+
+		 The matches of a pair are then looked up in the shared orthogroup index (the members of each
+		 orthogroup in each organism) instead of the blast results, and both directions of every pair of
+		 organisms are classified by their neighbours (see OrthologClassifier.h) on one thread per core. A protein
+		 is matched to the first member of its orthogroup in the other organism. As in 'getKegResults',
+		 a pair of proteins is only counted when they are each other's match and moved (or didn't) in
+		 both directions, and the first organism of the pair (in genus order) is the subject.
+
+		 Output files (the prefix is argument 2):
+		 	<prefix>_orthogroups.tsv - orthogroup, organism and fasta ID of every protein
+		 	<prefix>_orthogroupOrder.tsv - every organism and the orthogroups of its proteins in fasta order
+		 	<prefix>_orthogroupMovement.tsv - for every orthogroup, the organisms it is in and the number of
+		 	pairs of organisms in each movement category
+
+Arguments: (1)Name of directory/genus (no path, must be within 'fastas' directory), (2)prefix of the output files
+		   optional: -blast <directory> (directory holding the <organism>_and_<organism> blast results,
+		   			 repeatable, default blast_results/<genus> and blast_results)
+		   			 -onetoone -wholegenome -checkrange <n> -rangecutoff <n> -nearbycutoff <fraction>
+		   			 (same as 'CompareOrthologs')
+****************************************************************************************************/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "OrthologClassifier.h"
+#include "ProgressMetrics.h"
+#include "CategoryTable.h"
+#include "Synteny.h"
+
+using namespace std;
+
+struct orthogroupGenome{ //one organism
+	string name; //fasta file name without the path or extension (the name 'synteny.sh' uses)
+	vector<string> proteinIDs; //fasta IDs in file order
+	genomeSegments segments;
+	int first; //ID of its first protein in the union-find (proteins of all organisms are numbered in genus order)
+};
+
+struct orthogroupIndex{ //members of every orthogroup, by organism
+	vector<int> groupOf; //protein (union-find ID) -> orthogroup
+	vector<int> memberStart; //first member of each orthogroup, then the number of members
+	vector<int> members; //union-find IDs, sorted, so the members of each organism are together in fasta order
+};
+
+enum movementCategory {NOT_MOVED = 0, MOVED_ADJACENT = 1, MOVED_CONSERVED = 2, MOVED_MUTUAL_CONSERVED = 3};
+
+struct orthogroupMovement{ //counts of an orthogroup over the pairs of organisms
+	int counts[MOVEMENT_CATEGORIES];
+};
+
+//finds the organisms of the genus (subdirectories of 'fastas/<genus>' with a .fasta) and loads their proteins
+//returns false if there are fewer than two
+bool loadGenomes(string genusDirectory, bool splitReplicons, vector<orthogroupGenome>& genomes);
+
+
+//reads the blast results of every pair that has them (one pair per thread) and joins the reciprocal best hits
+//returns the number of pairs read
+int joinReciprocalHits(vector<string>& blastDirectories, bool oneToOne, vector<orthogroupGenome>& genomes, vector<int>& parent);
+
+//numbers the components of the union-find in genus order and indexes their members
+void buildOrthogroups(vector<int>& parent, orthogroupIndex& index);
+
+//matches the proteins of the subject to the first member of their orthogroup in the query
+vector<int> getOrthogroupMatches(orthogroupIndex& index, orthogroupGenome& subject, orthogroupGenome& query);
+
+//classifies both directions of every pair of organisms and counts the movement category of every orthogroup
+void classifyOrthogroups(orthogroupIndex& index, vector<orthogroupGenome>& genomes, classifierParams& params,
+						 vector<orthogroupMovement>& movement);
+
+//output files
+void outputOrthogroups(orthogroupIndex& index, vector<orthogroupGenome>& genomes, string fileName);
+void outputOrthogroupOrder(orthogroupIndex& index, vector<orthogroupGenome>& genomes, string fileName);
+void outputOrthogroupMovement(orthogroupIndex& index, vector<orthogroupGenome>& genomes, vector<orthogroupMovement>& movement,
+							  string fileName);
+
+//organism of a protein (union-find ID)
+int getGenome(vector<orthogroupGenome>& genomes, int protein);
+
+
+////////////////////////////MAIN//////////////////////////////////////////////////////
+int main(int argc, char *argv[]){
+	if (argc < 3){
+		cout << "missing arguments! Provide: the name of the genus (directory in 'fastas') and the prefix of the output files" << endl;
+		cout << "optional: -blast <directory> (blast results of the pairs, default blast_results/<genus> and blast_results)" << endl;
+		cout << "          -onetoone -wholegenome -checkrange <n> -rangecutoff <n> -nearbycutoff <fraction> (same as CompareOrthologs)" << endl;
+		return 0;
+	}
+	string genusName = argv[1];
+	string prefix = argv[2];
+	vector<string> blastDirectories;
+	classifierParams params = {CHECK_RANGE, RANGE_CUTOFF, NEARBY_PROTEIN_CUTOFF};
+	bool splitReplicons = true;
+	bool oneToOne = false;
+	for (int i = 3; i < argc; i++){
+		if (string(argv[i]) == "-blast" && i+1 < argc){
+			blastDirectories.push_back(argv[++i]);
+		}else if (string(argv[i]) == "-onetoone"){
+			oneToOne = true;
+		}else if (string(argv[i]) == "-wholegenome"){
+			splitReplicons = false;
+		}else if (string(argv[i]) == "-checkrange" && i+1 < argc){
+			params.checkRange = atoi(argv[++i]);
+		}else if (string(argv[i]) == "-rangecutoff" && i+1 < argc){
+			params.rangeCutoff = atoi(argv[++i]);
+		}else if (string(argv[i]) == "-nearbycutoff" && i+1 < argc){
+			params.nearbyProteinCutoff = atof(argv[++i]);
+		}else{
+			cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:unknown option " << argv[i] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+	}
+	if (params.checkRange < 1 || params.checkRange > MAX_CHECK_RANGE || params.rangeCutoff < 0 ||
+		params.nearbyProteinCutoff < 0 || params.nearbyProteinCutoff > 1){
+		cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:-checkrange must be 1-" << MAX_CHECK_RANGE << ", -rangecutoff >= 0 and -nearbycutoff 0-1!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	if (blastDirectories.empty()){ //after and before 'merge_genus.sh' moves them
+		blastDirectories.push_back("blast_results/" + genusName);
+		blastDirectories.push_back("blast_results");
+	}
+	progressMetrics().start("BuildOrthogroups"); //progress is written to $SYNTENY_METRICS_DIR when it is set
+
+	vector<orthogroupGenome> genomes;
+	if (!loadGenomes("fastas/" + genusName, splitReplicons, genomes)){
+		cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:fewer than two organisms in fastas/" << genusName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	int proteins = genomes.back().first + genomes.back().proteinIDs.size();
+	vector<int> parent(proteins);
+	for (int x = 0; x < proteins; x++){
+		parent[x] = x;
+	}
+	int pairs = joinReciprocalHits(blastDirectories, oneToOne, genomes, parent);
+	if (pairs == 0){
+		cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:no blast results found for the pairs of " << genusName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+
+	orthogroupIndex index;
+	buildOrthogroups(parent, index);
+	cout << proteins << " proteins of " << genomes.size() << " organisms in " << index.memberStart.size()-1
+		 << " orthogroups (from the blast results of " << pairs << " pairs)" << endl;
+
+	vector<orthogroupMovement> movement;
+	classifyOrthogroups(index, genomes, params, movement);
+
+	outputOrthogroups(index, genomes, prefix + "_orthogroups.tsv");
+	outputOrthogroupOrder(index, genomes, prefix + "_orthogroupOrder.tsv");
+	outputOrthogroupMovement(index, genomes, movement, prefix + "_orthogroupMovement.tsv");
+	return 0;
+}
+
+
+////////////////////FUNCTIONS////////////////////////////////////////////////////////////////
+
+bool loadGenomes(string genusDirectory, bool splitReplicons, vector<orthogroupGenome>& genomes){
+	vector<synteny::organism> organisms;
+	synteny::loadOrganisms(genusDirectory, organisms);
+	int first = 0;
+	for (int x = 0; x < organisms.size(); x++){
+		orthogroupGenome genome;
+		genome.name = organisms[x].name;
+		for (int y = 0; y < organisms[x].proteins.proteins.size(); y++){
+			genome.proteinIDs.push_back(organisms[x].proteins.proteins[y].id);
+		}
+		buildGenomeSegments(genome.proteinIDs, splitReplicons, genome.segments);
+		genome.first = first;
+		first += genome.proteinIDs.size();
+		genomes.push_back(genome);
+	}
+	return genomes.size() >= 2;
+}
+
+//the blast results of the pair <first>_and_<second> are subject_<first>_query_<second>.txt and the
+//other direction, named as 'synteny.sh' names them
+int joinReciprocalHits(vector<string>& blastDirectories, bool oneToOne, vector<orthogroupGenome>& genomes, vector<int>& parent){
+	int tasks = genomes.size()*genomes.size(); //every ordered pair, the pair directory can be named either way
+	vector<vector<pair<int, int> > > hits(tasks); //reciprocal best hits found for each task
+	vector<char> found(tasks, 0);
+	vector<string> unreadable(tasks); //blast results of the task that couldn't be read
+	atomic<int> next(0);
+	int threadCount = min<int>(max<int>(thread::hardware_concurrency(), 1), tasks);
+	vector<thread> workers;
+	for (int t = 0; t < threadCount; t++){
+		workers.push_back(thread([&](){
+			for (int task = next++; task < tasks; task = next++){
+				int x = task/genomes.size();
+				int y = task%genomes.size();
+				if (x == y){
+					continue;
+				}
+				string pairName = genomes[x].name + "_and_" + genomes[y].name;
+				for (int d = 0; d < blastDirectories.size(); d++){
+					string directory = blastDirectories[d] + "/" + pairName + "/";
+					CompressedInput forwardBlast, reverseBlast; //inputs may be gzip or zstd compressed
+					forwardBlast.open((directory + "subject_" + genomes[x].name + "_query_" + genomes[y].name + ".txt").c_str());
+					reverseBlast.open((directory + "subject_" + genomes[y].name + "_query_" + genomes[x].name + ".txt").c_str());
+					if (!forwardBlast.is_open() || !reverseBlast.is_open()){
+						continue;
+					}
+					vector<int> forward, reverse;
+					if (oneToOne){
+						forward = getOneToOneMatches(forwardBlast, genomes[x].proteinIDs, genomes[y].proteinIDs);
+						reverse = getOneToOneMatches(reverseBlast, genomes[y].proteinIDs, genomes[x].proteinIDs);
+					}else{
+						forward = getMatchPositions(forwardBlast, genomes[x].proteinIDs, genomes[y].proteinIDs);
+						reverse = getMatchPositions(reverseBlast, genomes[y].proteinIDs, genomes[x].proteinIDs);
+					}
+					if (forwardBlast.failed() || reverseBlast.failed()){ //e.g. a truncated .gz
+						unreadable[task] = directory;
+						break;
+					}
+					for (int a = 0; a < forward.size(); a++){
+						if (forward[a] != NO_PROTEIN && reverse[forward[a]] == a){
+							hits[task].push_back(make_pair(genomes[x].first + a, genomes[y].first + forward[a]));
+						}
+					}
+					found[task] = 1;
+					break; //the first directory that has the pair is used
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < workers.size(); t++){
+		workers[t].join();
+	}
+	progressMetrics().finish(progressMetrics().stage("parse_hits", "hits"));
+	int pairs = 0;
+	for (int task = 0; task < tasks; task++){
+		if (unreadable[task] != ""){
+			cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:failed to read the blast results in " << unreadable[task] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		}
+		pairs += found[task];
+		for (int h = 0; h < hits[task].size(); h++){
+			int a = findComponent(parent, hits[task][h].first);
+			int b = findComponent(parent, hits[task][h].second);
+			if (a != b){
+				parent[max(a, b)] = min(a, b); //the root is the first protein of the group
+			}
+		}
+	}
+	return pairs;
+}
+
+void buildOrthogroups(vector<int>& parent, orthogroupIndex& index){
+	int proteins = parent.size();
+	index.groupOf.assign(proteins, NO_PROTEIN);
+	vector<int> groupOfRoot(proteins, NO_PROTEIN);
+	int groups = 0;
+	for (int x = 0; x < proteins; x++){
+		int root = findComponent(parent, x);
+		if (groupOfRoot[root] == NO_PROTEIN){ //numbered by the first protein of the group in genus order
+			groupOfRoot[root] = groups++;
+		}
+		index.groupOf[x] = groupOfRoot[root];
+	}
+	//counting sort of the proteins by orthogroup keeps the members in genus order
+	index.memberStart.assign(groups+1, 0);
+	for (int x = 0; x < proteins; x++){
+		index.memberStart[index.groupOf[x]+1]++;
+	}
+	for (int g = 0; g < groups; g++){
+		index.memberStart[g+1] += index.memberStart[g];
+	}
+	index.members.resize(proteins);
+	vector<int> filled(index.memberStart.begin(), index.memberStart.end()-1);
+	for (int x = 0; x < proteins; x++){
+		index.members[filled[index.groupOf[x]]++] = x;
+	}
+}
+
+vector<int> getOrthogroupMatches(orthogroupIndex& index, orthogroupGenome& subject, orthogroupGenome& query){
+	vector<int> matchPositions(subject.proteinIDs.size(), NO_PROTEIN);
+	int queryEnd = query.first + query.proteinIDs.size();
+	for (int x = 0; x < subject.proteinIDs.size(); x++){
+		int group = index.groupOf[subject.first + x];
+		vector<int>::iterator begin = index.members.begin() + index.memberStart[group];
+		vector<int>::iterator end = index.members.begin() + index.memberStart[group+1];
+		vector<int>::iterator member = lower_bound(begin, end, query.first);
+		if (member != end && *member < queryEnd){
+			matchPositions[x] = *member - query.first;
+		}
+	}
+	return matchPositions;
+}
+
+void classifyOrthogroups(orthogroupIndex& index, vector<orthogroupGenome>& genomes, classifierParams& params,
+						 vector<orthogroupMovement>& movement){
+	int groups = index.memberStart.size()-1;
+	int tasks = genomes.size()*(genomes.size()-1)/2; //every pair of organisms, both directions are classified together
+	vector<pair<int, int> > pairs;
+	for (int x = 0; x < genomes.size(); x++){
+		for (int y = x+1; y < genomes.size(); y++){
+			pairs.push_back(make_pair(x, y));
+		}
+	}
+	progressStage& classified = progressMetrics().stage("classify", "pairs");
+	classified.expected = tasks;
+	atomic<int> next(0);
+	int threadCount = min<int>(max<int>(thread::hardware_concurrency(), 1), tasks);
+	vector<vector<orthogroupMovement> > threadMovement(threadCount);
+	vector<thread> workers;
+	for (int t = 0; t < threadCount; t++){
+		workers.push_back(thread([&, t](){
+			orthogroupMovement empty = {{0, 0, 0, 0}};
+			threadMovement[t].assign(groups, empty);
+			for (int task = next++; task < tasks; task = next++){
+				orthogroupGenome& subject = genomes[pairs[task].first];
+				orthogroupGenome& query = genomes[pairs[task].second];
+				vector<int> matches[2] = {getOrthogroupMatches(index, subject, query), getOrthogroupMatches(index, query, subject)};
+				vector<uint64_t> movedBits[2], conservedBits[2];
+				classifierParams settings = params;
+				classifyByNeighbours(matches[0], subject.segments, query.segments, settings, movedBits[0], conservedBits[0]);
+				classifyByNeighbours(matches[1], query.segments, subject.segments, settings, movedBits[1], conservedBits[1]);
+				for (int s = 0; s < matches[0].size(); s++){
+					int q = matches[0][s];
+					if (q == NO_PROTEIN){
+						continue;
+					}
+					//only reciprocal matches that moved (or didn't) in both directions are counted, as 'getKegResults'
+					bool moved = isMoved(movedBits[0], s);
+					if (matches[1][q] != s || isMoved(movedBits[1], q) != moved){
+						continue;
+					}
+					int move = MOVED_ADJACENT;
+					if (!moved){
+						move = NOT_MOVED;
+					}else if (isMoved(conservedBits[0], s)){
+						move = isMoved(conservedBits[1], q) ? MOVED_MUTUAL_CONSERVED : MOVED_CONSERVED;
+					}
+					threadMovement[t][index.groupOf[subject.first + s]].counts[move]++;
+				}
+				classified.done.fetch_add(1, memory_order_relaxed);
+			}
+		}));
+	}
+	for (int t = 0; t < workers.size(); t++){
+		workers[t].join();
+	}
+	progressMetrics().finish(classified);
+	orthogroupMovement empty = {{0, 0, 0, 0}};
+	movement.assign(groups, empty);
+	for (int t = 0; t < threadMovement.size(); t++){
+		for (int g = 0; g < groups; g++){
+			for (int move = 0; move < MOVEMENT_CATEGORIES; move++){
+				movement[g].counts[move] += threadMovement[t][g].counts[move];
+			}
+		}
+	}
+}
+
+void outputOrthogroups(orthogroupIndex& index, vector<orthogroupGenome>& genomes, string fileName){
+	BufferedWriter out;
+	if (!out.open(fileName.c_str())){
+		cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:failed to open " << fileName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return;
+	}
+	out << "ORTHOGROUP\tORGANISM\tPROTEIN\n";
+	for (int g = 0; g+1 < index.memberStart.size(); g++){
+		for (int m = index.memberStart[g]; m < index.memberStart[g+1]; m++){
+			orthogroupGenome& genome = genomes[getGenome(genomes, index.members[m])];
+			out << g << "\t" << genome.name << "\t" << genome.proteinIDs[index.members[m] - genome.first] << "\n";
+		}
+	}
+}
+
+void outputOrthogroupOrder(orthogroupIndex& index, vector<orthogroupGenome>& genomes, string fileName){
+	BufferedWriter out;
+	if (!out.open(fileName.c_str())){
+		cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:failed to open " << fileName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return;
+	}
+	//replicons are separated by '|'
+	for (int x = 0; x < genomes.size(); x++){
+		out << genomes[x].name << "\t";
+		for (int y = 0; y < genomes[x].proteinIDs.size(); y++){
+			if (y > 0){
+				out << ((genomes[x].segments.segmentOf[y] != genomes[x].segments.segmentOf[y-1]) ? " | " : " ");
+			}
+			out << index.groupOf[genomes[x].first + y];
+		}
+		out << "\n";
+	}
+}
+
+void outputOrthogroupMovement(orthogroupIndex& index, vector<orthogroupGenome>& genomes, vector<orthogroupMovement>& movement,
+							  string fileName){
+	BufferedWriter out;
+	if (!out.open(fileName.c_str())){
+		cout << "!!!!!!!!!!!!!BuildOrthogroups ERROR:failed to open " << fileName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return;
+	}
+	out << "ORTHOGROUP\tPROTEINS\tORGANISMS\tUNMOVED\tMOVED\tMOVED.CONS\tMUTUAL.CONS\n";
+	for (int g = 0; g < movement.size(); g++){
+		int organisms = 0;
+		int last = -1;
+		for (int m = index.memberStart[g]; m < index.memberStart[g+1]; m++){
+			int genome = getGenome(genomes, index.members[m]);
+			organisms += (genome != last);
+			last = genome;
+		}
+		out << g << "\t" << index.memberStart[g+1]-index.memberStart[g] << "\t" << organisms;
+		for (int move = 0; move < MOVEMENT_CATEGORIES; move++){
+			out << "\t" << movement[g].counts[move];
+		}
+		out << "\n";
+	}
+}
+
+int getGenome(vector<orthogroupGenome>& genomes, int protein){
+	int low = 0, high = genomes.size()-1;
+	while (low < high){ //last organism whose first protein is at or before the protein
+		int middle = (low + high + 1)/2;
+		if (genomes[middle].first <= protein){
+			low = middle;
+		}else{
+			high = middle-1;
+		}
+	}
+	return low;
+}
@@ -0,0 +1,160 @@
+/***************************************************************************************************
+CategoryTable
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This counts protein pairs by BRITE category (see BriteTree.h) and movement category and
+		 writes the tables of keg category counts vs movement category. It is shared by
+		 'FormatKegResults' and 'MovementMatrix' so both count a pair the same way: once at every node
+		 above its categories, and as UNCATEGORIZED at the levels where it has none. The B level table
+		 goes to the output .csv, the A and C level tables (when the .brkeg has them) next to it as
+		 *_levelA.csv and *_levelC.csv
+****************************************************************************************************/
+#ifndef CATEGORY_TABLE_H
+#define CATEGORY_TABLE_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "BufferedWriter.h"
+#include "BriteTree.h"
+
+const int MOVEMENT_CATEGORIES = 4;
+//sections of the 'getKegResults' output, in the order of the movement categories (0-3)
+const char* const MOVEMENT_SECTIONS[MOVEMENT_CATEGORIES] = {"NOT_MOVED", "MOVED_ADJACENT", "MOVED_CONSERVED", "MOVED_MUTUAL_CONSERVED"};
+
+struct categoryCounts{ //stores count data for keg categories
+	std::vector<std::string> categories;
+	std::vector<int> notMoved, moved, movedConserved, mutualConserved;
+};
+
+struct briteCounts{ //pair counts for every node of the BRITE tree, then an UNCATEGORIZED count per level
+	std::vector<int> notMoved, moved, movedConserved, mutualConserved;
+};
+
+//adds zeros to all positions so specific indexes can be increased during the count
+inline void initBriteCounts(briteTree& kegTree, briteCounts& counts){
+	int size = kegTree.nodes.size() + BRITE_LEVELS;
+	counts.notMoved.assign(size, 0);
+	counts.moved.assign(size, 0);
+	counts.movedConserved.assign(size, 0);
+	counts.mutualConserved.assign(size, 0);
+}
+
+//finds the nodes of the categories of one pair ('keg' holds the tab separated paths written by 'getKegResults')
+//and counts the pair once at each of them and their parents
+//pairs with categories but none at a level (or marked UNCATEGORIZED) count as UNCATEGORIZED at that level
+//'weight' counts that many pairs with the same categories at once
+inline void countCategories(briteTree& kegTree, const std::string& keg, int move, briteCounts& counts, std::vector<int>& nodes,
+							int weight = 1){
+	std::vector<int>* column;
+	switch (move){
+		case 0 : column = &counts.notMoved;
+				 break;
+		case 1 : column = &counts.moved;
+				 break;
+		case 2 : column = &counts.movedConserved;
+				 break;
+		case 3 : column = &counts.mutualConserved;
+				 break;
+		default : return; //erased duplicate
+	}
+	//categories are tab separated paths in the BRITE tree
+	nodes.clear();
+	bool uncategorized = false;
+	size_t start = 0;
+	while (start < keg.length()){
+		size_t end = keg.find("\t", start);
+		if (end == std::string::npos){
+			end = keg.length();
+		}
+		std::string category = keg.substr(start, end-start);
+		if (category == "UNCATEGORIZED"){
+			uncategorized = true;
+		}else if (category.length() > 0){
+			for (int node = findBriteNode(kegTree, category); node != BRITE_ROOT; node = kegTree.nodes[node].parent){
+				nodes.push_back(node);
+			}
+		}
+		start = end+1;
+	}
+	if (nodes.empty() && !uncategorized){ //none of the categories are in this .brkeg
+		return;
+	}
+	//a pair with several categories under the same node is only counted once there
+	std::sort(nodes.begin(), nodes.end());
+	nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+	bool levelFound[BRITE_LEVELS] = {false, false, false};
+	for (int x = 0; x < nodes.size(); x++){
+		(*column)[nodes[x]] += weight;
+		levelFound[kegTree.nodes[nodes[x]].level] = true;
+	}
+	for (int level = 0; level < BRITE_LEVELS; level++){
+		if (!levelFound[level]){
+			(*column)[kegTree.nodes.size() + level] += weight;
+		}
+	}
+}
+
+//takes the counts for every node and builds the table for one level of the tree
+inline void getLevelTable(briteTree& kegTree, briteCounts& counts, int level, categoryCounts& countData){
+	for (int x = 0; x <= kegTree.nodes.size(); x++){
+		int index = x;
+		if (x == kegTree.nodes.size()){ //uncategorized is the last row
+			countData.categories.push_back("UNCATEGORIZED");
+			index = kegTree.nodes.size() + level;
+		}else if (kegTree.nodes[x].level == level){
+			countData.categories.push_back(kegTree.nodes[x].name);
+		}else{
+			continue;
+		}
+		countData.notMoved.push_back(counts.notMoved[index]);
+		countData.moved.push_back(counts.moved[index]);
+		countData.movedConserved.push_back(counts.movedConserved[index]);
+		countData.mutualConserved.push_back(counts.mutualConserved[index]);
+	}
+}
+
+//takes the output file name and adds the level (e.g. results.csv -> results_levelA.csv)
+inline std::string getLevelFileName(std::string fileName, std::string level){
+	if (fileName.length() > 4 && fileName.substr(fileName.length()-4) == ".csv"){
+		fileName = fileName.substr(0, fileName.length()-4);
+	}
+	return fileName + "_level" + level + ".csv";
+}
+
+//outputs the count results to a .csv
+inline void outputTable(categoryCounts& countData, BufferedWriter& outputFile){
+	outputFile << "FUNCTION,UNMOVED,MOVED,MOVED.CONS,MUTUAL.CONS\n";
+	for (int x = 0; x < countData.categories.size(); x++){
+		//commas in category titles (e.g. 'Folding, sorting and degradation') mess up the comma delimiting
+		std::string category = countData.categories[x];
+		category.erase(std::remove(category.begin(), category.end(), ','), category.end());
+		outputFile << category << ",";
+		outputFile << countData.notMoved[x] << ",";
+		outputFile << countData.moved[x] << ",";
+		outputFile << countData.movedConserved[x] << ",";
+		outputFile << countData.mutualConserved[x] << "\n";
+	}
+}
+
+//functional categories (B level) go to the output file, the other levels next to it if the .brkeg has them
+inline void outputCategoryTables(briteTree& kegTree, briteCounts& counts, const std::string& fileName){
+	for (int level = BRITE_A; level < BRITE_LEVELS; level++){
+		if (level != BRITE_B && kegTree.levelSize[level] == 0){
+			continue;
+		}
+		categoryCounts countData;
+		getLevelTable(kegTree, counts, level, countData);
+		BufferedWriter output;
+		if (level == BRITE_B){
+			output.open(fileName.c_str());
+		}else{
+			output.open(getLevelFileName(fileName, (level == BRITE_A) ? "A" : "C").c_str());
+		}
+		outputTable(countData, output);
+	}
+}
+
+#endif
@@ -0,0 +1,355 @@
+/***************************************************************************************************
+CompressedInput
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is an input stream shared by the programs that read fasta, genbank, keg and blast
+		 files. It can be used in place of an ifstream. Compressed files are detected by their
+		 first bytes (not their extension) and decompressed while they are being read:
+		 	gzip - decompressed with zlib
+		 	zstd - decompressed with libzstd if compiled with -DSYNTENY_ZSTD -lzstd, otherwise
+		 		   by an external 'zstd -dc' process
+		 Decompression runs on its own thread and hands finished blocks to the parser through a
+		 small queue, so parsing and decompression overlap. Uncompressed files are read directly.
+
+		 Compressed streams can only be read from start to finish (no seekg). A file that can't be
+		 decompressed (e.g. a truncated .gz) sets badbit once the data before the error has been read,
+		 so readers check bad() (or failed()) at the end of the file.
+
+		 MemoryInput is the same kind of stream over text that is already in memory (nothing is
+		 copied), so the parsers that read files can also parse the buffers given to libsynteny
+		 (see Synteny.h). readInputFile reads a whole (possibly compressed) file into a string.
+
+		 Programs that include this must be linked with -lz -pthread.
+****************************************************************************************************/
+#ifndef COMPRESSED_INPUT_H
+#define COMPRESSED_INPUT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <istream>
+#include <fstream>
+#include <streambuf>
+#include <ios>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+#ifdef SYNTENY_ZSTD
+#include <zstd.h>
+#endif
+
+enum inputFormat {INPUT_RAW, INPUT_GZIP, INPUT_ZSTD};
+
+//checks the first bytes of a file for the gzip or zstd magic numbers
+inline inputFormat detectInputFormat(const char* fileName){
+	unsigned char magic[4] = {0, 0, 0, 0};
+	FILE* file = fopen(fileName, "rb");
+	if (file == NULL){
+		return INPUT_RAW;
+	}
+	size_t length = fread(magic, 1, 4, file);
+	fclose(file);
+	if (length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b){
+		return INPUT_GZIP;
+	}
+	if (length == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd){
+		return INPUT_ZSTD;
+	}
+	return INPUT_RAW;
+}
+
+//stream buffer filled by a decompression thread
+class decompressingBuffer : public std::streambuf{
+	public:
+		static const size_t CHUNK_SIZE = 1 << 18; //bytes decompressed at a time
+		static const size_t MAX_QUEUED = 8; //decompressed chunks waiting to be parsed
+
+		decompressingBuffer(std::string fileName, inputFormat format) : finished(false), stopping(false), failed(false){
+			worker = std::thread(&decompressingBuffer::decompress, this, fileName, format);
+		}
+
+		~decompressingBuffer(){
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				stopping = true;
+			}
+			queueChanged.notify_all();
+			worker.join();
+		}
+
+		bool hasFailed(){
+			std::lock_guard<std::mutex> lock(queueLock);
+			return failed;
+		}
+
+	protected:
+		int_type underflow(){
+			if (gptr() < egptr()){
+				return traits_type::to_int_type(*gptr());
+			}
+			std::unique_lock<std::mutex> lock(queueLock);
+			while (ready.empty() && !finished){
+				queueChanged.wait(lock);
+			}
+			if (ready.empty()){
+				if (failed){ //the istream catches this and sets badbit
+					throw std::ios_base::failure("failed to decompress");
+				}
+				return traits_type::eof();
+			}
+			current.swap(ready.front());
+			ready.pop_front();
+			lock.unlock();
+			queueChanged.notify_all();
+			setg(&current[0], &current[0], &current[0] + current.size());
+			return traits_type::to_int_type(*gptr());
+		}
+
+	private:
+		std::thread worker;
+		std::mutex queueLock;
+		std::condition_variable queueChanged;
+		std::deque<std::vector<char> > ready; //decompressed chunks in file order
+		std::vector<char> current; //chunk being parsed
+		bool finished; //the decompression thread is done
+		bool stopping; //the reader was closed early
+		bool failed; //the file could not be decompressed
+
+		//hands a decompressed chunk to the reader, waits if the queue is full. returns false if the reader is gone
+		bool push(std::vector<char>& chunk){
+			std::unique_lock<std::mutex> lock(queueLock);
+			while (ready.size() >= MAX_QUEUED && !stopping){
+				queueChanged.wait(lock);
+			}
+			if (stopping){
+				return false;
+			}
+			ready.push_back(std::vector<char>());
+			ready.back().swap(chunk);
+			lock.unlock();
+			queueChanged.notify_all();
+			return true;
+		}
+
+		void finish(bool error){
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				finished = true;
+				failed = error;
+			}
+			queueChanged.notify_all();
+		}
+
+		void decompress(std::string fileName, inputFormat format){
+			std::vector<char> chunk;
+			bool error = false;
+			if (format == INPUT_GZIP){
+				gzFile file = gzopen(fileName.c_str(), "rb");
+				error = (file == NULL);
+				if (file != NULL){
+					gzbuffer(file, CHUNK_SIZE);
+					while (true){
+						chunk.resize(CHUNK_SIZE);
+						int length = gzread(file, &chunk[0], CHUNK_SIZE);
+						if (length <= 0){
+							int code = Z_OK;
+							gzerror(file, &code);
+							error = (length < 0 || code != Z_OK); //a truncated file only sets Z_BUF_ERROR
+							break;
+						}
+						chunk.resize(length);
+						if (!push(chunk)){
+							break;
+						}
+					}
+					gzclose(file);
+				}
+			}else{
+#ifdef SYNTENY_ZSTD
+				FILE* file = fopen(fileName.c_str(), "rb");
+				ZSTD_DStream* stream = ZSTD_createDStream();
+				error = (file == NULL || stream == NULL);
+				if (!error){
+					ZSTD_initDStream(stream);
+					std::vector<char> compressed(ZSTD_DStreamInSize());
+					size_t length;
+					size_t remaining = 0; //0 at the end of a frame
+					bool readerGone = false;
+					while (!error && !readerGone && (length = fread(&compressed[0], 1, compressed.size(), file)) > 0){
+						ZSTD_inBuffer in = {&compressed[0], length, 0};
+						while (in.pos < in.size && !readerGone){
+							chunk.resize(CHUNK_SIZE);
+							ZSTD_outBuffer out = {&chunk[0], chunk.size(), 0};
+							remaining = ZSTD_decompressStream(stream, &out, &in);
+							if (ZSTD_isError(remaining)){
+								error = true;
+								break;
+							}
+							chunk.resize(out.pos);
+							if (out.pos > 0 && !push(chunk)){
+								readerGone = true;
+							}
+						}
+					}
+					error = error || (!readerGone && (ferror(file) || remaining != 0)); //a truncated file ends inside a frame
+				}
+				if (stream != NULL){
+					ZSTD_freeDStream(stream);
+				}
+				if (file != NULL){
+					fclose(file);
+				}
+#else
+				std::string quoted = "'";
+				for (int x = 0; x < fileName.length(); x++){
+					if (fileName[x] == '\''){
+						quoted += "'\\''";
+					}else{
+						quoted += fileName[x];
+					}
+				}
+				quoted += "'";
+				FILE* process = popen(("zstd -dc -- " + quoted).c_str(), "r");
+				error = (process == NULL);
+				if (process != NULL){
+					while (true){
+						chunk.resize(CHUNK_SIZE);
+						size_t length = fread(&chunk[0], 1, CHUNK_SIZE, process);
+						if (length == 0){
+							break;
+						}
+						chunk.resize(length);
+						if (!push(chunk)){
+							break;
+						}
+					}
+					bool exitFailed = (pclose(process) != 0);
+					std::lock_guard<std::mutex> lock(queueLock);
+					error = exitFailed && !stopping; //zstd fails when the reader closes the pipe early
+				}
+#endif
+			}
+			finish(error);
+		}
+};
+
+//drop-in replacement for an ifstream that reads raw, gzip and zstd files
+class CompressedInput : public std::istream{
+	public:
+		CompressedInput() : std::istream(NULL), decompressor(NULL) {}
+		~CompressedInput(){ close(); }
+
+		void open(const char* fileName){
+			close();
+			inputFormat format = detectInputFormat(fileName);
+			if (format == INPUT_RAW){
+				if (fileBuffer.open(fileName, std::ios::in | std::ios::binary) != NULL){
+					rdbuf(&fileBuffer);
+					clear();
+				}else{
+					setstate(std::ios::failbit);
+				}
+			}else{
+				FILE* test = fopen(fileName, "rb"); //makes sure the file can be read before starting a thread
+				if (test == NULL){
+					setstate(std::ios::failbit);
+					return;
+				}
+				fclose(test);
+				decompressor = new decompressingBuffer(fileName, format);
+				rdbuf(decompressor);
+				clear();
+			}
+		}
+
+		bool is_open() const{
+			return fileBuffer.is_open() || decompressor != NULL;
+		}
+
+		//true if the open file couldn't be read or decompressed
+		bool failed(){
+			return is_open() && (bad() || (decompressor != NULL && decompressor->hasFailed()));
+		}
+
+		void close(){
+			rdbuf(NULL);
+			if (fileBuffer.is_open()){
+				fileBuffer.close();
+			}
+			delete decompressor;
+			decompressor = NULL;
+		}
+
+	private:
+		std::filebuf fileBuffer;
+		decompressingBuffer* decompressor;
+
+		CompressedInput(const CompressedInput&); //not copyable
+		CompressedInput& operator=(const CompressedInput&);
+};
+
+//stream buffer over text in memory, it is only read so the const_cast is never written through
+class memoryBuffer : public std::streambuf{
+	public:
+		memoryBuffer(const char* data, size_t size){
+			char* start = const_cast<char*>(data);
+			setg(start, start, start + size);
+		}
+};
+
+//istream over a buffer (e.g. a std::string or a std::string_view). the buffer must outlive the stream
+class MemoryInput : public std::istream{
+	public:
+		MemoryInput(const char* data, size_t size) : std::istream(NULL), buffer(data, size) {
+			rdbuf(&buffer);
+		}
+
+	private:
+		memoryBuffer buffer;
+
+		MemoryInput(const MemoryInput&); //not copyable
+		MemoryInput& operator=(const MemoryInput&);
+};
+
+//reads a whole raw, gzip or zstd file into 'text'. returns false if it can't be read or decompressed
+inline bool readInputFile(const char* fileName, std::string& text){
+	text.clear();
+	if (detectInputFormat(fileName) == INPUT_RAW){
+		FILE* file = fopen(fileName, "rb");
+		if (file == NULL){
+			return false;
+		}
+		if (fseek(file, 0, SEEK_END) == 0){
+			long size = ftell(file);
+			if (size > 0){
+				text.reserve(size);
+			}
+			fseek(file, 0, SEEK_SET);
+		}
+		char chunk[1 << 16];
+		size_t length;
+		while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0){
+			text.append(chunk, length);
+		}
+		bool failed = ferror(file);
+		fclose(file);
+		return !failed;
+	}
+	CompressedInput input;
+	input.open(fileName);
+	if (!input.is_open()){
+		return false;
+	}
+	std::vector<char> chunk(decompressingBuffer::CHUNK_SIZE);
+	while (input.read(&chunk[0], chunk.size()) || input.gcount() > 0){
+		text.append(&chunk[0], input.gcount());
+	}
+	return !input.failed();
+}
+
+#endif
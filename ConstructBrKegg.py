@@ -9,6 +9,7 @@
 #Purpose: This is a script made to construct a reference file of genes sorted into functional
 #		  categories. It takes a kegg orthology file and downloads the appropriate BRITE file
 #		  It constructs a single file using the information from both
+#		  The file keeps the BRITE hierarchy: top levels (A), categories (C), pathways (P) and genes (G)
 #	
 #Arguments: (1) .keg file (2) output file name (.brkeg)
 ###########################################################################################
@@ -60,41 +61,74 @@ for x in range (0, len(briteLines)):
 	briteDict[br].append(gene)
 
 
+#gets the name of a pathway (or BRITE table) from a C level line of the kegg file
+#e.g. 'C    00010 Glycolysis / Gluconeogenesis [PATH:ko00010]' -> 'Glycolysis / Gluconeogenesis'
+def getPathwayName(line):
+	name = line[1:].strip()
+	name = name[name.find(" ")+1:]
+	if name.find(" [") != -1:
+		name = name[:name.find(" [")]
+	return name.replace("<", "").replace(">", "")
+
+
 #makes dictionary of all kegg categories and the associated genes including the brite genes
+#categories are kept in the kegg file order with their top level (A) and their pathways (C)
 geneList = []
-keggDict = defaultdict(list)
+categoryOrder = []
+topLevel = {}
+keggDict = defaultdict(list) #key = category values = pathways
+pathwayGenes = defaultdict(list) #key = (category, pathway) values = genes
+topName = ''
 for x in range(0, len(inputLines)):
+	if (inputLines[x].find("</b>") !=-1 and inputLines[x][0] == 'A'):
+		topName = inputLines[x][inputLines[x].find("<b>")+3:inputLines[x].find("</b>")]
 	if (inputLines[x].find("</b>") !=-1 and inputLines[x][0] == 'B' and inputLines[x].find("Overview") == -1):
 		category = inputLines[x][:inputLines[x].find("</b>")]
 		category = category[category.find("<b>")+3:]
+		if category not in topLevel:
+			categoryOrder.append(category)
+			topLevel[category] = topName
+		pathway = '' #genes before the first pathway belong to the category itself
 		y = x+1
 		while inputLines[y][0] != 'B' and inputLines[y][0] !='!':
+			if inputLines[y][0] == 'C':
+				pathway = getPathwayName(inputLines[y])
+				if pathway not in keggDict[category]:
+					keggDict[category].append(pathway)
 			if inputLines[y][0] == 'C' and inputLines[y].find("[BR:") != -1:
 				br = inputLines[y][inputLines[y].find(":")+1:]
 				br = br[:br.find("]")]
 				if br in briteDict:
 					for q in briteDict[br]:
-						keggDict[category].append(q)
+						pathwayGenes[(category, pathway)].append(q)
 			if inputLines[y][0] == 'D':
 				gene = inputLines[y][inputLines[y].find(" ")+6:]
 				gene = gene[:gene.find(" ")]
-				keggDict[category].append(gene)
+				pathwayGenes[(category, pathway)].append(gene)
 			y+=1
 		
 
 
 print("Building .brkeg file...")
 #outputs the data to a file for downstream parsing and use
+#A = top level, C = category, P = pathway within the category, G = gene of the category/pathway above it
 output = open(sys.argv[2], "w")
-for categories in keggDict:
-	output.write("C\t<")
-	output.write(categories)
-	output.write(">\n")
-	for genes in keggDict[categories]:
-		output.write("G\t<")
-		output.write(genes)
-		#output.write(" ")
-		output.write(">\n")
+currentTop = None
+for category in categoryOrder:
+	if topLevel[category] != currentTop and topLevel[category] != '':
+		currentTop = topLevel[category]
+		output.write("A\t<"+currentTop+">\n")
+	output.write("C\t<"+category+">\n")
+	for pathway in [''] + keggDict[category]:
+		if pathway != '' and len(pathwayGenes[(category, pathway)]) == 0:
+			continue #pathways without genes in this organism
+		if pathway != '':
+			output.write("P\t<"+pathway+">\n")
+		for genes in pathwayGenes[(category, pathway)]:
+			output.write("G\t<")
+			output.write(genes)
+			#output.write(" ")
+			output.write(">\n")
 			
 output.close()
 
@@ -0,0 +1,285 @@
+/***************************************************************************************************
+FastaIndex
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This lists the proteins of a protein .fasta in file order (their rank) without reading the
+		 sequences. For each header it keeps the ID (the text after '>' up to the first space or tab),
+		 the offsets of the header and its sequence, and the '[location=...]' field with the lowest and
+		 highest base of the coding region. Uncompressed files are memory mapped and the headers are
+		 found with memchr, gzip/zstd files are streamed through CompressedInput.
+
+		 The index is saved next to the fasta as <fasta>.fidx and loaded directly by later runs as long
+		 as the size and modification time of the fasta are the same (if the directory can't be
+		 written the fasta is simply scanned every time). Offsets of compressed files are positions in
+		 the decompressed text.
+
+		 Programs that include this must be linked with -lz -pthread (for CompressedInput.h).
+****************************************************************************************************/
+#ifndef FASTA_INDEX_H
+#define FASTA_INDEX_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <charconv>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+
+const char FASTA_INDEX_EXTENSION[] = ".fidx";
+const char FASTA_INDEX_VERSION[] = "FASTAINDEX1";
+
+struct fastaRecord{ //one protein, its rank is its position in fastaIndex.records
+	std::string id; //text after '>' up to the first space or tab
+	long long headerOffset; //offset of the '>'
+	long long sequenceOffset; //offset of the line after the header
+	std::string location; //text of the '[location=...]' field, "" if there is none
+	long start; //lowest base of the location, -1 if there is no location
+	long end; //highest base of the location
+	bool complement; //true if encoded on the reverse strand
+};
+
+struct fastaIndex{
+	std::vector<fastaRecord> records; //in file order
+	long long fileSize; //size and modification time of the fasta the index was built from
+	long long modified;
+};
+
+//parses a location (simple ranges, partial ends, complement(...) and join(...,...)) into the lowest and
+//highest base of all its parts. returns false if it has no numbers
+inline bool parseLocationText(const std::string& text, long& start, long& end, bool& complement){
+	complement = (text.find("complement(") != std::string::npos);
+	start = -1;
+	end = -1;
+	long value = 0;
+	bool inNumber = false;
+	for (size_t x = 0; x <= text.length(); x++){
+		if (x < text.length() && text[x] >= '0' && text[x] <= '9'){
+			value = value*10 + (text[x]-'0');
+			inNumber = true;
+		}else if (inNumber){
+			if (start < 0 || value < start){
+				start = value;
+			}
+			if (value > end){
+				end = value;
+			}
+			value = 0;
+			inNumber = false;
+		}
+	}
+	return start >= 0;
+}
+
+//fills a record from a header line ('>' included, newline excluded)
+inline void parseFastaHeader(const char* line, size_t length, long long offset, fastaRecord& record){
+	size_t idEnd = 1;
+	while (idEnd < length && line[idEnd] != ' ' && line[idEnd] != '\t'){
+		idEnd++;
+	}
+	record.id.assign(line+1, idEnd > 1 ? idEnd-1 : 0);
+	record.headerOffset = offset;
+	record.sequenceOffset = offset + length + 1;
+	record.location.clear();
+	const char* field = (const char*)memmem(line, length, "[location=", 10);
+	if (field != NULL){
+		field += 10;
+		const char* fieldEnd = (const char*)memchr(field, ']', line+length-field);
+		record.location.assign(field, (fieldEnd == NULL) ? line+length-field : fieldEnd-field);
+	}
+	parseLocationText(record.location, record.start, record.end, record.complement);
+}
+
+//finds the headers of an uncompressed fasta in memory. a '>' only starts a header at the start of a line
+inline void scanFastaMemory(const char* data, size_t size, fastaIndex& index){
+	const char* end = data + size;
+	const char* p = data;
+	while (p < end){
+		const char* found = (const char*)memchr(p, '>', end-p);
+		if (found == NULL){
+			break;
+		}
+		const char* lineEnd = (const char*)memchr(found, '\n', end-found);
+		if (lineEnd == NULL){
+			lineEnd = end;
+		}
+		if (found == data || found[-1] == '\n'){
+			index.records.emplace_back();
+			parseFastaHeader(found, lineEnd-found, found-data, index.records.back());
+		}
+		p = lineEnd;
+	}
+}
+
+//builds the index by reading the fasta. returns false if it can't be opened
+inline bool scanFasta(const char* fileName, fastaIndex& index){
+	index.records.clear();
+	if (detectInputFormat(fileName) == INPUT_RAW){
+		int file = open(fileName, O_RDONLY);
+		if (file < 0){
+			return false;
+		}
+		struct stat info;
+		if (fstat(file, &info) == 0 && S_ISREG(info.st_mode)){
+			if (info.st_size == 0){
+				close(file);
+				return true;
+			}
+			void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file, 0);
+			if (data != MAP_FAILED){
+				madvise(data, info.st_size, MADV_SEQUENTIAL);
+				scanFastaMemory((const char*)data, info.st_size, index);
+				munmap(data, info.st_size);
+				close(file);
+				return true;
+			}
+		}
+		close(file); //not a regular file or it can't be mapped, it is streamed instead
+	}
+	CompressedInput fasta;
+	fasta.open(fileName);
+	if (!fasta.is_open()){
+		return false;
+	}
+	long long offset = 0;
+	for (std::string line; getline(fasta, line);){
+		if (line.length() > 0 && line[0] == '>'){
+			index.records.emplace_back();
+			parseFastaHeader(line.c_str(), line.length(), offset, index.records.back());
+		}
+		offset += line.length() + 1;
+	}
+	return !fasta.failed(); //e.g. a truncated .gz
+}
+
+//the size and modification time that a saved index must match. returns false if it isn't a regular file
+inline bool getFastaStamp(const char* fileName, long long& fileSize, long long& modified){
+	struct stat info;
+	if (stat(fileName, &info) != 0 || !S_ISREG(info.st_mode)){
+		return false;
+	}
+	fileSize = info.st_size;
+	modified = (long long)info.st_mtim.tv_sec*1000000000LL + info.st_mtim.tv_nsec;
+	return true;
+}
+
+//writes the index next to the fasta (under a temporary name first so a parallel run never reads half an index)
+//line 1: version, size, modification time, number of proteins. then one line per protein:
+//id, header offset, sequence offset, start, end, complement, location (tab-delimited)
+inline void saveFastaIndex(const char* fileName, fastaIndex& index){
+	std::string indexName = std::string(fileName) + FASTA_INDEX_EXTENSION;
+	std::string tempName = indexName + "." + std::to_string(getpid());
+	BufferedWriter out;
+	if (!out.open(tempName.c_str())){
+		return; //the directory can't be written, the fasta is scanned again next time
+	}
+	out << FASTA_INDEX_VERSION << "\t" << index.fileSize << "\t" << index.modified << "\t" << index.records.size() << "\n";
+	for (size_t x = 0; x < index.records.size(); x++){
+		fastaRecord& record = index.records[x];
+		out << record.id << "\t" << record.headerOffset << "\t" << record.sequenceOffset << "\t" << record.start << "\t"
+			<< record.end << "\t" << record.complement << "\t" << record.location << "\n";
+	}
+	out.close();
+	if (rename(tempName.c_str(), indexName.c_str()) != 0){
+		remove(tempName.c_str());
+	}
+}
+
+//moves past the next tab-delimited field of a line and returns its start and length
+inline const char* nextIndexField(const char*& p, const char* end, size_t& length){
+	const char* field = p;
+	const char* tab = (const char*)memchr(p, '\t', end-p);
+	if (tab == NULL){
+		tab = end;
+	}
+	length = tab-field;
+	p = (tab < end) ? tab+1 : end;
+	return field;
+}
+
+//parses the next tab-delimited field of a line as a number
+inline long long nextIndexNumber(const char*& p, const char* end){
+	size_t length;
+	const char* field = nextIndexField(p, end, length);
+	long long value = 0;
+	std::from_chars(field, field+length, value);
+	return value;
+}
+
+//parses the lines of a saved index
+inline bool parseFastaIndex(const char* p, const char* textEnd, fastaIndex& index){
+	const char* lineEnd = (const char*)memchr(p, '\n', textEnd-p);
+	size_t length;
+	if (lineEnd == NULL){
+		return false;
+	}
+	const char* version = nextIndexField(p, lineEnd, length);
+	if (std::string(version, length) != FASTA_INDEX_VERSION || nextIndexNumber(p, lineEnd) != index.fileSize ||
+		nextIndexNumber(p, lineEnd) != index.modified){
+		return false;
+	}
+	size_t count = nextIndexNumber(p, lineEnd);
+	index.records.clear();
+	index.records.resize(count);
+	size_t x = 0;
+	for (p = lineEnd+1; p < textEnd && x < count; p = lineEnd+1, x++){
+		lineEnd = (const char*)memchr(p, '\n', textEnd-p);
+		if (lineEnd == NULL){
+			return false; //truncated
+		}
+		fastaRecord& record = index.records[x];
+		const char* id = nextIndexField(p, lineEnd, length);
+		record.id.assign(id, length);
+		record.headerOffset = nextIndexNumber(p, lineEnd);
+		record.sequenceOffset = nextIndexNumber(p, lineEnd);
+		record.start = nextIndexNumber(p, lineEnd);
+		record.end = nextIndexNumber(p, lineEnd);
+		record.complement = (nextIndexNumber(p, lineEnd) == 1);
+		record.location.assign(p, lineEnd-p);
+	}
+	return x == count && p == textEnd;
+}
+
+//loads a saved index. returns false if there is none or it doesn't match the fasta
+inline bool loadFastaIndex(const char* fileName, fastaIndex& index){
+	std::string indexName = std::string(fileName) + FASTA_INDEX_EXTENSION;
+	int file = open(indexName.c_str(), O_RDONLY);
+	if (file < 0){
+		return false;
+	}
+	struct stat info;
+	bool loaded = false;
+	if (fstat(file, &info) == 0 && info.st_size > 0){
+		void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file, 0);
+		if (data != MAP_FAILED){
+			loaded = parseFastaIndex((const char*)data, (const char*)data + info.st_size, index);
+			munmap(data, info.st_size);
+		}
+	}
+	close(file);
+	return loaded;
+}
+
+//loads the saved index of a fasta, or scans the fasta and saves its index. returns false if it can't be opened
+inline bool getFastaIndex(const char* fileName, fastaIndex& index){
+	bool regular = getFastaStamp(fileName, index.fileSize, index.modified); //only regular files get a saved index
+	if (regular && loadFastaIndex(fileName, index)){
+		return true;
+	}
+	if (!scanFasta(fileName, index)){
+		return false;
+	}
+	if (regular){
+		saveFastaIndex(fileName, index);
+	}
+	return true;
+}
+
+#endif
@@ -13,7 +13,40 @@ Purpose: This is a component of a series of programs designed to classify protei
 		 category generates a table where each row is a different kegg category and each column is a 
 		 different movement category. The values are the number or proteins that meat both classifications.
 		 
-Arguments: (1)any .brkeg file, (2)concatenated genus results from 'getKegResults' (3) name of output .csv
+		 The .brkeg is loaded as a BRITE hierarchy (see BriteTree.h). Each pair is counted once at every
+		 node above its categories, so the functional category (B level) table and, when the .brkeg has
+		 them, the top level (A) and pathway (C) level tables all come from the same pass. The B level
+		 table is written to the output .csv, the others next to it as *_levelA.csv and *_levelC.csv
+		 
+Arguments: (1)any .brkeg file, (2)genus results from 'getKegResults', any of:
+		   		 	 - a file (e.g. the concatenated results of a genus)
+		   		 	 - a directory, every kegCounts.csv found under it is read (one per genome pair)
+		   		 	 - @<list file>, a text file naming one results file per line
+		   		 	 several files are parsed at the same time (one reader thread per file) and combined in
+		   		 	 the order they are listed (directories are read in sorted path order)
+		   (3) name of output .csv
+		   optional: -memory <MB> streams the results instead of loading them, sorted runs of protein IDs
+		   			 are spilled to temporary files once they use more than <MB> and merged to number the IDs.
+		   			 Duplicates are then removed from the numbered pairs with the same rules as without -memory
+		   			 (for genera whose results don't fit in memory). <MB> only caps the buffered protein IDs:
+		   			 the numbers, movement category and lists of the pairs are kept in memory on top of it
+		   			 (about 28 bytes per protein pair and 32 per different protein ID)
+		   		 	 -tmp <directory> where the temporary runs are written (default $TMPDIR or /tmp)
+		   		 	 -pairs <pair,pair,...> or -pairs @<list file> re-aggregates only these pairs, named by the
+		   		 	 directory of their kegCounts.csv (e.g. org1_and_org2) or by their '##' title. Only their
+		   		 	 sections are read, found with the offset index of each results file (see ResultsIndex.h)
+		   		 	 -index <file> writes the offset index of every pair of the genus to <file>
+		   		 	 -consensus <file> also counts how often every protein and every gene family (proteins with
+		   		 	 the same product) is called in each movement category over all of the pairs, before
+		   		 	 duplicates are removed. Proteins are written to <file> and families to <file>_families.csv,
+		   		 	 each with its most frequent category (the higher one on ties) and the fraction of its calls
+		   		 	 in that category. A protein listed more than once in a pair is one call, in its highest
+		   		 	 category. The counts are built in one pass on reader threads that hand the pairs they
+		   		 	 parse to a movementConsensus of libsynteny (see SyntenyCounts.cpp)
+
+		 The parsing, duplicate removal and counting are done by libsynteny (see Synteny.h). This reads
+		 the results files one pair at a time, keeps the out of core duplicate removal of -memory and
+		 writes the tables.
 ****************************************************************************************************/
 
 #include <iostream>
@@ -23,273 +56,747 @@ Arguments: (1)any .brkeg file, (2)concatenated genus results from 'getKegResults
 #include <stdlib.h>
 #include <utility>
 #include <algorithm>
+#include <queue>
+#include <stdio.h>
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <sstream>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "CategoryTable.h"
+#include "ResultsIndex.h"
+#include "ProgressMetrics.h"
+#include "Synteny.h"
 
 
 using namespace std;
 
-struct data{ //stores count data for keg categories
-	vector<string> categories;
-	vector<int> notMoved, moved, movedConserved, mutualConserved;
+struct pairReader{ //reads the concatenated genus results one genome pair at a time
+	istream* data;
+	string next; //'##' title of the next pair, already read
+	bool inSection; //between a '!!' line and its '**' line
 };
 
-struct movements{
-	string subject;
-	string query;
-	string keg;
-	int move;
+struct pairSelection{ //pairs chosen with -pairs
+	vector<string> pairs; //upper case names, empty = every pair is read
+	vector<resultsIndex> indexes; //offset index of every results file (with -pairs or -index)
 };
 
+struct resultsInput{ //a results file opened for readNextPair
+	CompressedInput file; //the whole file
+	istringstream selected; //or only the sections of the selected pairs
+	istream* data;
+};
 
-//takes a keg file and parses out the categories. Stores all the categories into a vector
-vector<string> parseKegFile(ifstream& kegFile);
+struct spillEntry{ //one protein ID of one pair, sorted and written to a temporary run
+	string protein;
+	long long pair; //order of the pair in the results
+	int role; //SPILL_SUBJECT or SPILL_QUERY
+};
 
-//takes a line from a keg file that contains a category. Parses out the name of the category
-string parseKegLine(string line);
+struct spillRun{ //a temporary run being merged
+	FILE* file;
+	spillEntry current;
+};
 
-//converts a string to uppercase
-string upperCase(string line);
+struct spillRunOrder{ //orders the runs in the merge heap by their current entry (smallest first)
+	vector<spillRun>* runs;
+	bool operator()(int a, int b) const{
+		spillEntry& x = (*runs)[a].current;
+		spillEntry& y = (*runs)[b].current;
+		if (x.protein != y.protein){
+			return x.protein > y.protein;
+		}
+		return x.pair > y.pair;
+	}
+};
 
 
-//takes the concatenated genus results from 'getKegResults', parses and stores in a struct
-void buildMovementResults(ifstream& data, vector<movements>& proteins);
+//parses every results file on its own reader thread and appends the pairs to 'proteins' in file order
+void buildMovementResultsFromFiles(vector<string>& files, pairSelection& selection, vector<synteny::movementCall>& proteins);
 
+//parses the -pairs argument (comma separated or @<list file>) into upper case pair names
+vector<string> getSelectedPairs(string input);
 
-//takes a parsed line from the concatenated genus results
-//returns an integer corresponding to the movement category
-int getMovementCategory(string line);
+//loads the saved offset index of every results file (or scans the file) on reader threads
+void getResultsIndexes(vector<string>& files, vector<resultsIndex>& indexes);
 
-//called by buildMovementResults
-//takes a line from the concatenated genus results
-//parses the line into a struct
-void buildResult(string line, movements& result);
+//checks if a pair was selected with -pairs by its title, its title without '_MOVEMENTRESULTS.CSV'
+//or the directory of its results file
+bool isSelectedPair(string title, string fileName, vector<string>& pairs);
 
-//takes the vector of structs containing all the parsed data for a genus
-//erases the values of any duplicates found
-//keeps the pair with the highest movement classification
-void removeDuplicates(vector<movements>& proteins);
+//opens results file number 'file' for readNextPair. when pairs are selected only their PAIR sections
+//are read (a seek to each one) and the rest of the file is skipped. returns false if it can't be opened
+bool openResults(vector<string>& files, int file, pairSelection& selection, resultsInput& input);
+
+//reads the text of the next genome pair of the concatenated genus results (from its '##' title up to
+//the next one) for synteny::parseMovements. returns false at the end of the file
+bool readNextPair(pairReader& reader, string& text);
 
 //takes the parsed results from 'getKegResults', counts how many proteins match to each category and splits
 //the count into movement categories
-void buildTable(vector<string> categories, vector<movements> results, data& countData);
+void buildTable(vector<synteny::movementCall>& results, synteny::categoryCounter& counts);
+
+//out of core version of synteny::removeDuplicates used with -memory
+//streams the results, writes the subject and query ID of every pair to sorted temporary runs
+//whenever 'memoryLimit' bytes are buffered and merges the runs to number the IDs. Only the numbers and
+//the movement category of every pair are kept for removeNumberedDuplicates, 'removed' marks the duplicates
+//these per pair arrays (and the lists removeNumberedDuplicates builds) are not counted against 'memoryLimit'
+//returns the number of pairs read
+long long removeDuplicatesExternal(vector<string>& files, pairSelection& selection, size_t memoryLimit, string tempDir,
+								   vector<bool>& removed);
+
+//orders spill entries by protein ID, then by pair
+bool spillEntryLess(const spillEntry& a, const spillEntry& b);
+
+//sorts the buffered entries and writes them to a new temporary file
+void writeSpillRun(vector<spillEntry>& entries, string tempDir, vector<string>& runFiles);
+
+//reads the next entry of a temporary run, returns false at the end of the run
+bool readSpillEntry(FILE* run, spillEntry& entry);
+
+//k-way merges the sorted runs and numbers the protein IDs in sorted order. the number of the subject and of
+//the query of every pair is written to 'subjects' and 'queries' (NO_SPILL_PROTEIN for an empty ID)
+//returns the number of different IDs
+int mergeSpillRuns(vector<string>& runFiles, vector<int>& subjects, vector<int>& queries);
+
+//synteny::removeDuplicates on the numbered pairs: every pair that is still kept, in file order, removes the
+//later kept pairs it shares a protein with (subject and subject, subject and query, query and subject)
+//until one of them has a higher movement category, which removes it instead
+void removeNumberedDuplicates(vector<int>& subjects, vector<int>& queries, vector<int>& moves, int proteins,
+							  vector<bool>& removed);
+
+//streaming version of buildTable used with -memory, skips the pairs marked in 'removed'
+void buildTableFromStream(vector<string>& files, pairSelection& selection, vector<bool>& removed,
+						  synteny::categoryCounter& counts);
+
+//counts the movement calls of every protein and family over all the pairs (-consensus). every reader thread
+//parses its files and hands the calls to the consensus in batches of whole pairs
+void countConsensus(vector<string>& files, pairSelection& selection, synteny::movementConsensus& consensus);
+
+//writes the proteins and the families with their most frequent movement category
+void outputConsensus(synteny::movementConsensus& consensus, string fileName);
+
+//writes the functional category (B level) table to the output file, the other levels next to it if the .brkeg has them
+void writeCategoryTables(synteny::categoryTables& tables, string fileName);
 
-//outputs the count results to a .csv
-void outputTable(data countData, ofstream& outputFile);
 
 
+const size_t SPILL_ENTRY_OVERHEAD = sizeof(spillEntry) + 16; //bytes counted for each buffered entry besides the ID
+const int SPILL_SUBJECT = 0;
+const int SPILL_QUERY = 1;
+const int NO_SPILL_PROTEIN = -1;
+const int CONSENSUS_BATCH = 1 << 16; //protein pairs a reader parses before handing them to the consensus
+
 
 int main(int argc, char *argv[]){
-	if (argc != 4){
-		cout << "missing/too many arguments!"<< endl;
+	if (argc < 4){
+		cout << "missing arguments!"<< endl;
+		return 0;
+	}
+	progressMetrics().start("FormatKegResults"); //progress is written to $SYNTENY_METRICS_DIR when it is set
+	size_t memoryLimit = 0; //0 = load everything into memory
+	string tempDir = (getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp";
+	string pairsArgument = "";
+	string indexFile = "";
+	string consensusFile = "";
+	for (int i = 4; i < argc; i++){
+		if (string(argv[i]) == "-memory" && i+1 < argc){
+			memoryLimit = (size_t)atol(argv[++i]) << 20;
+			if (memoryLimit == 0){
+				cout << "!!!!!!!!!!!!!FormatKegResults ERROR:-memory must be at least 1 MB!!!!!!!!!!!!!!!!!!!!!" << endl;
+				return 0;
+			}
+		}else if (string(argv[i]) == "-tmp" && i+1 < argc){
+			tempDir = argv[++i];
+		}else if (string(argv[i]) == "-pairs" && i+1 < argc){
+			pairsArgument = argv[++i];
+		}else if (string(argv[i]) == "-index" && i+1 < argc){
+			indexFile = argv[++i];
+		}else if (string(argv[i]) == "-consensus" && i+1 < argc){
+			consensusFile = argv[++i];
+		}else{
+			cout << "unknown argument: " << argv[i] << endl;
+			return 0;
+		}
+	}
+	string kegFile; //inputs may be gzip or zstd compressed
+	if (!synteny::readInput(argv[1], kegFile)){
+		cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to read " << argv[1] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 1;
+	}
+	vector<string> resultsFiles = getResultsFiles(argv[2]);
+	if (resultsFiles.empty()){
+		cout << "!!!!!!!!!!!!!FormatKegResults ERROR:no results found in " << argv[2] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
 		return 0;
 	}
-	ifstream kegFile, kegResults;
-	kegFile.open(argv[1]);
-	kegResults.open(argv[2]);
 	
-	vector<string> kegCategories = parseKegFile(kegFile);
-	kegCategories.push_back("UNCATEGORIZED"); //adds uncategorized as a category 
+	pairSelection selection;
+	if (pairsArgument != "" || indexFile != ""){
+		getResultsIndexes(resultsFiles, selection.indexes);
+	}
+	if (indexFile != "" && !saveGenusIndex(indexFile, resultsFiles, selection.indexes)){
+		cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to write " << indexFile << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+	}
+	if (pairsArgument != ""){
+		selection.pairs = getSelectedPairs(pairsArgument);
+		int found = 0, total = 0;
+		for (int x = 0; x < resultsFiles.size(); x++){
+			for (int y = 0; y < selection.indexes[x].sections.size(); y++){
+				resultsSection& section = selection.indexes[x].sections[y];
+				if (section.section == RESULTS_PAIR_SECTION){
+					found += isSelectedPair(section.pair, resultsFiles[x], selection.pairs);
+					total++;
+				}
+			}
+		}
+		if (found == 0){
+			cout << "!!!!!!!!!!!!!FormatKegResults ERROR:none of the pairs in " << pairsArgument << " were found!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+		cout << "READING " << found << " OF " << total << " PAIRS..." << endl;
+	}
 	
-	vector<movements> movementResults;
-	buildMovementResults(kegResults, movementResults);
-	removeDuplicates(movementResults);
+	synteny::categoryTree kegTree;
+	kegTree.parse(kegFile);
 	
-	kegResults.clear();
-	kegResults.seekg(0,ios::beg);
-	data countData;
-	buildTable(kegCategories, movementResults, countData);
+	//counted before duplicates are removed, the pairs are read again by the table below
+	if (consensusFile != ""){
+		synteny::movementConsensus consensus;
+		countConsensus(resultsFiles, selection, consensus);
+		outputConsensus(consensus, consensusFile);
+	}
 	
-	ofstream output;
-	output.open(argv[3]);
-	outputTable(countData, output);
+	synteny::categoryCounter counts(kegTree);
+	if (memoryLimit > 0){
+		vector<bool> removed;
+		removeDuplicatesExternal(resultsFiles, selection, memoryLimit, tempDir, removed);
+		buildTableFromStream(resultsFiles, selection, removed, counts); //second pass counts the pairs that were kept
+	}else{
+		vector<synteny::movementCall> movementResults;
+		buildMovementResultsFromFiles(resultsFiles, selection, movementResults);
+		cout << "REMOVING DUPLICATES..." <<endl;
+		long long count = synteny::removeDuplicates(movementResults);
+		cout << count << " out of " << movementResults.size() << " total Protein pairs" <<endl;
+		buildTable(movementResults, counts);
+	}
+	
+	synteny::categoryTables tables;
+	counts.tables(tables);
+	writeCategoryTables(tables, argv[3]);
 	
 	return 0;
 }
 
-vector<string> parseKegFile(ifstream& kegFile){
-	string line;
-	vector<string> categories;
-	while(!kegFile.eof()){
-		getline(kegFile, line);
-		//cout << line <<endl;
-		if(line[0] == 'C'){
-			categories.push_back(parseKegLine(line));
+void buildMovementResultsFromFiles(vector<string>& files, pairSelection& selection, vector<synteny::movementCall>& proteins){
+	vector<vector<synteny::movementCall> > fileResults(files.size());
+	vector<char> opened(files.size(), 0); //1 = read, 2 = opened but it couldn't be read to the end
+	progressStage& filesRead = progressMetrics().stage("read_files", "files");
+	progressStage& pairsRead = progressMetrics().stage("read_results", "pairs");
+	filesRead.expected = files.size();
+	atomic<int> nextFile(0);
+	int threads = thread::hardware_concurrency();
+	if (threads < 1){
+		threads = 1;
+	}
+	if (threads > files.size()){
+		threads = files.size();
+	}
+	//each reader takes the next unread file until all of them are parsed
+	vector<thread> readers;
+	for (int t = 0; t < threads; t++){
+		readers.push_back(thread([&](){
+			int x;
+			while((x = nextFile++) < files.size()){
+				resultsInput input;
+				if (openResults(files, x, selection, input)){
+					opened[x] = 1;
+					pairReader reader = {input.data, "", false};
+					string text;
+					long long pair = 0;
+					while (readNextPair(reader, text)){
+						pair = synteny::parseMovements(text, fileResults[x], pair);
+					}
+					if (input.file.failed()){ //e.g. a truncated .gz
+						opened[x] = 2;
+					}
+					pairsRead.done.fetch_add(fileResults[x].size(), memory_order_relaxed);
+				}
+				filesRead.done.fetch_add(1, memory_order_relaxed);
+			}
+		}));
+	}
+	for (int t = 0; t < readers.size(); t++){
+		readers[t].join();
+	}
+	progressMetrics().finish(filesRead);
+	progressMetrics().finish(pairsRead);
+	for (int x = 0; x < files.size(); x++){
+		if (!opened[x]){
+			cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to open " << files[x] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		}else if (opened[x] == 2){
+			cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to read all of " << files[x] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
 		}
+		proteins.insert(proteins.end(), fileResults[x].begin(), fileResults[x].end());
+		vector<synteny::movementCall>().swap(fileResults[x]);
 	}
-	return categories;
 }
 
-string parseKegLine(string line){
-	string parsedLine = "";
-	int pos = line.find("<");
-	pos++;
-	while(line[pos] != '>'){
-		parsedLine+=line[pos];
-		pos++;
+vector<string> getSelectedPairs(string input){
+	vector<string> pairs;
+	string pair;
+	if (input.length() > 1 && input[0] == '@'){ //list file, one pair per line
+		ifstream list(input.substr(1).c_str());
+		while(getline(list, pair)){
+			if (pair.length() > 0){
+				pairs.push_back(pair);
+			}
+		}
+	}else{
+		stringstream names(input);
+		while(getline(names, pair, ',')){
+			if (pair.length() > 0){
+				pairs.push_back(pair);
+			}
+		}
+	}
+	for (int x = 0; x < pairs.size(); x++){
+		transform(pairs[x].begin(), pairs[x].end(), pairs[x].begin(), ::toupper);
 	}
-	return upperCase(parsedLine);
+	return pairs;
+}
 
+void getResultsIndexes(vector<string>& files, vector<resultsIndex>& indexes){
+	indexes.assign(files.size(), resultsIndex());
+	atomic<int> nextFile(0);
+	int threads = thread::hardware_concurrency();
+	if (threads < 1){
+		threads = 1;
+	}
+	if (threads > files.size()){
+		threads = files.size();
+	}
+	vector<thread> readers;
+	for (int t = 0; t < threads; t++){
+		readers.push_back(thread([&](){
+			int x;
+			while((x = nextFile++) < files.size()){
+				if (!getResultsIndex(files[x], indexes[x])){
+					indexes[x].fileSize = -1; //reported when the file is read
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < readers.size(); t++){
+		readers[t].join();
+	}
 }
 
+bool isSelectedPair(string title, string fileName, vector<string>& pairs){
+	const string suffix = "_MOVEMENTRESULTS.CSV";
+	transform(title.begin(), title.end(), title.begin(), ::toupper);
+	string shortTitle = title;
+	if (shortTitle.length() > suffix.length() && shortTitle.compare(shortTitle.length()-suffix.length(), suffix.length(), suffix) == 0){
+		shortTitle = shortTitle.substr(0, shortTitle.length()-suffix.length());
+	}
+	string directory = filesystem::path(fileName).parent_path().filename().string();
+	transform(directory.begin(), directory.end(), directory.begin(), ::toupper);
+	for (int x = 0; x < pairs.size(); x++){
+		if (pairs[x] == title || pairs[x] == shortTitle || pairs[x] == directory){
+			return true;
+		}
+	}
+	return false;
+}
 
-string upperCase(string line){
-	transform(line.begin(), line.end(), line.begin(), ::toupper);
-	return line;
+bool openResults(vector<string>& files, int file, pairSelection& selection, resultsInput& input){
+	if (selection.pairs.empty()){
+		input.file.open(files[file].c_str()); //inputs may be gzip or zstd compressed
+		input.data = &input.file;
+		return input.file.is_open();
+	}
+	resultsIndex& index = selection.indexes[file];
+	resultsSectionReader reader;
+	if (index.fileSize < 0 || !openResultsSections(files[file], reader)){
+		return false;
+	}
+	string selected, text;
+	for (int x = 0; x < index.sections.size(); x++){
+		resultsSection& section = index.sections[x];
+		if (section.section == RESULTS_PAIR_SECTION && isSelectedPair(section.pair, files[file], selection.pairs)){
+			if (!readResultsSection(reader, section, text)){
+				cout << "!!!!!!!!!!!!!FormatKegResults ERROR:" << files[file] << " is shorter than its index!!!!!!!!!!!!!!!!!!!!!" << endl;
+				break;
+			}
+			selected += text;
+		}
+	}
+	input.selected.str(selected);
+	input.data = &input.selected;
+	return true;
 }
 
-void buildMovementResults(ifstream& data, vector<movements>& proteins){
+bool readNextPair(pairReader& reader, string& text){
+	text = reader.next;
+	reader.next.clear();
 	string line = "";
-	string temp="";
-	movements result;
-	int pos;
-	while(!data.eof()){
-		getline(data, line);
-		if(line.find("!!")!= string::npos){ //indicates movement category line
-			result.move = getMovementCategory(line);
-			while(line.find("**")==string::npos){ //'**' indicates the end of the results
-				getline(data, line);
-				if (line.find("$$")!=string::npos){ //'$$' indicates a line containing data
-					buildResult(line, result);
-					proteins.push_back(result);
-				}
+	while(getline(*reader.data, line)){
+		if (reader.inSection){
+			if (line.find("**")!=string::npos){ //'**' indicates the end of the results
+				reader.inSection = false;
 			}
+		}else if(line.find("!!")!= string::npos){ //indicates movement category line
+			reader.inSection = true;
+		}else if(line.compare(0, 2, "##") == 0 && text.length() > 0){ //title of the next pair
+			reader.next = line + "\n";
+			return true;
 		}
+		text += line + "\n";
 	}
+	return text.length() > 0;
 }
 
+void buildTable(vector<synteny::movementCall>& results, synteny::categoryCounter& counts){
+	progressStage& progress = progressMetrics().stage("count", "pairs");
+	progress.expected = results.size();
+	for(int x = 0; x < results.size(); x++){
+		counts.add(results[x]);
+		progress.done.fetch_add(1, memory_order_relaxed);
+	}
+	progressMetrics().finish(progress);
+}
 
-int getMovementCategory(string line){
-	if (line.find("NOT_MOVED")!=string::npos){
-		return 0;
+long long removeDuplicatesExternal(vector<string>& files, pairSelection& selection, size_t memoryLimit, string tempDir,
+								   vector<bool>& removed){
+	vector<synteny::movementCall> results;
+	string text;
+	vector<spillEntry> entries;
+	vector<string> runFiles;
+	vector<int> moves; //movement category of every pair
+	spillEntry entry;
+	size_t memoryUsed = 0;
+	long long total = 0;
+	long long spilled = 0; //protein IDs written to the runs
+	progressStage& filesRead = progressMetrics().stage("read_files", "files");
+	progressStage& pairsRead = progressMetrics().stage("read_results", "pairs");
+	filesRead.expected = files.size();
+	for (int file = 0; file < files.size(); file++){ //files are streamed one after another, pairs are numbered across all of them
+		filesRead.done.fetch_add(1, memory_order_relaxed);
+		resultsInput input;
+		if (!openResults(files, file, selection, input)){
+			cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to open " << files[file] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			continue;
+		}
+		pairReader reader = {input.data, "", false};
+		while(readNextPair(reader, text)){
+			results.clear();
+			synteny::parseMovements(text, results);
+			for (int x = 0; x < results.size(); x++){
+				synteny::movementCall& result = results[x];
+				entry.pair = total;
+				string* names[2] = {&result.subject, &result.query};
+				for (int role = SPILL_SUBJECT; role <= SPILL_QUERY; role++){
+					if (names[role]->length() > 0){ //empty IDs never match
+						entry.role = role;
+						entry.protein = *names[role];
+						entries.push_back(entry);
+						memoryUsed += SPILL_ENTRY_OVERHEAD + entry.protein.length();
+					}
+				}
+				moves.push_back(result.move);
+				total++;
+				pairsRead.done.fetch_add(1, memory_order_relaxed);
+				if (memoryUsed >= memoryLimit){
+					spilled += entries.size();
+					writeSpillRun(entries, tempDir, runFiles);
+					memoryUsed = 0;
+				}
+			}
+		}
+		if (input.file.failed()){ //e.g. a truncated .gz
+			cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to read all of " << files[file] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		}
 	}
-	if (line.find("MOVED_ADJACENT")!=string::npos){
-		return 1;
+	if (!entries.empty()){
+		spilled += entries.size();
+		writeSpillRun(entries, tempDir, runFiles);
 	}
-	if (line.find("MOVED_CONSERVED")!=string::npos){
-		return 2;
+	progressMetrics().finish(filesRead);
+	progressMetrics().finish(pairsRead);
+	progressMetrics().stage("remove_duplicates", "protein IDs").expected = spilled;
+	cout << "REMOVING DUPLICATES (" << runFiles.size() << " sorted runs)..." <<endl;
+	vector<int> subjects, queries;
+	subjects.assign(total, NO_SPILL_PROTEIN);
+	queries.assign(total, NO_SPILL_PROTEIN);
+	int proteins = mergeSpillRuns(runFiles, subjects, queries);
+	removed.assign(total, false);
+	removeNumberedDuplicates(subjects, queries, moves, proteins, removed);
+	long long count = 0;
+	for (long long x = 0; x < total; x++){
+		count += removed[x];
 	}
-	if (line.find("MOVED_MUTUAL_CONSERVED")!=string::npos){
-		return 3;
+	cout << count << " out of " << total << " total Protein pairs" <<endl;
+	return total;
+}
+
+bool spillEntryLess(const spillEntry& a, const spillEntry& b){
+	if (a.protein != b.protein){
+		return a.protein < b.protein;
 	}
+	return a.pair < b.pair;
 }
 
-void buildResult(string line, movements& result){
-	int pos=0;
-	int endPos;
-	string temp = "";
-	line =  line.substr(line.find("\t")+1); //moves past first tab
-	endPos = line.find("\t");
-	while(pos < endPos){
-		temp+=line[pos];
-		pos++;
-	}
-	result.subject = temp;
-	line = line.substr(line.find("\t")+1);//moves past subject
-	pos=0;
-	endPos = line.find("\t");
-	temp = "";
-	while(pos < endPos){
-		temp+=line[pos];
-		pos++;
-	}
-	result.query = temp;
-	line = line.substr(line.find("\t")+1); //moves past query
-	line = line.substr(0,line.find("/product=")); //doesnt include genbank product info
-	result.keg = line;
+void writeSpillRun(vector<spillEntry>& entries, string tempDir, vector<string>& runFiles){
+	sort(entries.begin(), entries.end(), spillEntryLess);
+	string fileName = tempDir + "/FormatKegResults_XXXXXX";
+	int descriptor = mkstemp(&fileName[0]);
+	FILE* run = (descriptor < 0) ? NULL : fdopen(descriptor, "wb");
+	if (run == NULL){
+		cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to create a temporary file in " << tempDir << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		exit(1);
+	}
+	//each entry: ID length, ID, pair, role
+	for (int x = 0; x < entries.size(); x++){
+		unsigned int length = entries[x].protein.length();
+		fwrite(&length, sizeof(length), 1, run);
+		fwrite(entries[x].protein.data(), 1, length, run);
+		fwrite(&entries[x].pair, sizeof(entries[x].pair), 1, run);
+		fwrite(&entries[x].role, sizeof(entries[x].role), 1, run);
+	}
+	if (fclose(run) != 0){
+		cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to write " << fileName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		exit(1);
+	}
+	runFiles.push_back(fileName);
+	entries.clear();
 }
 
+bool readSpillEntry(FILE* run, spillEntry& entry){
+	unsigned int length;
+	if (fread(&length, sizeof(length), 1, run) != 1){
+		return false;
+	}
+	entry.protein.resize(length);
+	if ((length > 0 && fread(&entry.protein[0], 1, length, run) != length) ||
+	fread(&entry.pair, sizeof(entry.pair), 1, run) != 1 || fread(&entry.role, sizeof(entry.role), 1, run) != 1){
+		return false;
+	}
+	return true;
+}
 
-void removeDuplicates(vector<movements>& proteins){
-	int count = 0;
-	int total = 0;
-	int y;
-	cout << "REMOVING DUPLICATES..." <<endl;
-	for(int x=0; x < proteins.size(); x++){ //loops through all proteins
-		total++;
-		if(proteins[x].subject.length() > 0){ //doesnt search for matches if already erased
-			y = x+1;
-			while(y < proteins.size()){ //loops through all downstream proteins //upstream ones have already been checked
-				//looks for a match
-				if ((proteins[x].subject == proteins[y].subject || proteins[x].subject == proteins[y].query || 
-				proteins[x].query == proteins[y].subject || proteins[x].query == proteins[y].subject)&& (x != y)
-				&&(proteins[x].subject.length() > 0) && (proteins[x].query.length() > 0)){
-					//erases the pair with the lower move category
-					if (proteins[y].move > proteins[x].move){
-							proteins[x].subject = "";
-							proteins[x].query = "";
-							proteins[x].move = -1;
-							proteins[x].keg = "";
-							count++;
-							if (count%1000 == 0){
-								cout << count << " removed" <<endl;
-							}
-							break;
-					}else{
-							proteins[y].subject = "";
-							proteins[y].query = "";
-							proteins[y].move = -1;
-							proteins[y].keg = "";
-							count++;
-							if (count%1000 == 0){
-								cout << count << " removed" <<endl;
-							}
-					}
-				}
-				y++;
-			}
-		
+int mergeSpillRuns(vector<string>& runFiles, vector<int>& subjects, vector<int>& queries){
+	vector<spillRun> runs(runFiles.size());
+	spillRunOrder order;
+	order.runs = &runs;
+	priority_queue<int, vector<int>, spillRunOrder> heap(order);
+	for (int x = 0; x < runs.size(); x++){
+		runs[x].file = fopen(runFiles[x].c_str(), "rb");
+		if (runs[x].file != NULL && readSpillEntry(runs[x].file, runs[x].current)){
+			heap.push(x);
 		}
-	
 	}
-	cout << count << " out of " << total << " total Protein pairs" <<endl;
+	progressStage& progress = progressMetrics().stage("remove_duplicates", "protein IDs");
+	string protein = "";
+	int proteins = 0; //IDs numbered so far, the current one is proteins-1
+	while (!heap.empty()){
+		int x = heap.top();
+		heap.pop();
+		spillEntry& current = runs[x].current;
+		if (proteins == 0 || current.protein != protein){ //next protein ID
+			protein = current.protein;
+			proteins++;
+		}
+		if (current.role == SPILL_SUBJECT){
+			subjects[current.pair] = proteins-1;
+		}else{
+			queries[current.pair] = proteins-1;
+		}
+		progress.done.fetch_add(1, memory_order_relaxed);
+		if (readSpillEntry(runs[x].file, runs[x].current)){
+			heap.push(x);
+		}
+	}
+	for (int x = 0; x < runs.size(); x++){
+		if (runs[x].file != NULL){
+			fclose(runs[x].file);
+		}
+		unlink(runFiles[x].c_str());
+	}
+	progressMetrics().finish(progress);
+	return proteins;
 }
 
-void buildTable(vector<string> categories, vector<movements> results, data& countData){
-	countData.categories = categories;
-	//adds zeros to all vector positions so specific indexes can be increased during the count
-	for(int i = 0; i < categories.size(); i++){
-			countData.notMoved.push_back(0);
-			countData.moved.push_back(0);
-			countData.movedConserved.push_back(0);
-			countData.mutualConserved.push_back(0);
+void removeNumberedDuplicates(vector<int>& subjects, vector<int>& queries, vector<int>& moves, int proteins,
+							  vector<bool>& removed){
+	long long total = moves.size();
+	//pairs listing every protein as the subject and as the query, in file order (offsets of each protein in the lists)
+	vector<long long> subjectStart(proteins+1, 0), queryStart(proteins+1, 0);
+	for (long long x = 0; x < total; x++){
+		if (subjects[x] != NO_SPILL_PROTEIN){
+			subjectStart[subjects[x]+1]++;
+		}
+		if (queries[x] != NO_SPILL_PROTEIN){
+			queryStart[queries[x]+1]++;
+		}
 	}
-	for(int x = 0; x < results.size(); x++){
-		for(int y = 0; y < categories.size(); y++){
-			//tallies matches at the indices that correspond with the category
-			if (results[x].keg.find(categories[y])!=string::npos){
-				switch (results[x].move){
-					case-1 : break;
-					case 0 : countData.notMoved[y]++;
-							 break;
-					case 1 : countData.moved[y]++;
-							 break;
-					case 2 : countData.movedConserved[y]++;
-							 break;
-					case 3 : countData.mutualConserved[y]++;
-							 break;
-				
+	for (int x = 0; x < proteins; x++){
+		subjectStart[x+1] += subjectStart[x];
+		queryStart[x+1] += queryStart[x];
+	}
+	vector<long long> subjectPairs(subjectStart[proteins]), queryPairs(queryStart[proteins]);
+	vector<long long> subjectNext(subjectStart.begin(), subjectStart.end()-1), queryNext(queryStart.begin(), queryStart.end()-1);
+	for (long long x = 0; x < total; x++){
+		if (subjects[x] != NO_SPILL_PROTEIN){
+			subjectPairs[subjectNext[subjects[x]]++] = x;
+		}
+		if (queries[x] != NO_SPILL_PROTEIN){
+			queryPairs[queryNext[queries[x]]++] = x;
+		}
+	}
+	vector<long long>().swap(subjectNext);
+	vector<long long>().swap(queryNext);
+
+	for (long long x = 0; x < total; x++){
+		if (removed[x] || subjects[x] == NO_SPILL_PROTEIN || queries[x] == NO_SPILL_PROTEIN){
+			continue;
+		}
+		//the later pairs with the subject as their subject or query and with the query as their subject
+		long long* lists[3][2] = {{subjectPairs.data() + subjectStart[subjects[x]], subjectPairs.data() + subjectStart[subjects[x]+1]},
+								  {queryPairs.data() + queryStart[subjects[x]], queryPairs.data() + queryStart[subjects[x]+1]},
+								  {subjectPairs.data() + subjectStart[queries[x]], subjectPairs.data() + subjectStart[queries[x]+1]}};
+		for (int y = 0; y < 3; y++){
+			lists[y][0] = upper_bound(lists[y][0], lists[y][1], x);
+		}
+		//walks the three lists together so the pairs are compared in file order like synteny::removeDuplicates
+		while (true){
+			long long next = -1;
+			for (int y = 0; y < 3; y++){
+				if (lists[y][0] != lists[y][1] && (next < 0 || *lists[y][0] < next)){
+					next = *lists[y][0];
+				}
+			}
+			if (next < 0){
+				break;
+			}
+			for (int y = 0; y < 3; y++){
+				if (lists[y][0] != lists[y][1] && *lists[y][0] == next){
+					lists[y][0]++;
 				}
 			}
+			if (removed[next]){
+				continue;
+			}
+			//removes the pair with the lower move category
+			if (moves[next] > moves[x]){
+				removed[x] = true;
+				break;
+			}
+			removed[next] = true;
 		}
 	}
 }
 
-
-void outputTable(data countData, ofstream& outputFile){
-	outputFile << "FUNCTION,UNMOVED,MOVED,MOVED.CONS,MUTUAL.CONS"<<endl;
-	for (int x = 0; x < countData.categories.size(); x++){
-		if(countData.categories[x] == upperCase("Folding, sorting and degradation")){ //the comma in this category messes up the comma delimiting
-			outputFile << upperCase("Folding sorting and degradation,"); //this is the same catagory title without the comma
-		}else{
-			outputFile << countData.categories[x] << ",";
+void buildTableFromStream(vector<string>& files, pairSelection& selection, vector<bool>& removed,
+						  synteny::categoryCounter& counts){
+	vector<synteny::movementCall> results;
+	string text;
+	long long pair = 0;
+	progressStage& progress = progressMetrics().stage("count", "pairs");
+	progress.expected = removed.size();
+	for (int file = 0; file < files.size(); file++){
+		resultsInput input;
+		if (!openResults(files, file, selection, input)){
+			continue;
+		}
+		pairReader reader = {input.data, "", false};
+		while(readNextPair(reader, text)){
+			results.clear();
+			synteny::parseMovements(text, results);
+			for (int x = 0; x < results.size(); x++){
+				if (pair < removed.size() && !removed[pair]){
+					counts.add(results[x]);
+				}
+				pair++;
+				progress.done.fetch_add(1, memory_order_relaxed);
+			}
 		}
-		outputFile << countData.notMoved[x] << ",";
-		outputFile << countData.moved[x] << ",";
-		outputFile << countData.movedConserved[x] << ",";
-		outputFile << countData.mutualConserved[x] << endl;
 	}
+	progressMetrics().finish(progress);
 }
 
+void countConsensus(vector<string>& files, pairSelection& selection, synteny::movementConsensus& consensus){
+	atomic<int> nextFile(0);
+	int threads = thread::hardware_concurrency();
+	if (threads < 1){
+		threads = 1;
+	}
+	if (threads > files.size()){
+		threads = files.size();
+	}
+	vector<thread> readers;
+	for (int t = 0; t < threads; t++){
+		readers.push_back(thread([&](){
+			vector<synteny::movementCall> batch;
+			string text;
+			long long pair = 0; //numbered across the files of the reader so a batch never joins two pairs
+			int x;
+			while((x = nextFile++) < files.size()){
+				resultsInput input;
+				if (!openResults(files, x, selection, input)){
+					continue; //reported when the table is built
+				}
+				pairReader reader = {input.data, "", false};
+				pair++;
+				while(readNextPair(reader, text)){
+					pair = synteny::parseMovements(text, batch, pair);
+					if (batch.size() >= CONSENSUS_BATCH){ //only whole pairs are in the batch
+						consensus.add(batch);
+						batch.clear();
+					}
+				}
+			}
+			consensus.add(batch);
+		}));
+	}
+	for (int t = 0; t < readers.size(); t++){
+		readers[t].join();
+	}
+	progressMetrics().finish(progressMetrics().stage("consensus", "pairs"));
+}
 
+void outputConsensus(synteny::movementConsensus& consensus, string fileName){
+	synteny::consensusTables tables;
+	consensus.tables(tables);
+	string familyFile = fileName;
+	if (familyFile.length() > 4 && familyFile.substr(familyFile.length()-4) == ".csv"){
+		familyFile = familyFile.substr(0, familyFile.length()-4);
+	}
+	familyFile += "_families.csv";
+	BufferedWriter proteinOutput, familyOutput;
+	if (!proteinOutput.open(fileName.c_str()) || !familyOutput.open(familyFile.c_str())){
+		cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to write " << fileName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return;
+	}
+	proteinOutput << tables.proteins;
+	familyOutput << tables.families;
+	cout << tables.proteinCount << " proteins and " << tables.familyCount << " gene families in the consensus" << endl;
+}
 
-
-
+void writeCategoryTables(synteny::categoryTables& tables, string fileName){
+	string levels[3] = {"A", "B", "C"};
+	string* text[3] = {&tables.levelA, &tables.levelB, &tables.levelC};
+	for (int level = 0; level < 3; level++){
+		if (level != 1 && text[level]->length() == 0){ //the .brkeg has no categories at this level
+			continue;
+		}
+		string levelFile = (level == 1) ? fileName : getLevelFileName(fileName, levels[level]);
+		BufferedWriter outputFile;
+		if (!outputFile.open(levelFile.c_str())){
+			cout << "!!!!!!!!!!!!!FormatKegResults ERROR:failed to write " << levelFile << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			continue;
+		}
+		outputFile << *text[level];
+	}
+}
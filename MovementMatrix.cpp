@@ -0,0 +1,895 @@
+/***************************************************************************************************
+MovementMatrix
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This stores the movement category of every protein in every pair of a genus in one file, so
+		 the category tables can be recounted for other pairs, organisms or counting rules without
+		 rerunning 'getKegResults' or parsing its text again. The matrix has a row for every protein of
+		 every organism (the rows of an organism are next to each other) and a column for every pair.
+		 A cell is the movement category (0-3, see CategoryTable.h) of the protein in the pair, packed
+		 in 2 bits, or absent. A protein listed more than once in a pair keeps its highest category.
+		 Each column is stored on its own, in whichever of these is smaller:
+		 	RAW - a bit per row marking the cells that are present, then 2 bits per row for the category
+		 	RUNS - the row where each run of equal cells (a category, or absent) ends, found with a
+		 	       binary search
+		 A column only has cells in the rows of its two organisms, so most columns are a few runs.
+		 The file is memory mapped by the queries and only the columns that are asked for are decoded.
+		 Rows keep the categories 'getKegResults' wrote for the protein. As in 'FormatKegResults',
+		 counts only use the subject of each pair (its first organism, the one the categories are from).
+		 The counts are not deduplicated like 'FormatKegResults' does: the matrix doesn't keep the query
+		 of a cell, so a protein is counted in every pair it is the subject of (once with -genes) and
+		 the numbers differ from its tables when a protein is in more than one pair.
+
+		 The organisms of a pair come from its '##' title (SUBJECT_<organism>_QUERY_<organism>_...),
+		 pairs with other titles get the organisms <title>.SUBJECT and <title>.QUERY.
+
+Commands: build <matrix> <results> - builds the matrix from the 'getKegResults' results of a genus
+		  		 (a file, a directory of kegCounts.csv or an @<list file>, as 'FormatKegResults')
+		  info <matrix> - organisms, pairs and the size of the columns
+		  row <matrix> <protein> - the category of the protein in every pair of its organism
+		  		 (the protein can be written <organism>:<protein> if the ID is in several organisms)
+		  column <matrix> <pair> - every protein of a pair with its category and its categories
+		  count <matrix> - the number of proteins in each movement category
+		  table <matrix> <.brkeg> <output .csv> - tables laid out like those of 'FormatKegResults' (B level
+		  		 to the output, A and C levels next to it if the .brkeg has them), counted without its
+		  		 removal of duplicates
+		  options: -pairs <pair,pair,...> or -pairs @<list file> (pairs named by the directory of their
+		  		   kegCounts.csv or their '##' title, default every pair)
+		  		   -genomes <organism,organism,...> or -genomes @<list file> (only pairs with one of
+		  		   these organisms as the subject)
+		  		   -genes (count and table) counts each protein once, in its highest category in the
+		  		   selected pairs, instead of once per pair
+		  		   -category <category> (count and column) only proteins in the category (a path or the
+		  		   name of any level of the BRITE tree, or UNCATEGORIZED)
+****************************************************************************************************/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <unordered_map>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "BriteTree.h"
+#include "CategoryTable.h"
+#include "ResultsIndex.h"
+
+using namespace std;
+
+const char MATRIX_MAGIC[8] = "MOVMTX1";
+const uint32_t MATRIX_RAW = 0;
+const uint32_t MATRIX_RUNS = 1;
+const uint8_t MATRIX_ABSENT = MOVEMENT_CATEGORIES; //run symbol of the rows without a cell
+
+struct matrixHeader{ //start of the file
+	char magic[8];
+	uint64_t organisms;
+	uint64_t rows;
+	uint64_t columns;
+	uint64_t namesOffset; //text with the organisms, rows and columns
+	uint64_t namesLength;
+	uint64_t columnsOffset; //matrixColumn of every column
+	uint64_t fileSize;
+};
+
+struct matrixColumn{ //directory entry of a column
+	uint64_t offset; //cells of the column, 8 byte aligned
+	uint64_t length;
+	uint32_t encoding; //MATRIX_RAW or MATRIX_RUNS
+	uint32_t present; //cells in the column
+	uint32_t counts[MOVEMENT_CATEGORIES]; //cells of each category in the rows of the subject
+};
+
+struct movementMatrix{ //a loaded (memory mapped) matrix
+	const char* data;
+	size_t size;
+	const matrixHeader* header;
+	const matrixColumn* columns;
+	int rows;
+	vector<string> organisms;
+	vector<int> organismStart; //first row of each organism, then the number of rows
+	vector<string> proteins; //by row
+	vector<string> categories; //by row, tab separated paths as written by 'getKegResults'
+	vector<int> rowOrganism;
+	vector<string> titles; //by column
+	vector<string> directories;
+	vector<int> subjects; //organism of the subject and query of each column
+	vector<int> queries;
+	unordered_map<string, vector<int> > proteinRows; //protein -> its rows
+};
+
+struct matrixBuilder{ //a matrix being read from the results
+	vector<string> organisms;
+	unordered_map<string, int> organismIDs;
+	vector<string> proteins;
+	vector<string> categories;
+	vector<int> rowOrganism;
+	unordered_map<string, int> rowIDs; //organism <tab> protein -> row
+	vector<string> titles;
+	vector<string> directories;
+	vector<int> subjects;
+	vector<int> queries;
+	vector<vector<pair<int, int> > > cells; //(row, category) of every column
+};
+
+struct matrixOptions{
+	vector<string> pairs; //upper case, empty = every pair
+	vector<string> genomes; //upper case, empty = every organism
+	string category; //upper case, empty = every protein
+	bool genes;
+};
+
+
+//reads every results file and adds its pairs as columns
+bool readResults(vector<string>& files, matrixBuilder& matrix);
+
+//splits the '##' title of a pair into the organism of the subject and the query
+void getPairOrganisms(string title, string& subject, string& query);
+
+//returns the ID of an organism, adding it if it is new
+int getOrganism(matrixBuilder& matrix, const string& name);
+
+//returns the row of a protein of an organism, adding it if it is new
+int getRow(matrixBuilder& matrix, int organism, const string& protein);
+
+//puts the rows of each organism together, encodes the columns and writes the matrix file
+bool writeMatrix(matrixBuilder& matrix, string fileName);
+
+//encodes the sorted cells of a column in the smaller encoding
+void encodeColumn(vector<pair<int, int> >& cells, int rows, matrixColumn& column, vector<uint64_t>& encoded);
+
+//maps a matrix file and reads its organisms, rows and columns. returns false if it isn't a matrix
+bool loadMatrix(string fileName, movementMatrix& matrix);
+
+//decodes the cells of rows [first, last) of a column into 'cells' (-1 = absent)
+void readColumn(movementMatrix& matrix, int column, int first, int last, vector<int8_t>& cells);
+
+//returns the columns chosen with -pairs and -genomes
+vector<int> selectColumns(movementMatrix& matrix, matrixOptions& options);
+
+//counts the subject cells of the columns for every row and category (4 counts per row). with -genes each
+//row is counted once, in its highest category. the columns are split between threads
+void countRows(movementMatrix& matrix, vector<int>& columns, bool genes, vector<int>& rowCounts);
+
+//checks if the categories of a row are in the category of -category
+bool inCategory(const string& categories, const string& category);
+
+//parses a comma separated list or an @<list file> into upper case names
+vector<string> getNameList(string input);
+
+//finds the rows of a protein (or <organism>:<protein>)
+vector<int> findProteinRows(movementMatrix& matrix, string protein);
+
+//outputs the organisms and the size of the columns
+void outputInfo(movementMatrix& matrix, BufferedWriter& out);
+
+//outputs the category of the rows of a protein in every pair of their organism
+void outputRow(movementMatrix& matrix, vector<int>& rows, BufferedWriter& out);
+
+//outputs every protein of a column with its category and categories
+void outputColumn(movementMatrix& matrix, int column, matrixOptions& options, BufferedWriter& out);
+
+
+
+int main(int argc, char *argv[]){
+	if (argc < 3){
+		cout << "missing arguments!"<< endl;
+		return 0;
+	}
+	string command = argv[1];
+	string matrixFile = argv[2];
+	if (command == "build"){
+		if (argc < 4){
+			cout << "missing arguments!"<< endl;
+			return 0;
+		}
+		vector<string> resultsFiles = getResultsFiles(argv[3]);
+		if (resultsFiles.empty()){
+			cout << "!!!!!!!!!!!!!MovementMatrix ERROR:no results found in " << argv[3] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+		matrixBuilder matrix;
+		if (!readResults(resultsFiles, matrix)){
+			return 0;
+		}
+		if (!writeMatrix(matrix, matrixFile)){
+			cout << "!!!!!!!!!!!!!MovementMatrix ERROR:failed to write " << matrixFile << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+		cout << matrix.proteins.size() << " PROTEINS OF " << matrix.organisms.size() << " ORGANISMS IN " << matrix.titles.size() << " PAIRS" << endl;
+		return 0;
+	}
+
+	//every other command reads the matrix
+	int arguments = 3; //arguments before the options
+	if (command == "row" || command == "column"){
+		arguments = 4;
+	}else if (command == "table"){
+		arguments = 5;
+	}else if (command != "info" && command != "count"){
+		cout << "unknown command: " << command << endl;
+		return 0;
+	}
+	if (argc < arguments){
+		cout << "missing arguments!"<< endl;
+		return 0;
+	}
+	matrixOptions options;
+	options.genes = false;
+	for (int i = arguments; i < argc; i++){
+		if (string(argv[i]) == "-pairs" && i+1 < argc){
+			options.pairs = getNameList(argv[++i]);
+		}else if (string(argv[i]) == "-genomes" && i+1 < argc){
+			options.genomes = getNameList(argv[++i]);
+		}else if (string(argv[i]) == "-category" && i+1 < argc){
+			options.category = argv[++i];
+			transform(options.category.begin(), options.category.end(), options.category.begin(), ::toupper);
+		}else if (string(argv[i]) == "-genes"){
+			options.genes = true;
+		}else{
+			cout << "unknown argument: " << argv[i] << endl;
+			return 0;
+		}
+	}
+	movementMatrix matrix;
+	if (!loadMatrix(matrixFile, matrix)){
+		cout << "!!!!!!!!!!!!!MovementMatrix ERROR:" << matrixFile << " is not a movement matrix!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	BufferedWriter out;
+	out.attach(stdout);
+
+	if (command == "info"){
+		outputInfo(matrix, out);
+	}else if (command == "row"){
+		vector<int> rows = findProteinRows(matrix, argv[3]);
+		if (rows.empty()){
+			cout << "!!!!!!!!!!!!!MovementMatrix ERROR:" << argv[3] << " is not in the matrix!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+		outputRow(matrix, rows, out);
+	}else if (command == "column"){
+		options.pairs = getNameList(argv[3]);
+		vector<int> columns = selectColumns(matrix, options);
+		if (columns.empty()){
+			cout << "!!!!!!!!!!!!!MovementMatrix ERROR:" << argv[3] << " is not in the matrix!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+		for (int x = 0; x < columns.size(); x++){
+			outputColumn(matrix, columns[x], options, out);
+		}
+	}else{
+		vector<int> columns = selectColumns(matrix, options);
+		if (columns.empty()){
+			cout << "!!!!!!!!!!!!!MovementMatrix ERROR:none of the pairs were selected!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+		vector<int> rowCounts;
+		countRows(matrix, columns, options.genes, rowCounts);
+		if (command == "count"){
+			long long counts[MOVEMENT_CATEGORIES] = {0, 0, 0, 0};
+			for (int row = 0; row < matrix.rows; row++){
+				if (options.category == "" || inCategory(matrix.categories[row], options.category)){
+					for (int move = 0; move < MOVEMENT_CATEGORIES; move++){
+						counts[move] += rowCounts[row*MOVEMENT_CATEGORIES + move];
+					}
+				}
+			}
+			out << "CATEGORY\tPAIRS\tUNMOVED\tMOVED\tMOVED.CONS\tMUTUAL.CONS\n";
+			out << ((options.category == "") ? "ALL" : options.category) << "\t" << (int)columns.size();
+			for (int move = 0; move < MOVEMENT_CATEGORIES; move++){
+				out << "\t" << counts[move];
+			}
+			out << "\n";
+		}else{
+			CompressedInput kegFile; //inputs may be gzip or zstd compressed
+			kegFile.open(argv[3]);
+			if (!kegFile.is_open()){
+				cout << "!!!!!!!!!!!!!MovementMatrix ERROR:failed to open " << argv[3] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+				return 0;
+			}
+			briteTree kegTree;
+			parseBriteTree(kegFile, kegTree);
+			if (kegFile.failed()){
+				cout << "!!!!!!!!!!!!!MovementMatrix ERROR:failed to read " << argv[3] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+				return 1;
+			}
+			briteCounts counts;
+			initBriteCounts(kegTree, counts);
+			vector<int> nodes;
+			for (int row = 0; row < matrix.rows; row++){
+				for (int move = 0; move < MOVEMENT_CATEGORIES; move++){
+					int count = rowCounts[row*MOVEMENT_CATEGORIES + move];
+					if (count > 0){
+						countCategories(kegTree, matrix.categories[row], move, counts, nodes, count);
+					}
+				}
+			}
+			outputCategoryTables(kegTree, counts, argv[4]);
+		}
+	}
+	out.close();
+	munmap((void*)matrix.data, matrix.size);
+	return 0;
+}
+
+bool readResults(vector<string>& files, matrixBuilder& matrix){
+	for (int file = 0; file < files.size(); file++){
+		CompressedInput data; //inputs may be gzip or zstd compressed
+		data.open(files[file].c_str());
+		if (!data.is_open()){
+			cout << "!!!!!!!!!!!!!MovementMatrix ERROR:failed to open " << files[file] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return false;
+		}
+		string directory = filesystem::path(files[file]).parent_path().filename().string();
+		int column = -1;
+		int move = -1;
+		bool inSection = false;
+		string line;
+		while (getline(data, line)){
+			if (line.compare(0, 2, "##") == 0 || (column < 0 && line.find("!!") != string::npos)){
+				//a new pair (results without a title are named by their file)
+				string title = (line.compare(0, 2, "##") == 0) ? line.substr(2) : files[file];
+				string subject, query;
+				getPairOrganisms(title, subject, query);
+				matrix.titles.push_back(title);
+				matrix.directories.push_back(directory);
+				matrix.subjects.push_back(getOrganism(matrix, subject));
+				matrix.queries.push_back(getOrganism(matrix, query));
+				matrix.cells.push_back(vector<pair<int, int> >());
+				column = matrix.titles.size()-1;
+				if (line.compare(0, 2, "##") == 0){
+					continue;
+				}
+			}
+			if (inSection && line.find("$$") != string::npos){ //'$$' indicates a line containing data
+				//$$ <tab> subject <tab> query <tab> categories /product=...
+				size_t subjectStart = line.find("\t");
+				size_t queryStart = (subjectStart == string::npos) ? string::npos : line.find("\t", subjectStart+1);
+				size_t kegStart = (queryStart == string::npos) ? string::npos : line.find("\t", queryStart+1);
+				if (kegStart != string::npos){
+					string subject = line.substr(subjectStart+1, queryStart-subjectStart-1);
+					string query = line.substr(queryStart+1, kegStart-queryStart-1);
+					string keg = line.substr(kegStart+1);
+					keg = keg.substr(0, keg.find("/product=")); //doesnt include genbank product info
+					while (keg.length() > 0 && (keg[keg.length()-1] == '\t' || keg[keg.length()-1] == ' ')){
+						keg.erase(keg.length()-1);
+					}
+					int subjectRow = getRow(matrix, matrix.subjects[column], subject);
+					int queryRow = getRow(matrix, matrix.queries[column], query);
+					if (matrix.categories[subjectRow] == ""){
+						matrix.categories[subjectRow] = keg;
+					}
+					matrix.cells[column].push_back(make_pair(subjectRow, move));
+					matrix.cells[column].push_back(make_pair(queryRow, move));
+				}
+			}
+			if (line.find("**") != string::npos){ //'**' indicates the end of the results
+				inSection = false;
+			}else if (line.find("!!") != string::npos){ //indicates movement category line
+				move = -1;
+				for (int x = 0; x < MOVEMENT_CATEGORIES; x++){
+					if (line.find(string("!!") + MOVEMENT_SECTIONS[x] + "!!") != string::npos){
+						move = x;
+					}
+				}
+				inSection = (move >= 0);
+			}
+		}
+		if (data.failed()){
+			cout << "!!!!!!!!!!!!!MovementMatrix ERROR:failed to read " << files[file] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void getPairOrganisms(string title, string& subject, string& query){
+	const string subjectMark = "SUBJECT_";
+	const string queryMark = "_QUERY_";
+	const string suffix = "_MOVEMENTRESULTS.CSV";
+	transform(title.begin(), title.end(), title.begin(), ::toupper);
+	size_t queryStart = title.find(queryMark);
+	if (title.compare(0, subjectMark.length(), subjectMark) != 0 || queryStart == string::npos){
+		subject = title + ".SUBJECT";
+		query = title + ".QUERY";
+		return;
+	}
+	subject = title.substr(subjectMark.length(), queryStart-subjectMark.length());
+	query = title.substr(queryStart+queryMark.length());
+	if (query.length() > suffix.length() && query.compare(query.length()-suffix.length(), suffix.length(), suffix) == 0){
+		query = query.substr(0, query.length()-suffix.length());
+	}
+}
+
+int getOrganism(matrixBuilder& matrix, const string& name){
+	unordered_map<string, int>::iterator found = matrix.organismIDs.find(name);
+	if (found != matrix.organismIDs.end()){
+		return found->second;
+	}
+	matrix.organisms.push_back(name);
+	matrix.organismIDs[name] = matrix.organisms.size()-1;
+	return matrix.organisms.size()-1;
+}
+
+int getRow(matrixBuilder& matrix, int organism, const string& protein){
+	string key = matrix.organisms[organism] + "\t" + protein;
+	unordered_map<string, int>::iterator found = matrix.rowIDs.find(key);
+	if (found != matrix.rowIDs.end()){
+		return found->second;
+	}
+	matrix.proteins.push_back(protein);
+	matrix.categories.push_back("");
+	matrix.rowOrganism.push_back(organism);
+	matrix.rowIDs[key] = matrix.proteins.size()-1;
+	return matrix.proteins.size()-1;
+}
+
+bool writeMatrix(matrixBuilder& matrix, string fileName){
+	//rows are ordered by organism, in the order they were first seen within each organism
+	int rows = matrix.proteins.size();
+	vector<int> order(rows);
+	for (int x = 0; x < rows; x++){
+		order[x] = x;
+	}
+	stable_sort(order.begin(), order.end(), [&](int a, int b){ return matrix.rowOrganism[a] < matrix.rowOrganism[b]; });
+	vector<int> newRow(rows);
+	for (int x = 0; x < rows; x++){
+		newRow[order[x]] = x;
+	}
+	vector<int> organismStart(matrix.organisms.size()+1, 0);
+	for (int x = 0; x < rows; x++){
+		organismStart[matrix.rowOrganism[x]+1]++;
+	}
+	for (int x = 0; x < matrix.organisms.size(); x++){
+		organismStart[x+1] += organismStart[x];
+	}
+
+	//organism <tab> first row <tab> rows, then protein <tab> categories of every row, then
+	//title <tab> directory <tab> subject <tab> query of every column
+	string names;
+	for (int x = 0; x < matrix.organisms.size(); x++){
+		names += matrix.organisms[x] + "\t" + to_string(organismStart[x]) + "\t" + to_string(organismStart[x+1]-organismStart[x]) + "\n";
+	}
+	for (int x = 0; x < rows; x++){
+		names += matrix.proteins[order[x]] + "\t" + matrix.categories[order[x]] + "\n";
+	}
+	for (int x = 0; x < matrix.titles.size(); x++){
+		names += matrix.titles[x] + "\t" + matrix.directories[x] + "\t" + to_string(matrix.subjects[x]) + "\t" + to_string(matrix.queries[x]) + "\n";
+	}
+
+	matrixHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MATRIX_MAGIC, sizeof(header.magic));
+	header.organisms = matrix.organisms.size();
+	header.rows = rows;
+	header.columns = matrix.titles.size();
+	header.namesOffset = sizeof(header);
+	header.namesLength = names.length();
+	header.columnsOffset = (header.namesOffset + header.namesLength + 7) & ~(uint64_t)7;
+
+	vector<matrixColumn> columns(header.columns);
+	vector<vector<uint64_t> > encoded(header.columns);
+	uint64_t offset = header.columnsOffset + header.columns*sizeof(matrixColumn);
+	for (int x = 0; x < header.columns; x++){
+		vector<pair<int, int> >& cells = matrix.cells[x];
+		for (int y = 0; y < cells.size(); y++){
+			cells[y].first = newRow[cells[y].first];
+		}
+		//a protein listed more than once keeps its highest category (the last of its row once sorted)
+		sort(cells.begin(), cells.end());
+		int kept = 0;
+		for (int y = 0; y < cells.size(); y++){
+			if (y+1 == cells.size() || cells[y].first != cells[y+1].first){
+				cells[kept++] = cells[y];
+			}
+		}
+		cells.resize(kept);
+		encodeColumn(cells, rows, columns[x], encoded[x]);
+		memset(columns[x].counts, 0, sizeof(columns[x].counts));
+		for (int y = 0; y < cells.size(); y++){
+			int row = cells[y].first;
+			if (row >= organismStart[matrix.subjects[x]] && row < organismStart[matrix.subjects[x]+1]){
+				columns[x].counts[cells[y].second]++;
+			}
+		}
+		columns[x].offset = offset;
+		offset += columns[x].length;
+		vector<pair<int, int> >().swap(cells);
+	}
+	header.fileSize = offset;
+
+	//written under a temporary name so a matrix that is being queried is never read half written
+	string tempName = fileName + ".tmp";
+	BufferedWriter out;
+	if (!out.open(tempName.c_str())){
+		return false;
+	}
+	const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	out.write((const char*)&header, sizeof(header));
+	out.write(names.data(), names.length());
+	out.write(padding, header.columnsOffset - header.namesOffset - header.namesLength);
+	out.write((const char*)&columns[0], columns.size()*sizeof(matrixColumn));
+	for (int x = 0; x < columns.size(); x++){
+		out.write((const char*)&encoded[x][0], columns[x].length);
+	}
+	out.close();
+	return rename(tempName.c_str(), fileName.c_str()) == 0;
+}
+
+void encodeColumn(vector<pair<int, int> >& cells, int rows, matrixColumn& column, vector<uint64_t>& encoded){
+	column.present = cells.size();
+	//runs of equal cells, each one ends at the first row after it
+	vector<uint32_t> ends;
+	vector<uint8_t> symbols;
+	int row = 0;
+	for (int x = 0; x <= cells.size(); x++){
+		int next = (x < cells.size()) ? cells[x].first : rows;
+		if (next > row){ //absent rows before the cell
+			if (!symbols.empty() && symbols.back() == MATRIX_ABSENT){
+				ends.back() = next;
+			}else{
+				ends.push_back(next);
+				symbols.push_back(MATRIX_ABSENT);
+			}
+		}
+		if (x == cells.size()){
+			break;
+		}
+		if (!symbols.empty() && symbols.back() == cells[x].second){
+			ends.back() = next+1;
+		}else{
+			ends.push_back(next+1);
+			symbols.push_back(cells[x].second);
+		}
+		row = next+1;
+	}
+	size_t bitmapWords = (rows+63)/64;
+	size_t rawLength = (bitmapWords + (rows+31)/32)*8;
+	size_t runsLength = (4 + ends.size()*5 + 7) & ~(size_t)7;
+	if (runsLength < rawLength){
+		//run count, the end of every run, then the symbol of every run
+		column.encoding = MATRIX_RUNS;
+		column.length = runsLength;
+		encoded.assign(runsLength/8, 0);
+		char* data = (char*)&encoded[0];
+		uint32_t runs = ends.size();
+		memcpy(data, &runs, 4);
+		memcpy(data+4, &ends[0], ends.size()*4);
+		memcpy(data+4+ends.size()*4, &symbols[0], symbols.size());
+	}else{
+		column.encoding = MATRIX_RAW;
+		column.length = rawLength;
+		encoded.assign(rawLength/8, 0);
+		for (int x = 0; x < cells.size(); x++){
+			int cell = cells[x].first;
+			encoded[cell/64] |= (uint64_t)1 << (cell%64);
+			encoded[bitmapWords + cell/32] |= (uint64_t)cells[x].second << ((cell%32)*2);
+		}
+	}
+}
+
+bool loadMatrix(string fileName, movementMatrix& matrix){
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0){
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size < sizeof(matrixHeader)){
+		close(file);
+		return false;
+	}
+	void* data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (data == MAP_FAILED){
+		return false;
+	}
+	matrix.data = (const char*)data;
+	matrix.size = info.st_size;
+	matrix.header = (const matrixHeader*)data;
+	const matrixHeader& header = *matrix.header;
+	if (memcmp(header.magic, MATRIX_MAGIC, sizeof(header.magic)) != 0 || header.fileSize != info.st_size){
+		munmap(data, info.st_size);
+		return false;
+	}
+	matrix.columns = (const matrixColumn*)(matrix.data + header.columnsOffset);
+	matrix.rows = header.rows;
+
+	istringstream names(string(matrix.data + header.namesOffset, header.namesLength));
+	string line;
+	matrix.organismStart.assign(header.organisms+1, 0);
+	for (int x = 0; x < header.organisms && getline(names, line); x++){
+		size_t start = line.find("\t");
+		size_t rows = line.find("\t", start+1);
+		matrix.organisms.push_back(line.substr(0, start));
+		matrix.organismStart[x] = atoi(line.c_str() + start+1);
+		matrix.organismStart[x+1] = matrix.organismStart[x] + atoi(line.c_str() + rows+1);
+		matrix.rowOrganism.insert(matrix.rowOrganism.end(), matrix.organismStart[x+1]-matrix.organismStart[x], x);
+	}
+	for (int x = 0; x < header.rows && getline(names, line); x++){
+		size_t end = line.find("\t");
+		matrix.proteins.push_back(line.substr(0, end));
+		matrix.categories.push_back(line.substr(end+1));
+		matrix.proteinRows[matrix.proteins.back()].push_back(x);
+	}
+	for (int x = 0; x < header.columns && getline(names, line); x++){
+		size_t directory = line.find("\t");
+		size_t subject = line.find("\t", directory+1);
+		size_t query = line.find("\t", subject+1);
+		matrix.titles.push_back(line.substr(0, directory));
+		matrix.directories.push_back(line.substr(directory+1, subject-directory-1));
+		matrix.subjects.push_back(atoi(line.c_str() + subject+1));
+		matrix.queries.push_back(atoi(line.c_str() + query+1));
+	}
+	return matrix.proteins.size() == header.rows && matrix.titles.size() == header.columns;
+}
+
+void readColumn(movementMatrix& matrix, int column, int first, int last, vector<int8_t>& cells){
+	cells.assign(last-first, -1);
+	const matrixColumn& entry = matrix.columns[column];
+	const char* data = matrix.data + entry.offset;
+	if (entry.encoding == MATRIX_RAW){
+		const uint64_t* present = (const uint64_t*)data;
+		const uint64_t* codes = present + (matrix.rows+63)/64;
+		for (int row = first; row < last; row++){
+			if ((present[row/64] >> (row%64)) & 1){
+				cells[row-first] = (codes[row/32] >> ((row%32)*2)) & 3;
+			}
+		}
+		return;
+	}
+	uint32_t runs;
+	memcpy(&runs, data, 4);
+	const uint32_t* ends = (const uint32_t*)(data+4);
+	const uint8_t* symbols = (const uint8_t*)(data+4+runs*4);
+	//first run that ends after the first row
+	int run = upper_bound(ends, ends+runs, (uint32_t)first) - ends;
+	for (int row = first; row < last && run < runs; run++){
+		int end = min((int)ends[run], last);
+		if (symbols[run] != MATRIX_ABSENT){
+			fill(cells.begin()+(row-first), cells.begin()+(end-first), (int8_t)symbols[run]);
+		}
+		row = end;
+	}
+}
+
+vector<int> selectColumns(movementMatrix& matrix, matrixOptions& options){
+	const string suffix = "_MOVEMENTRESULTS.CSV";
+	vector<int> columns;
+	for (int x = 0; x < matrix.titles.size(); x++){
+		if (!options.pairs.empty()){
+			string title = matrix.titles[x];
+			transform(title.begin(), title.end(), title.begin(), ::toupper);
+			string shortTitle = title;
+			if (shortTitle.length() > suffix.length() && shortTitle.compare(shortTitle.length()-suffix.length(), suffix.length(), suffix) == 0){
+				shortTitle = shortTitle.substr(0, shortTitle.length()-suffix.length());
+			}
+			string directory = matrix.directories[x];
+			transform(directory.begin(), directory.end(), directory.begin(), ::toupper);
+			if (find(options.pairs.begin(), options.pairs.end(), title) == options.pairs.end() &&
+				find(options.pairs.begin(), options.pairs.end(), shortTitle) == options.pairs.end() &&
+				find(options.pairs.begin(), options.pairs.end(), directory) == options.pairs.end()){
+				continue;
+			}
+		}
+		if (!options.genomes.empty() && find(options.genomes.begin(), options.genomes.end(), matrix.organisms[matrix.subjects[x]]) == options.genomes.end()){
+			continue;
+		}
+		columns.push_back(x);
+	}
+	return columns;
+}
+
+void countRows(movementMatrix& matrix, vector<int>& columns, bool genes, vector<int>& rowCounts){
+	int threads = thread::hardware_concurrency();
+	if (threads < 1){
+		threads = 1;
+	}
+	if (threads > columns.size()){
+		threads = columns.size();
+	}
+	//each thread counts the columns it takes into its own counts (or highest categories with -genes)
+	vector<vector<int> > threadCounts(threads);
+	atomic<int> nextColumn(0);
+	vector<thread> counters;
+	for (int t = 0; t < threads; t++){
+		counters.push_back(thread([&, t](){
+			vector<int>& counts = threadCounts[t];
+			counts.assign(genes ? matrix.rows : matrix.rows*MOVEMENT_CATEGORIES, genes ? -1 : 0);
+			vector<int8_t> cells;
+			int x;
+			while ((x = nextColumn++) < columns.size()){
+				int subject = matrix.subjects[columns[x]];
+				int first = matrix.organismStart[subject];
+				readColumn(matrix, columns[x], first, matrix.organismStart[subject+1], cells);
+				for (int y = 0; y < cells.size(); y++){
+					if (cells[y] < 0){
+						continue;
+					}
+					if (genes){
+						counts[first+y] = max(counts[first+y], (int)cells[y]);
+					}else{
+						counts[(first+y)*MOVEMENT_CATEGORIES + cells[y]]++;
+					}
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < counters.size(); t++){
+		counters[t].join();
+	}
+	rowCounts.assign(matrix.rows*MOVEMENT_CATEGORIES, 0);
+	for (int row = 0; row < matrix.rows; row++){
+		int highest = -1;
+		for (int t = 0; t < threads; t++){
+			if (genes){
+				highest = max(highest, threadCounts[t][row]);
+			}else{
+				for (int move = 0; move < MOVEMENT_CATEGORIES; move++){
+					rowCounts[row*MOVEMENT_CATEGORIES + move] += threadCounts[t][row*MOVEMENT_CATEGORIES + move];
+				}
+			}
+		}
+		if (highest >= 0){
+			rowCounts[row*MOVEMENT_CATEGORIES + highest] = 1;
+		}
+	}
+}
+
+bool inCategory(const string& categories, const string& category){
+	size_t start = 0;
+	bool categorized = false;
+	while (start < categories.length()){
+		size_t end = categories.find("\t", start);
+		if (end == string::npos){
+			end = categories.length();
+		}
+		string path = categories.substr(start, end-start);
+		start = end+1;
+		if (path.length() == 0 || path == "UNCATEGORIZED"){
+			continue;
+		}
+		categorized = true;
+		//the whole path, a path from the top of the tree or the name of any level
+		if (path == category || path.compare(0, category.length()+1, category + BRITE_PATH_SEPARATOR) == 0){
+			return true;
+		}
+		size_t nameStart = 0;
+		while (nameStart <= path.length()){
+			size_t nameEnd = path.find(BRITE_PATH_SEPARATOR, nameStart);
+			if (nameEnd == string::npos){
+				nameEnd = path.length();
+			}
+			if (path.compare(nameStart, nameEnd-nameStart, category) == 0){
+				return true;
+			}
+			nameStart = nameEnd+1;
+		}
+	}
+	return !categorized && category == "UNCATEGORIZED";
+}
+
+vector<string> getNameList(string input){
+	vector<string> names;
+	string name;
+	if (input.length() > 1 && input[0] == '@'){ //list file, one name per line
+		ifstream list(input.substr(1).c_str());
+		while(getline(list, name)){
+			if (name.length() > 0){
+				names.push_back(name);
+			}
+		}
+	}else{
+		stringstream list(input);
+		while(getline(list, name, ',')){
+			if (name.length() > 0){
+				names.push_back(name);
+			}
+		}
+	}
+	for (int x = 0; x < names.size(); x++){
+		transform(names[x].begin(), names[x].end(), names[x].begin(), ::toupper);
+	}
+	return names;
+}
+
+vector<int> findProteinRows(movementMatrix& matrix, string protein){
+	unordered_map<string, vector<int> >::iterator found = matrix.proteinRows.find(protein);
+	if (found != matrix.proteinRows.end()){
+		return found->second;
+	}
+	vector<int> rows;
+	size_t separator = protein.find(":");
+	if (separator == string::npos){
+		return rows;
+	}
+	string organism = protein.substr(0, separator);
+	transform(organism.begin(), organism.end(), organism.begin(), ::toupper);
+	found = matrix.proteinRows.find(protein.substr(separator+1));
+	if (found != matrix.proteinRows.end()){
+		for (int x = 0; x < found->second.size(); x++){
+			if (matrix.organisms[matrix.rowOrganism[found->second[x]]] == organism){
+				rows.push_back(found->second[x]);
+			}
+		}
+	}
+	return rows;
+}
+
+void outputInfo(movementMatrix& matrix, BufferedWriter& out){
+	long long bytes[2] = {0, 0};
+	int encodings[2] = {0, 0};
+	long long cells = 0;
+	for (int x = 0; x < matrix.titles.size(); x++){
+		int encoding = (matrix.columns[x].encoding == MATRIX_RAW) ? 0 : 1;
+		encodings[encoding]++;
+		bytes[encoding] += matrix.columns[x].length;
+		cells += matrix.columns[x].present;
+	}
+	out << "ORGANISMS\t" << (int)matrix.organisms.size() << "\n";
+	out << "PROTEINS\t" << matrix.rows << "\n";
+	out << "PAIRS\t" << (int)matrix.titles.size() << "\n";
+	out << "CELLS\t" << cells << "\n";
+	out << "RAW COLUMNS\t" << encodings[0] << "\t" << bytes[0] << " bytes\n";
+	out << "RUNS COLUMNS\t" << encodings[1] << "\t" << bytes[1] << " bytes\n";
+	out << "FILE\t" << (long long)matrix.size << " bytes\n";
+	out << "ORGANISM\tPROTEINS\tPAIRS AS SUBJECT\tPAIRS AS QUERY\n";
+	for (int x = 0; x < matrix.organisms.size(); x++){
+		int subject = count(matrix.subjects.begin(), matrix.subjects.end(), x);
+		int query = count(matrix.queries.begin(), matrix.queries.end(), x);
+		out << matrix.organisms[x] << "\t" << matrix.organismStart[x+1]-matrix.organismStart[x] << "\t" << subject << "\t" << query << "\n";
+	}
+}
+
+void outputRow(movementMatrix& matrix, vector<int>& rows, BufferedWriter& out){
+	out << "ORGANISM\tPROTEIN\tPAIR\tSIDE\tMOVEMENT\n";
+	vector<int8_t> cells;
+	for (int x = 0; x < rows.size(); x++){
+		int organism = matrix.rowOrganism[rows[x]];
+		for (int column = 0; column < matrix.titles.size(); column++){
+			if (matrix.subjects[column] != organism && matrix.queries[column] != organism){
+				continue;
+			}
+			readColumn(matrix, column, rows[x], rows[x]+1, cells);
+			out << matrix.organisms[organism] << "\t" << matrix.proteins[rows[x]] << "\t" << matrix.titles[column] << "\t";
+			out << ((matrix.subjects[column] == organism) ? "SUBJECT" : "QUERY") << "\t";
+			out << ((cells[0] < 0) ? "ABSENT" : MOVEMENT_SECTIONS[cells[0]]) << "\n";
+		}
+	}
+}
+
+void outputColumn(movementMatrix& matrix, int column, matrixOptions& options, BufferedWriter& out){
+	out << "##" << matrix.titles[column] << "\n";
+	out << "ORGANISM\tPROTEIN\tSIDE\tMOVEMENT\tCATEGORIES\n";
+	vector<int8_t> cells;
+	int organisms[2] = {matrix.subjects[column], matrix.queries[column]};
+	for (int side = 0; side < 2; side++){
+		if (side == 1 && organisms[1] == organisms[0]){
+			break;
+		}
+		int first = matrix.organismStart[organisms[side]];
+		readColumn(matrix, column, first, matrix.organismStart[organisms[side]+1], cells);
+		for (int y = 0; y < cells.size(); y++){
+			if (cells[y] < 0 || (options.category != "" && !inCategory(matrix.categories[first+y], options.category))){
+				continue;
+			}
+			out << matrix.organisms[organisms[side]] << "\t" << matrix.proteins[first+y] << "\t";
+			out << ((side == 0) ? "SUBJECT" : "QUERY") << "\t" << MOVEMENT_SECTIONS[cells[y]] << "\t";
+			out << matrix.categories[first+y] << "\n";
+		}
+	}
+}
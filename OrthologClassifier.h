@@ -0,0 +1,909 @@
+/***************************************************************************************************
+OrthologClassifier
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is the ortholog matching and movement classification of 'CompareOrthologs', shared with
+		 'SyntenyDaemon' so both classify a genome pair the same way:
+		 	matching - each subject protein (fasta position) is matched to a query protein using the
+		 	           blast results (best percent identity, or one-to-one with -onetoone)
+		 	moved - fewer than nearbyProteinCutoff of the checkRange matched proteins on each side
+		 	        are within rangeCutoff of the match in the query
+		 	conserved - the neighbours of a moved protein are found together somewhere in the query
+		 	synteny blocks - collinear runs of matches, the alternative classification of -blocks
+		 Positions are ranks in the fastas. Each replicon (genomeSegments) is treated as circular.
+****************************************************************************************************/
+#ifndef ORTHOLOG_CLASSIFIER_H
+#define ORTHOLOG_CLASSIFIER_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <utility>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+#include <climits>
+#include <map>
+#include <unordered_map>
+#include <queue>
+#include <functional>
+#include <array>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#include "FastaIndex.h"
+#include "ProgressMetrics.h"
+
+struct classifierParams{ //settings of the neighbour classification, the defaults are the constants below
+	int checkRange; //number of upstream and downstream proteins to check for differences (-checkrange)
+	int rangeCutoff; //divergence from the checked protein that can still be considered a nearby protein (-rangecutoff)
+	double nearbyProteinCutoff; //cutoff for fraction of different nearby proteins for a protein that hasn't moved (-nearbycutoff)
+};
+
+//adjacent proteins of one subject protein. when the window size is known at compile time (FIXED_RANGE > 0)
+//the window is a std::array so the loops over it are unrolled and kept in registers.
+//neighbourWindow<0> is the generic window sized at runtime
+template <int FIXED_RANGE> struct neighbourWindow{
+	std::array<int, FIXED_RANGE*2> values;
+	void resize(int){} //always FIXED_RANGE*2
+};
+
+template <> struct neighbourWindow<0>{
+	std::vector<int> values;
+	void resize(int size){ values.resize(size); }
+};
+
+struct adjacencyWindows{ //neighbour windows for every subject protein laid out for the batch classifier
+	int columns; //number of subject proteins, padded to a multiple of the SIMD width
+	std::vector<int32_t> neighbours; //column-major: row = neighbour slot (checkRange*2 rows), column = subject protein
+	std::vector<int32_t> minVal; //lower bound of the circular range each column is compared against
+	std::vector<int32_t> maxVal; //upper bound of the circular range each column is compared against
+};
+
+struct blastHit{ //one line of the blast results
+	int subject; //position of the subject protein in the subject fasta (NO_PROTEIN if it isn't in the fasta)
+	int query; //position of the query protein in the query fasta (NO_PROTEIN if it isn't in the fasta)
+	double percentIdentity;
+};
+
+struct genomeSegments{ //replicons (chromosome, plasmids) of a genome as ranges of fasta positions
+	std::vector<int> starts; //first fasta position of each replicon, followed by the number of proteins
+	std::vector<int> segmentOf; //fasta position -> replicon
+};
+
+struct flowEdge{ //edge of the residual graph used by the one-to-one assignment
+	int to;
+	int capacity;
+	long long cost; //negative scaled percent identity for subject -> query edges
+	int reverse; //index of the opposite edge in the adjacency list of 'to'
+};
+
+struct syntenyBlock{ //a run of collinear matched proteins shared by both genomes
+	int subjectStart, subjectEnd; //first and last subject protein (subjectEnd < subjectStart if the block wraps around the chromosome)
+	int queryStart, queryEnd; //query positions matched to subjectStart and subjectEnd
+	int orientation; //1 = same direction, -1 = inverted, 0 = single protein
+	int anchors; //number of matched proteins chained into the block
+	int lastRank; //position of the last anchor in the list of matched subject proteins (used while chaining)
+};
+
+struct blockIndex{ //synteny blocks of one genome pair with a lookup table by subject position
+	std::vector<syntenyBlock> blocks;
+	std::vector<int> blockOf; //subject protein -> block it was chained into (NO_PROTEIN if it is in no block)
+	std::vector<std::pair<int, int> > intervals; //subject [start, end] of every block (wrapping blocks are split in two), sorted by start
+	std::vector<int> maxEnd; //running maximum of the interval ends, bounds the backwards scan of a lookup
+};
+
+const int CHECK_RANGE = 5; //number of upstream and downstream proteins to check for differences
+const int RANGE_CUTOFF = 5; //divergence from the checked protein that can still be considered a nearby protein // lower = more classified as moved
+const int MAX_CHECK_RANGE = 1000; //largest window accepted on the command line
+
+const double NEARBY_PROTEIN_CUTOFF = 0.3; //cutoff for fraction of different nearby proteins for a protein that hasn't moved //lower = less classified as moved
+const double PERCENT_IDENTITY_CUTOFF = 50.0; //lowest acceptable percent identity for matches
+const int NO_PROTEIN = -1; //indicates no protein match in vectors of match positions
+const int MIN_BLOCK_ANCHORS = CHECK_RANGE; //fewest collinear proteins that make up a conserved synteny block
+const double IDENTITY_SCALE = 1000.0; //percent identities are matched as integers (3 decimal places)
+#if defined(__AVX2__)
+const int SIMD_WIDTH = 8; //int32 lanes per AVX2 register
+#elif defined(__SSE4_1__)
+const int SIMD_WIDTH = 4; //int32 lanes per SSE register
+#else
+const int SIMD_WIDTH = 1;
+#endif
+
+//takes the index of a fasta file and generates a vector of all of the proteinIDs
+inline std::vector<std::string> getProteinIDs(fastaIndex& fasta){
+	std::vector<std::string> proteinIDs(fasta.records.size());
+	for (int x = 0; x < fasta.records.size(); x++){
+		proteinIDs[x] = fasta.records[x].id;
+	}
+	return proteinIDs;
+}
+
+//parses the replicon out of a proteinID (the text between 'lcl|' and '_prot_'), "" if there is none
+inline std::string getRepliconName(std::string proteinID){
+	int start = proteinID.find("lcl|");
+	int end = proteinID.find("_prot_");
+	if (start == std::string::npos || end == std::string::npos || end < start){
+		return "";
+	}
+	return proteinID.substr(start+4, end-start-4);
+}
+
+//splits the proteins of a genome into replicons using the fasta headers (lcl|<replicon>_prot_...)
+//consecutive proteins of the same replicon form a segment. if splitReplicons is false (or the headers
+//have no replicon) the whole genome is one circular segment
+inline void buildGenomeSegments(std::vector<std::string>& proteinIDs, bool splitReplicons, genomeSegments& segments){
+	segments.starts.clear();
+	segments.segmentOf.assign(proteinIDs.size(), 0);
+	std::string current = "";
+	for (int x = 0; x < proteinIDs.size(); x++){
+		std::string replicon = splitReplicons ? getRepliconName(proteinIDs[x]) : "";
+		if (x == 0 || replicon != current){ //starts a new segment
+			segments.starts.push_back(x);
+			current = replicon;
+		}
+		segments.segmentOf[x] = segments.starts.size()-1;
+	}
+	segments.starts.push_back(proteinIDs.size());
+}
+
+//parses out the percent Identity of a given match from the blast results
+inline double getPercentIdentity(std::string line){
+	int pos = line.rfind("\t");
+	std::string pIdent = "";
+	while ((line[pos] < line.length()) && (pIdent.length() <6)){
+		pIdent+=line[pos];
+		pos++;
+	}
+	return atof(pIdent.c_str());
+	
+	
+}
+
+//reads the blast results once and converts the subject and query proteinIDs of every line to fasta positions
+inline void parseBlastHits(std::istream& blast, std::vector<std::string>& subjectFastaProteins, std::vector<std::string>& queryFastaProteins, std::vector<blastHit>& hits){
+	std::unordered_map<std::string, int> subjectPositions, queryPositions; //proteinID -> position in the fasta
+	for (int x = subjectFastaProteins.size()-1; x >= 0; x--){ //the first position is kept for repeated IDs
+		subjectPositions[subjectFastaProteins[x]] = x;
+	}
+	for (int x = queryFastaProteins.size()-1; x >= 0; x--){
+		queryPositions[queryFastaProteins[x]] = x;
+	}
+	blastHit hit;
+	std::string query, subject;
+	std::unordered_map<std::string, int>::iterator found;
+	progressStage& parsed = progressMetrics().stage("parse_hits", "hits");
+	long long unreported = 0; //hits not added to the progress yet (added in batches)
+	for (std::string line; std::getline(blast, line);){
+		if (++unreported == 4096){
+			parsed.done.fetch_add(unreported, std::memory_order_relaxed);
+			unreported = 0;
+		}
+		int pos = line.find("\t");
+		query = line.substr(0, pos);
+		pos++; //beginging of subject proteinID
+		int endPos = pos;
+		while((endPos < line.length()) && (line[endPos] != '\t') && (line[endPos] != ' ')){
+			endPos++;
+		}
+		subject = line.substr(pos, endPos-pos);
+		found = subjectPositions.find(subject);
+		hit.subject = (found == subjectPositions.end()) ? NO_PROTEIN : found->second;
+		found = queryPositions.find(query);
+		hit.query = (found == queryPositions.end()) ? NO_PROTEIN : found->second;
+		hit.percentIdentity = getPercentIdentity(line);
+		hits.push_back(hit);
+	}
+	parsed.done.fetch_add(unreported, std::memory_order_relaxed);
+}
+
+//generates a vector of positions where the index corresponds to the protein in the subject fasta and the value
+//corresponds to the protein in the query fasta it is linked to by the blast results. if multiple matches exist for
+//a subject protein, the match whose query protein has the best percent identity is used
+inline std::vector<int> getMatchPositions(std::istream& blast, std::vector<std::string>& subjectFastaProteins, std::vector<std::string>& queryFastaProteins){
+	std::vector<blastHit> hits;
+	parseBlastHits(blast, subjectFastaProteins, queryFastaProteins, hits);
+	
+	std::vector<int> matchPositions(subjectFastaProteins.size(), NO_PROTEIN);
+	std::vector<int> matchCount(subjectFastaProteins.size(), 0);
+	std::vector<double> topPerIdent(queryFastaProteins.size(), 0); //best percent identity of any line of each query protein
+	for (int y = 0; y < hits.size(); y++){
+		if (hits[y].query != NO_PROTEIN && topPerIdent[hits[y].query] < hits[y].percentIdentity){
+			topPerIdent[hits[y].query] = hits[y].percentIdentity;
+		}
+	}
+	//handles multiple matches by keeping the first match with the best percent identity
+	for (int y = 0; y < hits.size(); y++){
+		if (hits[y].subject == NO_PROTEIN || hits[y].query == NO_PROTEIN || hits[y].percentIdentity < PERCENT_IDENTITY_CUTOFF){
+			continue; //only uses proteins that are in both fastas and meet the cutoff
+		}
+		int x = hits[y].subject;
+		if (matchCount[x] == 0 || topPerIdent[matchPositions[x]] < topPerIdent[hits[y].query]){
+			matchPositions[x] = hits[y].query;
+		}
+		matchCount[x]++;
+	}
+	return matchPositions;	
+}
+
+//finds the representative of a protein in the union-find forest (with path halving)
+inline int findComponent(std::vector<int>& parent, int x){
+	while (parent[x] != x){
+		parent[x] = parent[parent[x]];
+		x = parent[x];
+	}
+	return x;
+}
+
+//adds an edge and its reverse edge to the residual graph
+inline void addFlowEdge(std::vector<std::vector<flowEdge> >& graph, int from, int to, long long cost){
+	flowEdge forward = {to, 1, cost, (int)graph[to].size()};
+	flowEdge backward = {from, 0, -cost, (int)graph[from].size()};
+	graph[from].push_back(forward);
+	graph[to].push_back(backward);
+}
+
+//called by getOneToOneMatches
+//finds the maximum weight matching of one component with successive shortest augmenting paths
+//(Dijkstra with potentials on the residual graph), stopping once no path increases the total identity
+inline void assignComponent(std::vector<blastHit>& hits, std::vector<int>& matchPositions){
+	std::vector<int> subjects, queries;
+	int best = 0;
+	for (int y = 0; y < hits.size(); y++){
+		subjects.push_back(hits[y].subject);
+		queries.push_back(hits[y].query);
+		if (hits[y].percentIdentity > hits[best].percentIdentity){
+			best = y;
+		}
+	}
+	std::sort(subjects.begin(), subjects.end());
+	subjects.erase(std::unique(subjects.begin(), subjects.end()), subjects.end());
+	std::sort(queries.begin(), queries.end());
+	queries.erase(std::unique(queries.begin(), queries.end()), queries.end());
+	if (subjects.size() == 1 || queries.size() == 1){ //only one match can be made, the best hit
+		matchPositions[hits[best].subject] = hits[best].query;
+		return;
+	}
+	
+	//nodes: source, subject proteins, query proteins, sink
+	int subjectCount = subjects.size();
+	int source = 0;
+	int sink = subjectCount + queries.size() + 1;
+	std::vector<std::vector<flowEdge> > graph(sink+1);
+	std::vector<long long> potential(sink+1, 0);
+	for (int x = 0; x < subjectCount; x++){
+		addFlowEdge(graph, source, 1+x, 0);
+	}
+	for (int x = 0; x < queries.size(); x++){
+		addFlowEdge(graph, 1+subjectCount+x, sink, 0);
+	}
+	for (int y = 0; y < hits.size(); y++){
+		int from = 1 + (std::lower_bound(subjects.begin(), subjects.end(), hits[y].subject) - subjects.begin());
+		int to = 1 + subjectCount + (std::lower_bound(queries.begin(), queries.end(), hits[y].query) - queries.begin());
+		long long cost = -llround(hits[y].percentIdentity * IDENTITY_SCALE);
+		addFlowEdge(graph, from, to, cost);
+		potential[to] = std::min(potential[to], cost); //shortest distances of the starting graph (it has no cycles)
+		potential[sink] = std::min(potential[sink], potential[to]);
+	}
+	
+	const long long UNREACHED = LLONG_MAX;
+	std::vector<long long> distance(sink+1);
+	std::vector<std::pair<int, int> > previous(sink+1); //node and edge index the shortest path came from
+	while (true){
+		//Dijkstra on the reduced costs (never negative with the potentials)
+		distance.assign(sink+1, UNREACHED);
+		distance[source] = 0;
+		std::priority_queue<std::pair<long long, int>, std::vector<std::pair<long long, int> >, std::greater<std::pair<long long, int> > > heap;
+		heap.push(std::make_pair(0, source));
+		while (!heap.empty()){
+			long long d = heap.top().first;
+			int u = heap.top().second;
+			heap.pop();
+			if (d > distance[u]){
+				continue;
+			}
+			for (int e = 0; e < graph[u].size(); e++){
+				flowEdge& edge = graph[u][e];
+				if (edge.capacity == 0){
+					continue;
+				}
+				long long next = d + edge.cost + potential[u] - potential[edge.to];
+				if (next < distance[edge.to]){
+					distance[edge.to] = next;
+					previous[edge.to] = std::make_pair(u, e);
+					heap.push(std::make_pair(next, edge.to));
+				}
+			}
+		}
+		if (distance[sink] == UNREACHED){
+			break;
+		}
+		for (int x = 0; x <= sink; x++){
+			if (distance[x] != UNREACHED){
+				potential[x] += distance[x];
+			}
+		}
+		if (potential[sink] - potential[source] >= 0){ //the path would not increase the total identity
+			break;
+		}
+		for (int x = sink; x != source; x = previous[x].first){
+			flowEdge& edge = graph[previous[x].first][previous[x].second];
+			edge.capacity--;
+			graph[x][edge.reverse].capacity++;
+		}
+	}
+	
+	//used subject -> query edges are the matches
+	for (int x = 0; x < subjectCount; x++){
+		for (int e = 0; e < graph[1+x].size(); e++){
+			flowEdge& edge = graph[1+x][e];
+			if (edge.to > subjectCount && edge.to != sink && edge.cost < 0 && edge.capacity == 0){
+				matchPositions[subjects[x]] = queries[edge.to-subjectCount-1];
+			}
+		}
+	}
+}
+
+//one-to-one version of getMatchPositions used with -onetoone
+//every subject and query protein is used at most once. the hits are split into connected components
+//(groups of proteins linked by hits, e.g. a gene family) and each component gets the matching with the
+//highest total percent identity
+inline std::vector<int> getOneToOneMatches(std::istream& blast, std::vector<std::string>& subjectFastaProteins, std::vector<std::string>& queryFastaProteins){
+	std::vector<blastHit> hits, usable;
+	parseBlastHits(blast, subjectFastaProteins, queryFastaProteins, hits);
+	for (int y = 0; y < hits.size(); y++){
+		if (hits[y].subject != NO_PROTEIN && hits[y].query != NO_PROTEIN && hits[y].percentIdentity >= PERCENT_IDENTITY_CUTOFF){
+			usable.push_back(hits[y]); //only uses proteins that are in both fastas and meet the cutoff
+		}
+	}
+	std::vector<blastHit>().swap(hits);
+	
+	//keeps the best line of each subject/query pair (stable so the first line wins ties)
+	std::stable_sort(usable.begin(), usable.end(), [](const blastHit& a, const blastHit& b){
+		if (a.subject != b.subject){
+			return a.subject < b.subject;
+		}
+		if (a.query != b.query){
+			return a.query < b.query;
+		}
+		return a.percentIdentity > b.percentIdentity;
+	});
+	usable.erase(std::unique(usable.begin(), usable.end(), [](const blastHit& a, const blastHit& b){
+		return a.subject == b.subject && a.query == b.query;
+	}), usable.end());
+	
+	//links subject proteins (0..) and query proteins (subjectSize..) that share a hit
+	int subjectSize = subjectFastaProteins.size();
+	std::vector<int> parent(subjectSize + queryFastaProteins.size());
+	for (int x = 0; x < parent.size(); x++){
+		parent[x] = x;
+	}
+	for (int y = 0; y < usable.size(); y++){
+		int a = findComponent(parent, usable[y].subject);
+		int b = findComponent(parent, subjectSize + usable[y].query);
+		if (a != b){
+			parent[a] = b;
+		}
+	}
+	
+	//groups the hits by component and matches each component on its own
+	std::vector<int> component(usable.size());
+	std::vector<int> order(usable.size());
+	for (int y = 0; y < usable.size(); y++){
+		component[y] = findComponent(parent, usable[y].subject);
+		order[y] = y;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b){ return component[a] < component[b]; });
+	std::vector<int> matchPositions(subjectSize, NO_PROTEIN);
+	std::vector<blastHit> componentHits;
+	for (int y = 0; y < order.size(); y++){
+		componentHits.push_back(usable[order[y]]);
+		if (y+1 == order.size() || component[order[y+1]] != component[order[y]]){
+			assignComponent(componentHits, matchPositions);
+			componentHits.clear();
+		}
+	}
+	return matchPositions;
+}
+
+//builds the neighbour matrix used by checkAdjacentProteins: the next checkRange matched proteins downstream and
+//upstream of every subject protein, wrapping around its circular replicon (the protein itself is reused if there are
+//too few matches), along with the circular [minVal, maxVal] range of query positions around each match (within the
+//query replicon). neighbours matched to a different query replicon than the protein are stored as NO_PROTEIN (never
+//nearby). the matrix has a column for every subject protein so it stays a vector, FIXED_RANGE only fixes its rows
+template <int FIXED_RANGE>
+void buildAdjacencyWindows(std::vector<int>& matchPositions, genomeSegments& subjectSegments, genomeSegments& querySegments,
+						   classifierParams& params, adjacencyWindows& windows){
+	const int checkRange = (FIXED_RANGE > 0) ? FIXED_RANGE : params.checkRange;
+	const int rows = checkRange*2;
+	windows.columns = ((matchPositions.size() + SIMD_WIDTH-1)/SIMD_WIDTH)*SIMD_WIDTH;
+	windows.neighbours.assign(rows*windows.columns, 0);
+	windows.minVal.assign(windows.columns, 1); //padding columns are never read back
+	windows.maxVal.assign(windows.columns, 0);
+	
+	std::vector<int> matched; //indexes of subject proteins of the replicon that have a match
+	for (int segment = 0; segment+1 < subjectSegments.starts.size(); segment++){
+		matched.clear();
+		for (int x = subjectSegments.starts[segment]; x < subjectSegments.starts[segment+1]; x++){
+			if (matchPositions[x] > NO_PROTEIN){
+				matched.push_back(x);
+			}
+		}
+		int totalMatched = matched.size();
+		for (int rank = 0; rank < totalMatched; rank++){
+			int x = matched[rank];
+			//the range is worked out within the query replicon of the match
+			int querySegment = querySegments.segmentOf[matchPositions[x]];
+			int queryStart = querySegments.starts[querySegment];
+			int querySize = querySegments.starts[querySegment+1] - queryStart;
+			int position = matchPositions[x] - queryStart;
+			int minVal = position - params.rangeCutoff;
+			if (minVal < 1){
+				minVal = ((querySize+position) - params.rangeCutoff);
+			}
+			int maxVal = position + params.rangeCutoff;
+			if (maxVal > querySize){
+				maxVal = ((position + params.rangeCutoff) - (querySize));
+			}
+			windows.minVal[x] = queryStart + minVal;
+			windows.maxVal[x] = queryStart + maxVal;
+			
+			for (int k = 1; k <= checkRange; k++){
+				//downstream values
+				int down = matchPositions[matched[(rank+k) % totalMatched]];
+				windows.neighbours[(k-1)*windows.columns + x] = (querySegments.segmentOf[down] == querySegment) ? down : NO_PROTEIN;
+				//upstream values
+				int up = matchPositions[matched[(rank - (k % totalMatched) + totalMatched) % totalMatched]];
+				windows.neighbours[(checkRange+k-1)*windows.columns + x] = (querySegments.segmentOf[up] == querySegment) ? up : NO_PROTEIN;
+			}
+		}
+	}
+}
+
+//counts the neighbours of each column that fall within its circular range (SIMD when available)
+//a neighbour is counted when it falls within [minVal, maxVal]. if the range wraps around the end of the
+//query chromosome (minVal >= maxVal) it is counted when it is >= minVal OR <= maxVal. NO_PROTEIN is never counted
+template <int FIXED_RANGE>
+void countAdjacentInRange(adjacencyWindows& windows, int checkRange, std::vector<int32_t>& counts){
+	const int rows = ((FIXED_RANGE > 0) ? FIXED_RANGE : checkRange)*2;
+	const int columns = windows.columns;
+	counts.assign(columns, 0);
+	const int32_t* neighbours = &windows.neighbours[0];
+	int x = 0;
+#if defined(__AVX2__)
+	for (; x + 8 <= columns; x+=8){
+		__m256i minVal = _mm256_loadu_si256((const __m256i*)&windows.minVal[x]);
+		__m256i maxVal = _mm256_loadu_si256((const __m256i*)&windows.maxVal[x]);
+		__m256i wraps = _mm256_cmpgt_epi32(_mm256_add_epi32(minVal, _mm256_set1_epi32(1)), maxVal); //minVal >= maxVal
+		__m256i count = _mm256_setzero_si256();
+		for (int r = 0; r < rows; r++){
+			__m256i value = _mm256_loadu_si256((const __m256i*)&neighbours[r*columns + x]);
+			__m256i below = _mm256_cmpgt_epi32(minVal, value);
+			__m256i above = _mm256_cmpgt_epi32(value, maxVal);
+			__m256i outside = _mm256_blendv_epi8(_mm256_or_si256(below, above), _mm256_and_si256(below, above), wraps);
+			outside = _mm256_or_si256(outside, _mm256_cmpeq_epi32(value, _mm256_set1_epi32(NO_PROTEIN)));
+			count = _mm256_sub_epi32(count, _mm256_xor_si256(outside, _mm256_set1_epi32(-1))); //adds 1 where inside
+		}
+		_mm256_storeu_si256((__m256i*)&counts[x], count);
+	}
+#elif defined(__SSE4_1__)
+	for (; x + 4 <= columns; x+=4){
+		__m128i minVal = _mm_loadu_si128((const __m128i*)&windows.minVal[x]);
+		__m128i maxVal = _mm_loadu_si128((const __m128i*)&windows.maxVal[x]);
+		__m128i wraps = _mm_cmpgt_epi32(_mm_add_epi32(minVal, _mm_set1_epi32(1)), maxVal); //minVal >= maxVal
+		__m128i count = _mm_setzero_si128();
+		for (int r = 0; r < rows; r++){
+			__m128i value = _mm_loadu_si128((const __m128i*)&neighbours[r*columns + x]);
+			__m128i below = _mm_cmpgt_epi32(minVal, value);
+			__m128i above = _mm_cmpgt_epi32(value, maxVal);
+			__m128i outside = _mm_blendv_epi8(_mm_or_si128(below, above), _mm_and_si128(below, above), wraps);
+			outside = _mm_or_si128(outside, _mm_cmpeq_epi32(value, _mm_set1_epi32(NO_PROTEIN)));
+			count = _mm_sub_epi32(count, _mm_xor_si128(outside, _mm_set1_epi32(-1))); //adds 1 where inside
+		}
+		_mm_storeu_si128((__m128i*)&counts[x], count);
+	}
+#endif
+	//scalar fallback and any remaining columns
+	for (; x < columns; x++){
+		int minVal = windows.minVal[x];
+		int maxVal = windows.maxVal[x];
+		for (int r = 0; r < rows; r++){
+			int value = neighbours[r*columns + x];
+			if (value == NO_PROTEIN){
+				continue;
+			}
+			if (minVal < maxVal){
+				if (value >= minVal && value <= maxVal){
+					counts[x]++;
+				}
+			}else{
+				if (value >= minVal || value <= maxVal){
+					counts[x]++;
+				}
+			}
+		}
+	}
+}
+
+//checks upstream and downstream query proteins of every subject protein in one sweep to see if they
+//are conserved compared to the subject. returns a bitset (bit x = subject protein x) where a set bit
+//means the surrounding proteins are different (moved)
+template <int FIXED_RANGE>
+std::vector<uint64_t> checkAdjacentProteins(std::vector<int>& matchPositions, genomeSegments& subjectSegments, genomeSegments& querySegments,
+									   classifierParams& params){
+	const int checkRange = (FIXED_RANGE > 0) ? FIXED_RANGE : params.checkRange;
+	double totalChecked = (checkRange*2);
+	std::vector<uint64_t> movedBits((matchPositions.size()+63)/64, 0);
+	if (matchPositions.size() == 0){
+		return movedBits;
+	}
+	adjacencyWindows windows;
+	std::vector<int32_t> counts;
+	buildAdjacencyWindows<FIXED_RANGE>(matchPositions, subjectSegments, querySegments, params, windows);
+	countAdjacentInRange<FIXED_RANGE>(windows, checkRange, counts);
+	
+	//count is the count of nearby proteins that are the same in both genomes nearby
+	for (int x = 0; x < matchPositions.size(); x++){
+		if (matchPositions[x] > NO_PROTEIN && (counts[x]/totalChecked) < params.nearbyProteinCutoff){
+			movedBits[x/64] |= (uint64_t(1) << (x%64)); //moved
+		}
+	}
+	return movedBits;
+}
+
+//returns true if bit 'index' is set in a bitset built by checkAdjacentProteins
+inline bool isMoved(std::vector<uint64_t>& movedBits, int index){
+	return (movedBits[index/64] >> (index%64)) & 1;
+}
+
+/*
+//this version uses absolute deviation from the median to determine if a region is conserved
+bool isConserved(vector<int> matchPositions, int index, int maxQuerySize){
+	double totalChecked = CHECK_RANGE*2;
+	double count = 0;
+	//gets upstream proteins//
+	int x=index-1;
+	vector<int> adjacentProteins;
+	while (adjacentProteins.size() < CHECK_RANGE){
+		if (x < 0){
+			x = matchPositions.size()-1;
+		}
+		if (matchPositions[x] > -1){
+			adjacentProteins.insert(adjacentProteins.begin(), matchPositions[x]);
+		}
+		x--;
+	}
+	//gets downstream proteins//
+	x = index+1;
+	
+	while(adjacentProteins.size() < totalChecked){
+		if (x >= matchPositions.size()){
+			x = 0;
+		}
+		if(matchPositions[x] > -1){
+			adjacentProteins.push_back(matchPositions[x]);
+		}
+		x++;
+	}
+	//calculates the median of the surrounding orthologs
+	double median;
+	sort(adjacentProteins.begin(),adjacentProteins.end());
+	if (adjacentProteins.size() % 2 == 0){
+		median = (adjacentProteins[adjacentProteins.size()/2 -1] + adjacentProteins[adjacentProteins.size()/2])/2;
+	}else{
+		median = adjacentProteins[adjacentProteins.size()/2];
+	}
+	 //calculates the absolute deviation for each, if less then RANGE_CUTOFF, then it is considered conserved
+	for(int i =0; i < adjacentProteins.size(); i ++){
+		if (abs(adjacentProteins[i] - median) <= RANGE_CUTOFF){
+			count+=1;
+		}
+	}
+	//if the rate of conserved proteins is greater than 1-NEARBY_PROTEIN_CUTOFF
+	//the whole region is considered to be conserved
+	if(count/totalChecked > 1.0-NEARBY_PROTEIN_CUTOFF){
+		return true;
+	}else{
+		return false;
+	}
+}
+*/
+
+//checks upstream and downstream query proteins to see if the protein entered a conserved region, returns true if
+//the region is conserved (there is an alternative method above). the adjacent proteins are gathered within the
+//replicon of the protein and only the query replicons they are matched to are scanned (a plasmid protein doesn't
+//scan the whole genome)
+template <int FIXED_RANGE>
+bool isConserved(std::vector<int>& matchPositions, int index, genomeSegments& subjectSegments, genomeSegments& querySegments,
+				 classifierParams& params){
+	const int checkRange = (FIXED_RANGE > 0) ? FIXED_RANGE : params.checkRange;
+	const int totalChecked = checkRange*2;
+	int segment = subjectSegments.segmentOf[index];
+	int first = subjectSegments.starts[segment];
+	int end = subjectSegments.starts[segment+1];
+	neighbourWindow<FIXED_RANGE> adjacent;
+	adjacent.resize(totalChecked);
+	int* adjacentProteins = &adjacent.values[0];
+	//gets upstream proteins (stored nearest last)//
+	int x=index-1;
+	for (int k = checkRange-1; k >= 0; x--){
+		if (x < first){
+			x = end-1;
+		}
+		if (matchPositions[x] > -1){
+			adjacentProteins[k--] = matchPositions[x];
+		}
+	}
+	//gets downstream proteins//
+	x = index+1;
+	for (int k = checkRange; k < totalChecked; x++){
+		if (x >= end){
+			x = first;
+		}
+		if(matchPositions[x] > -1){
+			adjacentProteins[k++] = matchPositions[x];
+		}
+	}
+	
+	//query replicons that contain adjacent proteins
+	neighbourWindow<FIXED_RANGE> segmentsToScan;
+	segmentsToScan.resize(totalChecked);
+	for (int k = 0; k < totalChecked; k++){
+		segmentsToScan.values[k] = querySegments.segmentOf[adjacentProteins[k]];
+	}
+	std::sort(segmentsToScan.values.begin(), segmentsToScan.values.end());
+	int scanCount = std::unique(segmentsToScan.values.begin(), segmentsToScan.values.end()) - segmentsToScan.values.begin();
+	
+	for (int s = 0; s < scanCount; s++){
+		int queryStart = querySegments.starts[segmentsToScan.values[s]];
+		int queryEnd = querySegments.starts[segmentsToScan.values[s]+1];
+		int i = queryStart;
+		while (i < queryEnd){
+			int count = 0;
+			
+			//compares all adjacent proteins to a series of increasing numbers
+			//counts the total matches
+			//this is looking to see if the adjacent proteins are a conserved region
+			int j =i;
+			for (int q = 0; q < totalChecked*2; q++){
+				if (j >= queryEnd){
+					j = queryStart;
+				}
+				for(int k=0; k < totalChecked; k++){
+					count += (j == adjacentProteins[k]);
+				}
+				j++;
+			}
+			if((double(count)/totalChecked) > 1.0-params.nearbyProteinCutoff){
+				return true;
+				
+			}
+			if (count == 0){
+				i+=10; //speeds up the search by skipping areas with no matches
+			}else{
+				i++;
+			}
+		}
+	}
+	return false;
+}
+
+//called by classifyByNeighbours
+//kernel for a window of FIXED_RANGE upstream and downstream proteins (0 = generic, uses params.checkRange)
+template <int FIXED_RANGE>
+void classifyByNeighboursFixed(std::vector<int>& matchPositions, genomeSegments& subjectSegments, genomeSegments& querySegments,
+							   classifierParams& params, std::vector<uint64_t>& movedBits, std::vector<uint64_t>& conservedBits){
+	movedBits = checkAdjacentProteins<FIXED_RANGE>(matchPositions, subjectSegments, querySegments, params);
+	conservedBits.assign((matchPositions.size()+63)/64, 0);
+	for (int x = 0; x < matchPositions.size(); x++){
+		if (matchPositions[x] >= 0 && isConserved<FIXED_RANGE>(matchPositions, x, subjectSegments, querySegments, params)){
+			conservedBits[x/64] |= (uint64_t(1) << (x%64));
+		}
+	}
+}
+
+//classifies every matched subject protein by its neighbours. sets bit x of movedBits if subject protein x moved and
+//bit x of conservedBits if it is in a conserved region. CHECK_RANGE (the default) and the window sizes commonly tried
+//when tuning have their own kernel, any other checkRange runs the generic kernel (same results, slower)
+inline void classifyByNeighbours(std::vector<int>& matchPositions, genomeSegments& subjectSegments, genomeSegments& querySegments,
+						  classifierParams& params, std::vector<uint64_t>& movedBits, std::vector<uint64_t>& conservedBits){
+	switch (params.checkRange){
+		case 3 : classifyByNeighboursFixed<3>(matchPositions, subjectSegments, querySegments, params, movedBits, conservedBits);
+				 break;
+		case CHECK_RANGE : classifyByNeighboursFixed<CHECK_RANGE>(matchPositions, subjectSegments, querySegments, params, movedBits, conservedBits);
+				 break;
+		case 8 : classifyByNeighboursFixed<8>(matchPositions, subjectSegments, querySegments, params, movedBits, conservedBits);
+				 break;
+		case 10 : classifyByNeighboursFixed<10>(matchPositions, subjectSegments, querySegments, params, movedBits, conservedBits);
+				 break;
+		default : classifyByNeighboursFixed<0>(matchPositions, subjectSegments, querySegments, params, movedBits, conservedBits);
+	}
+}
+
+//chains the matched protein positions into collinear synteny blocks greedily in a single pass over the subject,
+//handling inversions and the wraparound of the circular replicons of both genomes. each subject replicon is chained
+//on its own and a block is only extended within the query replicon of its matches, so blocks never span two replicons.
+//an open block is extended by the next matched protein if it is at most checkRange matched proteins further along the
+//subject and its query position is within rangeCutoff of the block's last query position (ahead for same-direction
+//blocks, behind for inversions). open blocks are kept in a map keyed by their last query position so each extension
+//is a range query. blocks with fewer than MIN_BLOCK_ANCHORS proteins are discarded
+inline void buildSyntenyBlocks(std::vector<int>& matchPositions, genomeSegments& subjectSegments, genomeSegments& querySegments,
+						classifierParams& params, blockIndex& index){
+	std::vector<syntenyBlock> chained;
+	std::vector<int> blockOf(matchPositions.size(), NO_PROTEIN);
+	std::multimap<int, int> openBlocks; //last query position -> block
+	std::vector<std::multimap<int, int>::iterator> openEntry; //where each block is stored in openBlocks
+	std::vector<int> matched; //subject proteins of the replicon with a match, in subject order
+	
+	for (int segment = 0; segment+1 < subjectSegments.starts.size(); segment++){
+		matched.clear();
+		for (int x = subjectSegments.starts[segment]; x < subjectSegments.starts[segment+1]; x++){
+			if (matchPositions[x] > NO_PROTEIN){
+				matched.push_back(x);
+			}
+		}
+		openBlocks.clear(); //blocks of the previous replicon can't be extended
+	
+		for (int rank = 0; rank < matched.size(); rank++){
+			int s = matched[rank];
+			int q = matchPositions[s];
+			int queryStart = querySegments.starts[querySegments.segmentOf[q]];
+			int querySize = querySegments.starts[querySegments.segmentOf[q]+1] - queryStart;
+			int queryLast = queryStart + querySize-1;
+			int best = NO_PROTEIN;
+			int bestDistance = params.rangeCutoff+1;
+			int bestOrientation = 0;
+			std::vector<std::multimap<int, int>::iterator> stale;
+		
+			//query range [q-params.rangeCutoff, q+params.rangeCutoff] split where it wraps around the query replicon
+			std::pair<int, int> ranges[2];
+			int rangeCount = 1;
+			ranges[0] = std::make_pair(q-params.rangeCutoff, q+params.rangeCutoff);
+			if (q-params.rangeCutoff < queryStart){
+				ranges[0] = std::make_pair(queryStart, std::min(q+params.rangeCutoff, queryLast));
+				ranges[1] = std::make_pair(std::max(querySize+q-params.rangeCutoff, q+params.rangeCutoff+1), queryLast);
+				rangeCount = 2;
+			}else if (q+params.rangeCutoff > queryLast){
+				ranges[0] = std::make_pair(q-params.rangeCutoff, queryLast);
+				ranges[1] = std::make_pair(queryStart, std::min(q+params.rangeCutoff-querySize, q-params.rangeCutoff-1));
+				rangeCount = 2;
+			}
+			for (int r = 0; r < rangeCount; r++){
+				std::multimap<int, int>::iterator it = openBlocks.lower_bound(ranges[r].first);
+				for (; it != openBlocks.end() && it->first <= ranges[r].second; it++){
+					syntenyBlock& block = chained[it->second];
+					if (rank - block.lastRank > params.checkRange){ //too far back in the subject to be extended
+						stale.push_back(it);
+						continue;
+					}
+					int ahead = (q - it->first + querySize) % querySize;
+					int behind = (it->first - q + querySize) % querySize;
+					if (block.orientation >= 0 && ahead <= params.rangeCutoff &&
+						(ahead < bestDistance || (ahead == bestDistance && block.anchors > chained[best].anchors))){
+						best = it->second;
+						bestDistance = ahead;
+						bestOrientation = (ahead > 0) ? 1 : block.orientation;
+					}
+					if (block.orientation <= 0 && behind > 0 && behind <= params.rangeCutoff &&
+						(behind < bestDistance || (behind == bestDistance && block.anchors > chained[best].anchors))){
+						best = it->second;
+						bestDistance = behind;
+						bestOrientation = -1;
+					}
+				}
+			}
+			for (int x = 0; x < stale.size(); x++){
+				if (stale[x]->second != best){
+					openEntry[stale[x]->second] = openBlocks.end();
+					openBlocks.erase(stale[x]);
+				}
+			}
+		
+			if (best == NO_PROTEIN){ //starts a new block
+				syntenyBlock block;
+				block.subjectStart = block.subjectEnd = s;
+				block.queryStart = block.queryEnd = q;
+				block.orientation = 0;
+				block.anchors = 1;
+				block.lastRank = rank;
+				chained.push_back(block);
+				openEntry.push_back(openBlocks.insert(std::make_pair(q, chained.size()-1)));
+				blockOf[s] = chained.size()-1;
+			}else{ //extends the closest block
+				syntenyBlock& block = chained[best];
+				block.subjectEnd = s;
+				block.queryEnd = q;
+				block.orientation = bestOrientation;
+				block.anchors++;
+				block.lastRank = rank;
+				openBlocks.erase(openEntry[best]);
+				openEntry[best] = openBlocks.insert(std::make_pair(q, best));
+				blockOf[s] = best;
+			}
+		}
+	
+		//joins the blocks at the end and start of the replicon if they continue across the origin
+		if (matched.size() > 1){
+			int last = blockOf[matched.back()];
+			int first = blockOf[matched.front()];
+			int querySegment = querySegments.segmentOf[chained[last].queryEnd];
+			if (last != first && querySegments.segmentOf[chained[first].queryStart] == querySegment){
+				int querySize = querySegments.starts[querySegment+1] - querySegments.starts[querySegment];
+				syntenyBlock& tail = chained[last];
+				syntenyBlock& head = chained[first];
+				int ahead = (head.queryStart - tail.queryEnd + querySize) % querySize;
+				int behind = (tail.queryEnd - head.queryStart + querySize) % querySize;
+				int orientation = 0;
+				if (tail.orientation >= 0 && head.orientation >= 0 && ahead <= params.rangeCutoff){
+					orientation = (tail.orientation != 0) ? tail.orientation : (ahead > 0 ? 1 : head.orientation);
+				}else if (tail.orientation <= 0 && head.orientation <= 0 && behind > 0 && behind <= params.rangeCutoff){
+					orientation = -1;
+				}else{
+					first = last; //not collinear
+				}
+				if (first != last){
+					tail.subjectEnd = head.subjectEnd;
+					tail.queryEnd = head.queryEnd;
+					tail.orientation = orientation;
+					tail.anchors += head.anchors;
+					head.anchors = 0;
+					for (int x = matched.front(); x <= matched.back(); x++){
+						if (blockOf[x] == first){
+							blockOf[x] = last;
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	//keeps blocks large enough to be a conserved region
+	std::vector<int> newID(chained.size(), NO_PROTEIN);
+	index.blocks.clear();
+	for (int x = 0; x < chained.size(); x++){
+		if (chained[x].anchors >= MIN_BLOCK_ANCHORS){
+			newID[x] = index.blocks.size();
+			index.blocks.push_back(chained[x]);
+		}
+	}
+	index.blockOf.assign(matchPositions.size(), NO_PROTEIN);
+	for (int x = 0; x < blockOf.size(); x++){
+		if (blockOf[x] != NO_PROTEIN){
+			index.blockOf[x] = newID[blockOf[x]];
+		}
+	}
+	
+	//builds the interval lookup table
+	index.intervals.clear();
+	for (int x = 0; x < index.blocks.size(); x++){
+		if (index.blocks[x].subjectStart <= index.blocks[x].subjectEnd){
+			index.intervals.push_back(std::make_pair(index.blocks[x].subjectStart, index.blocks[x].subjectEnd));
+		}else{ //split at the end of the replicon
+			int segment = subjectSegments.segmentOf[index.blocks[x].subjectStart];
+			index.intervals.push_back(std::make_pair(index.blocks[x].subjectStart, subjectSegments.starts[segment+1]-1));
+			index.intervals.push_back(std::make_pair(subjectSegments.starts[segment], index.blocks[x].subjectEnd));
+		}
+	}
+	std::sort(index.intervals.begin(), index.intervals.end());
+	index.maxEnd.resize(index.intervals.size());
+	for (int x = 0; x < index.intervals.size(); x++){
+		index.maxEnd[x] = std::max(index.intervals[x].second, (x > 0) ? index.maxEnd[x-1] : -1);
+	}
+}
+
+//returns true if the subject protein lies within the span of a synteny block
+inline bool isInSyntenyBlock(blockIndex& index, int subjectPosition){
+	//last interval starting at or before the position
+	int x = std::upper_bound(index.intervals.begin(), index.intervals.end(), std::make_pair(subjectPosition, INT32_MAX)) - index.intervals.begin() - 1;
+	for (; x >= 0 && index.maxEnd[x] >= subjectPosition; x--){
+		if (index.intervals[x].second >= subjectPosition){
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
@@ -0,0 +1,208 @@
+/***************************************************************************************************
+ProgressMetrics
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This keeps the progress of the stages of a program (e.g. blast hits parsed, genes classified,
+		 pairs deduplicated) and, when SYNTENY_METRICS_DIR is set, rewrites it every
+		 SYNTENY_METRICS_INTERVAL seconds (default 5) in the Prometheus text format to
+		 	$SYNTENY_METRICS_DIR/synteny_<program>_<pid>.prom
+		 so a node-exporter textfile collector pointed at the directory can scrape long runs. The file
+		 is written under a temporary name and renamed, so it is never read half written, and it is
+		 removed when the program ends. For every stage it has the items done, the items expected
+		 (when known), the rate, the ETA and whether it finished, plus the resident memory of the process.
+
+		 Counting is a relaxed atomic add, so stages can be counted from several threads and are
+		 counted whether or not the metrics are written.
+
+		 Programs that include this must be linked with -pthread.
+****************************************************************************************************/
+#ifndef PROGRESS_METRICS_H
+#define PROGRESS_METRICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include "BufferedWriter.h"
+
+const double METRICS_INTERVAL = 5.0; //seconds between rewrites of the metrics file
+
+struct progressStage{
+	std::string name;
+	std::string unit; //what is counted (e.g. hits, genes, pairs)
+	std::atomic<long long> done;
+	std::atomic<long long> expected; //0 if unknown
+	double started; //seconds since the program started
+	std::atomic<double> finished; //-1 while running
+};
+
+class ProgressMetrics{
+public:
+	ProgressMetrics() : program(""), running(false), stopping(false) {
+		startTime = std::chrono::steady_clock::now();
+		startEpoch = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+	~ProgressMetrics() { stop(); }
+
+	//starts rewriting the metrics file if SYNTENY_METRICS_DIR is set
+	void start(const std::string& programName){
+		std::lock_guard<std::mutex> guard(lock);
+		program = programName;
+		const char* dir = getenv("SYNTENY_METRICS_DIR");
+		if (dir == NULL || *dir == '\0' || running){
+			return;
+		}
+		const char* interval = getenv("SYNTENY_METRICS_INTERVAL");
+		seconds = (interval != NULL && atof(interval) > 0) ? atof(interval) : METRICS_INTERVAL;
+		fileName = std::string(dir) + "/synteny_" + program + "_" + std::to_string(getpid()) + ".prom";
+		running = true;
+		writer = std::thread([this](){
+			std::unique_lock<std::mutex> wait(lock);
+			while (!stopping){
+				write();
+				wakeup.wait_for(wait, std::chrono::duration<double>(seconds));
+			}
+		});
+	}
+
+	//stops the writer and removes the metrics file (called when the program ends)
+	void stop(){
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (!running){
+				return;
+			}
+			stopping = true;
+		}
+		wakeup.notify_all();
+		writer.join();
+		running = false;
+		remove(fileName.c_str());
+	}
+
+	//the stage with this name, started the first time it is asked for
+	progressStage& stage(const std::string& name, const std::string& unit){
+		std::lock_guard<std::mutex> guard(lock);
+		for (size_t x = 0; x < stages.size(); x++){
+			if (stages[x].name == name){
+				return stages[x];
+			}
+		}
+		stages.emplace_back();
+		progressStage& added = stages.back();
+		added.name = name;
+		added.unit = unit;
+		added.done = 0;
+		added.expected = 0;
+		added.started = elapsed();
+		added.finished = -1;
+		return added;
+	}
+
+	void finish(progressStage& stage){
+		stage.finished = elapsed();
+	}
+
+	double elapsed(){
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+private:
+	std::string program;
+	std::string fileName;
+	double seconds;
+	std::deque<progressStage> stages; //a deque so the stages handed out never move
+	std::chrono::steady_clock::time_point startTime;
+	double startEpoch;
+	std::mutex lock;
+	std::condition_variable wakeup;
+	std::thread writer;
+	bool running, stopping;
+
+	//resident memory of the process in bytes (second field of /proc/self/statm, in pages)
+	long long residentBytes(){
+		long long size = 0, resident = 0;
+		FILE* statm = fopen("/proc/self/statm", "r");
+		if (statm != NULL){
+			if (fscanf(statm, "%lld %lld", &size, &resident) != 2){
+				resident = 0;
+			}
+			fclose(statm);
+		}
+		return resident * sysconf(_SC_PAGESIZE);
+	}
+
+	//writes every metric to a temporary file and renames it over the metrics file (called with 'lock' held)
+	void write(){
+		std::string tempName = fileName.substr(0, fileName.rfind('/')+1) + "." + fileName.substr(fileName.rfind('/')+1) + ".tmp";
+		BufferedWriter out;
+		if (!out.open(tempName.c_str())){
+			return;
+		}
+		double now = elapsed();
+		std::string process = "program=\"" + program + "\",pid=\"" + std::to_string(getpid()) + "\"";
+		out << "# HELP synteny_start_time_seconds Start of the program (unix time)\n";
+		out << "# TYPE synteny_start_time_seconds gauge\n";
+		out << "synteny_start_time_seconds{" << process << "} " << (long long)startEpoch << "\n";
+		out << "# HELP synteny_last_update_timestamp_seconds Time the metrics were written (unix time)\n";
+		out << "# TYPE synteny_last_update_timestamp_seconds gauge\n";
+		out << "synteny_last_update_timestamp_seconds{" << process << "} " << (long long)(startEpoch + now) << "\n";
+		out << "# HELP synteny_resident_memory_bytes Resident memory of the program\n";
+		out << "# TYPE synteny_resident_memory_bytes gauge\n";
+		out << "synteny_resident_memory_bytes{" << process << "} " << residentBytes() << "\n";
+		const char* names[5] = {"synteny_stage_items_total", "synteny_stage_expected_items", "synteny_stage_items_per_second",
+								"synteny_stage_eta_seconds", "synteny_stage_finished"};
+		const char* help[5] = {"Items done by a stage", "Items the stage will do (when known)", "Items per second since the stage started",
+							   "Estimated seconds until the stage finishes (when the items it will do are known)", "1 once the stage has finished"};
+		const char* types[5] = {"counter", "gauge", "gauge", "gauge", "gauge"};
+		for (int metric = 0; metric < 5; metric++){
+			out << "# HELP " << names[metric] << " " << help[metric] << "\n";
+			out << "# TYPE " << names[metric] << " " << types[metric] << "\n";
+			for (size_t x = 0; x < stages.size(); x++){
+				progressStage& stage = stages[x];
+				long long done = stage.done, expected = stage.expected;
+				double finished = stage.finished;
+				double duration = ((finished >= 0) ? finished : now) - stage.started;
+				double rate = (duration > 0) ? done/duration : 0;
+				std::string labels = "{" + process + ",stage=\"" + stage.name + "\",unit=\"" + stage.unit + "\"} ";
+				if (metric == 0){
+					out << names[metric] << labels << done << "\n";
+				}else if (metric == 1 && expected > 0){
+					out << names[metric] << labels << expected << "\n";
+				}else if (metric == 2){
+					out << names[metric] << labels << rate << "\n";
+				}else if (metric == 3 && expected > 0){
+					out << names[metric] << labels;
+					if (finished >= 0 || done >= expected){
+						out << 0;
+					}else if (rate > 0){
+						out << (expected - done)/rate;
+					}else{
+						out << "NaN"; //nothing done yet
+					}
+					out << "\n";
+				}else if (metric == 4){
+					out << names[metric] << labels << (finished >= 0) << "\n";
+				}
+			}
+		}
+		out.close();
+		rename(tempName.c_str(), fileName.c_str());
+	}
+};
+
+//the metrics of the program, shared by every file that counts progress
+inline ProgressMetrics& progressMetrics(){
+	static ProgressMetrics metrics;
+	return metrics;
+}
+
+#endif
@@ -0,0 +1,295 @@
+/***************************************************************************************************
+ResultsIndex
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is the offset index of the 'getKegResults' output (kegCounts.csv, or any concatenation
+		 of them such as a <genus>_movedProteins.txt), so a pair or one of its movement categories can
+		 be read with a seek instead of scanning the whole file for the '##', '!!' and '**' markers.
+		 Every pair has these sections:
+		 	PAIR - from its '##<title>' line to the end of its last '**' line
+		 	NOT_MOVED, MOVED_ADJACENT, MOVED_CONSERVED, MOVED_MUTUAL_CONSERVED - from the '!!<category>!!'
+		 	line to the end of its '**' line
+		 'getKegResults' saves the index next to its output as <results>.idx:
+		 	RESULTSINDEX1 <tab> size of the results file <tab> number of sections
+		 	pair title <tab> section <tab> offset <tab> length in bytes <tab> protein pairs (one line per section)
+		 Files without an up to date index (older results, or results compressed afterwards) are
+		 scanned instead. Offsets of compressed files are positions in the decompressed text.
+		 The index of a whole genus ('FormatKegResults' -index) lists the index of every results file:
+		 	RESULTSINDEX1 <tab> GENUS <tab> number of files
+		 	FILE <tab> results file <tab> size <tab> number of sections, followed by its section lines
+
+		 Programs that include this must be linked with -lz -pthread (for CompressedInput.h).
+****************************************************************************************************/
+#ifndef RESULTS_INDEX_H
+#define RESULTS_INDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+
+const char RESULTS_INDEX_EXTENSION[] = ".idx";
+const char RESULTS_INDEX_VERSION[] = "RESULTSINDEX1";
+const char RESULTS_PAIR_SECTION[] = "PAIR";
+const char RESULTS_GENUS_INDEX[] = "GENUS";
+const char RESULTS_FILE_ENTRY[] = "FILE";
+
+struct resultsSection{
+	std::string pair; //title of the pair (the text after '##')
+	std::string section; //RESULTS_PAIR_SECTION or the movement category
+	long long offset; //offset of the first line of the section
+	long long length; //bytes up to and including the newline of the last line
+	long long entries; //protein pairs ('$$' lines) in the section
+};
+
+struct resultsIndex{
+	long long fileSize; //size of the results file the index was built from
+	std::vector<resultsSection> sections; //in file order, each PAIR section comes before its category sections
+};
+
+//the size a saved index must match, -1 if the file doesn't exist
+inline long long getResultsFileSize(const std::string& fileName){
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0){
+		return -1;
+	}
+	return info.st_size;
+}
+
+//builds the index by reading the results
+inline void scanResults(std::istream& data, resultsIndex& index){
+	index.sections.clear();
+	long long offset = 0;
+	int pair = -1; //PAIR section of the pair being read
+	int section = -1; //open category section
+	std::string line;
+	while (getline(data, line)){
+		long long next = offset + line.length() + 1;
+		if (line.compare(0, 2, "##") == 0){
+			resultsSection pairSection = {line.substr(2), RESULTS_PAIR_SECTION, offset, next - offset, 0};
+			index.sections.push_back(pairSection);
+			pair = index.sections.size()-1;
+			section = -1;
+		}else if (section >= 0){
+			if (line.find("$$") != std::string::npos){
+				index.sections[section].entries++;
+				index.sections[pair].entries++;
+			}
+			if (line.find("**") != std::string::npos){ //end of the category
+				index.sections[section].length = next - index.sections[section].offset;
+				index.sections[pair].length = next - index.sections[pair].offset;
+				section = -1;
+			}
+		}else if (pair >= 0 && line.find("!!") != std::string::npos){ //start of a category
+			size_t start = line.find("!!") + 2;
+			size_t end = line.find("!!", start);
+			resultsSection category = {index.sections[pair].pair, line.substr(start, (end == std::string::npos) ? std::string::npos : end-start),
+									   offset, next - offset, 0};
+			index.sections.push_back(category);
+			section = index.sections.size()-1;
+		}
+		offset = next;
+	}
+	index.fileSize = offset;
+}
+
+//writes the index of a results file next to it (under a temporary name first so a parallel run never
+//reads half an index)
+inline void saveResultsIndex(const std::string& fileName, resultsIndex& index){
+	std::string indexName = fileName + RESULTS_INDEX_EXTENSION;
+	std::string tempName = indexName + "." + std::to_string(getpid());
+	BufferedWriter out;
+	if (!out.open(tempName.c_str())){
+		return;
+	}
+	out << RESULTS_INDEX_VERSION << "\t" << index.fileSize << "\t" << index.sections.size() << "\n";
+	for (size_t x = 0; x < index.sections.size(); x++){
+		resultsSection& section = index.sections[x];
+		out << section.pair << "\t" << section.section << "\t" << section.offset << "\t" << section.length << "\t" << section.entries << "\n";
+	}
+	out.close();
+	if (rename(tempName.c_str(), indexName.c_str()) != 0){
+		remove(tempName.c_str());
+	}
+}
+
+//parses one section line of an index, returns false if it is malformed
+inline bool parseResultsSection(const std::string& line, resultsSection& section){
+	size_t fields[4];
+	size_t start = 0;
+	for (int x = 0; x < 4; x++){
+		fields[x] = line.find('\t', start);
+		if (fields[x] == std::string::npos){
+			return false;
+		}
+		start = fields[x]+1;
+	}
+	section.pair = line.substr(0, fields[0]);
+	section.section = line.substr(fields[0]+1, fields[1]-fields[0]-1);
+	section.offset = atoll(line.c_str() + fields[1]+1);
+	section.length = atoll(line.c_str() + fields[2]+1);
+	section.entries = atoll(line.c_str() + fields[3]+1);
+	return true;
+}
+
+//loads the saved index of a results file. returns false if there is none or it doesn't match the file
+inline bool loadResultsIndex(const std::string& fileName, resultsIndex& index){
+	std::ifstream saved((fileName + RESULTS_INDEX_EXTENSION).c_str());
+	std::string line;
+	if (!getline(saved, line) || line.compare(0, sizeof(RESULTS_INDEX_VERSION)-1, RESULTS_INDEX_VERSION) != 0){
+		return false;
+	}
+	size_t tab = line.find('\t');
+	if (tab == std::string::npos || atoll(line.c_str() + tab+1) != getResultsFileSize(fileName)){
+		return false; //the results changed since the index was saved
+	}
+	index.fileSize = atoll(line.c_str() + tab+1);
+	size_t count = atoll(line.c_str() + line.find('\t', tab+1)+1);
+	index.sections.assign(count, resultsSection());
+	for (size_t x = 0; x < count; x++){
+		if (!getline(saved, line) || !parseResultsSection(line, index.sections[x])){
+			return false;
+		}
+	}
+	return true;
+}
+
+//writes the index of every results file of a genus to one file
+inline bool saveGenusIndex(const std::string& fileName, std::vector<std::string>& files, std::vector<resultsIndex>& indexes){
+	BufferedWriter out;
+	if (!out.open(fileName.c_str())){
+		return false;
+	}
+	out << RESULTS_INDEX_VERSION << "\t" << RESULTS_GENUS_INDEX << "\t" << files.size() << "\n";
+	for (size_t x = 0; x < files.size(); x++){
+		out << RESULTS_FILE_ENTRY << "\t" << files[x] << "\t" << indexes[x].fileSize << "\t" << indexes[x].sections.size() << "\n";
+		for (size_t y = 0; y < indexes[x].sections.size(); y++){
+			resultsSection& section = indexes[x].sections[y];
+			out << section.pair << "\t" << section.section << "\t" << section.offset << "\t" << section.length << "\t" << section.entries << "\n";
+		}
+	}
+	out.close();
+	return true;
+}
+
+//loads the index of a genus written by saveGenusIndex. returns false if it is missing or malformed
+inline bool loadGenusIndex(const std::string& fileName, std::vector<std::string>& files, std::vector<resultsIndex>& indexes){
+	std::ifstream saved(fileName.c_str());
+	std::string line;
+	std::string header = std::string(RESULTS_INDEX_VERSION) + "\t" + RESULTS_GENUS_INDEX + "\t";
+	if (!getline(saved, line) || line.compare(0, header.length(), header) != 0){
+		return false;
+	}
+	size_t count = atoll(line.c_str() + header.length());
+	files.assign(count, "");
+	indexes.assign(count, resultsIndex());
+	for (size_t x = 0; x < count; x++){
+		size_t name, size, sections;
+		if (!getline(saved, line) || line.compare(0, sizeof(RESULTS_FILE_ENTRY), std::string(RESULTS_FILE_ENTRY) + "\t") != 0 ||
+			(name = line.find('\t')) == std::string::npos || (size = line.find('\t', name+1)) == std::string::npos ||
+			(sections = line.find('\t', size+1)) == std::string::npos){
+			return false;
+		}
+		files[x] = line.substr(name+1, size-name-1);
+		indexes[x].fileSize = atoll(line.c_str() + size+1);
+		indexes[x].sections.assign(atoll(line.c_str() + sections+1), resultsSection());
+		for (size_t y = 0; y < indexes[x].sections.size(); y++){
+			if (!getline(saved, line) || !parseResultsSection(line, indexes[x].sections[y])){
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//loads the saved index of a results file, or scans the file. returns false if it can't be opened
+inline bool getResultsIndex(const std::string& fileName, resultsIndex& index){
+	if (detectInputFormat(fileName.c_str()) == INPUT_RAW && loadResultsIndex(fileName, index)){
+		return true;
+	}
+	CompressedInput data; //inputs may be gzip or zstd compressed
+	data.open(fileName.c_str());
+	if (!data.is_open()){
+		return false;
+	}
+	scanResults(data, index);
+	return !data.failed(); //e.g. a truncated .gz
+}
+
+//takes a results argument (a file, a directory or an @list file) and returns the results files to read
+//directories are searched for kegCounts.csv (also compressed) and their files sorted by path
+inline std::vector<std::string> getResultsFiles(const std::string& input){
+	std::vector<std::string> files;
+	std::error_code error;
+	if (input.length() > 1 && input[0] == '@'){ //list file
+		std::ifstream list(input.substr(1).c_str());
+		std::string line;
+		while(getline(list, line)){
+			if (line.length() > 0){
+				files.push_back(line);
+			}
+		}
+	}else if (std::filesystem::is_directory(input, error)){
+		for (std::filesystem::recursive_directory_iterator it(input, error), end; !error && it != end; it.increment(error)){
+			std::string name = it->path().filename().string();
+			//also finds compressed kegCounts.csv.gz, but not the offset index kegCounts.csv.idx
+			if (it->is_regular_file(error) && name.find("kegCounts.csv") == 0 && name.find(RESULTS_INDEX_EXTENSION) == std::string::npos){
+				files.push_back(it->path().string());
+			}
+		}
+		std::sort(files.begin(), files.end());
+	}else{
+		files.push_back(input);
+	}
+	return files;
+}
+
+//reads sections of a results file (sorted by offset) one after another. uncompressed files are read with
+//a seek to each section, compressed files are decompressed up to the sections and the text in between skipped
+struct resultsSectionReader{
+	std::ifstream file;
+	CompressedInput compressed;
+	bool seekable;
+	long long position; //offset of the next byte of the compressed stream
+};
+
+inline bool openResultsSections(const std::string& fileName, resultsSectionReader& reader){
+	reader.seekable = (detectInputFormat(fileName.c_str()) == INPUT_RAW);
+	reader.position = 0;
+	if (reader.seekable){
+		reader.file.open(fileName.c_str(), std::ios::binary);
+		return reader.file.is_open();
+	}
+	reader.compressed.open(fileName.c_str());
+	return reader.compressed.is_open();
+}
+
+//reads one section into 'text', returns false if the file ends first
+inline bool readResultsSection(resultsSectionReader& reader, const resultsSection& section, std::string& text){
+	text.resize(section.length);
+	std::istream* data = &reader.compressed;
+	if (reader.seekable){
+		reader.file.clear();
+		reader.file.seekg(section.offset);
+		data = &reader.file;
+	}else{
+		if (section.offset < reader.position){
+			return false; //compressed streams can only be read forwards
+		}
+		reader.compressed.ignore(section.offset - reader.position);
+		reader.position = section.offset + section.length;
+	}
+	data->read(&text[0], section.length);
+	return data->gcount() == section.length;
+}
+
+#endif
@@ -0,0 +1,269 @@
+/***************************************************************************************************
+SketchGenomes
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This decides which pairs of a genus are worth comparing before any blast is run.
+		 Every proteome is reduced to a bottom-k MinHash sketch (the SKETCH_SIZE smallest hashes of
+		 its amino acid k-mers) and the similarity of every pair is estimated from the sketches:
+		 	Jaccard - shared fraction of the smallest hashes of the union of both sketches
+		 	Identity - estimated amino acid identity, 1 + ln(2J/(1+J))/k (the Mash distance)
+		 Pairs of near-identical strains have almost no movement signal and pairs of distant
+		 organisms have almost no orthologs, so pairs whose identity is outside [-min, -max] are
+		 marked 'skip'. The pairs are written to a tab-delimited file with the reason for each
+		 decision, which 'run_genus.sh' and 'queue_genus.sh' use to leave out the skipped pairs.
+
+Arguments: (1)output pairs file, (2...)protein .fasta of every organism
+		   optional: -k <amino acids per k-mer> -size <sketch size> -min <identity> -max <identity>
+****************************************************************************************************/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+
+using namespace std;
+
+struct genomeSketch{
+	string name; //fasta file name without the path or extension (the name 'synteny.sh' uses)
+	vector<uint64_t> hashes; //smallest k-mer hashes, sorted
+	bool opened;
+};
+
+struct sketchSettings{
+	int kmerSize;
+	int sketchSize;
+	double minIdentity; //pairs below this are too distant
+	double maxIdentity; //pairs above this are near-identical
+};
+
+//sketches every fasta on its own thread (up to the number of cores)
+void sketchGenomes(vector<string>& fastaFiles, sketchSettings& settings, vector<genomeSketch>& sketches);
+
+//reads the sequences of a fasta and keeps the smallest hashes of their k-mers
+void sketchGenome(string fileName, sketchSettings& settings, genomeSketch& sketch);
+
+//adds the hashes of the k-mers of one protein sequence
+void addKmerHashes(string& sequence, int kmerSize, vector<uint64_t>& hashes);
+
+//scrambles a packed k-mer so the smallest hashes are a random sample of the k-mers (splitmix64 finalizer)
+uint64_t mixHash(uint64_t value);
+
+//estimates the Jaccard index of two genomes from the smallest hashes of the union of their sketches
+double estimateJaccard(genomeSketch& first, genomeSketch& second, int sketchSize);
+
+//converts a Jaccard index of k-mers to an estimated amino acid identity (1 - Mash distance)
+double estimateIdentity(double jaccard, int kmerSize);
+
+//parses out the file name without the path or extension
+string getGenomeName(string fileAndPath);
+
+const int KMER_SIZE = 9; //amino acids per k-mer (at most MAX_KMER_SIZE)
+const int MAX_KMER_SIZE = 12; //5 bits per amino acid in a 64 bit value
+const int SKETCH_SIZE = 1000; //hashes kept per genome
+const double MIN_IDENTITY = 0.0; //the default band keeps every pair
+const double MAX_IDENTITY = 1.0;
+
+
+////////////////////////////MAIN//////////////////////////////////////////////////////
+int main(int argc, char *argv[]){
+	if (argc < 3){
+		cout << "missing arguments! Provide: output pairs file and the protein .fasta of every organism" << endl;
+		cout << "optional: -k <amino acids per k-mer> (default " << KMER_SIZE << ")" << endl;
+		cout << "          -size <hashes per sketch> (default " << SKETCH_SIZE << ")" << endl;
+		cout << "          -min <identity> -max <identity> (pairs outside the band are skipped, default " << MIN_IDENTITY << "-" << MAX_IDENTITY << ")" << endl;
+		return 0;
+	}
+	sketchSettings settings;
+	settings.kmerSize = KMER_SIZE;
+	settings.sketchSize = SKETCH_SIZE;
+	settings.minIdentity = MIN_IDENTITY;
+	settings.maxIdentity = MAX_IDENTITY;
+	vector<string> fastaFiles;
+	for (int i = 2; i < argc; i++){
+		string arg = argv[i];
+		if (arg == "-k" && i+1 < argc){
+			settings.kmerSize = atoi(argv[++i]);
+		}else if (arg == "-size" && i+1 < argc){
+			settings.sketchSize = atoi(argv[++i]);
+		}else if (arg == "-min" && i+1 < argc){
+			settings.minIdentity = atof(argv[++i]);
+		}else if (arg == "-max" && i+1 < argc){
+			settings.maxIdentity = atof(argv[++i]);
+		}else{
+			fastaFiles.push_back(arg);
+		}
+	}
+	if (settings.kmerSize < 1 || settings.kmerSize > MAX_KMER_SIZE || settings.sketchSize < 1){
+		cout << "!!!!!!!!!!!!!SketchGenomes ERROR:-k must be 1-" << MAX_KMER_SIZE << " and -size at least 1!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+
+	vector<genomeSketch> sketches;
+	sketchGenomes(fastaFiles, settings, sketches);
+
+	BufferedWriter pairs;
+	if (!pairs.open(argv[1])){
+		cout << "!!!!!!!!!!!!!SketchGenomes ERROR:failed to open " << argv[1] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	//pairs are listed in the order 'run_genus.sh' runs them
+	int skipped = 0, total = 0;
+	pairs << "Genome1\tGenome2\tJaccard\tIdentity\tDecision\tReason\n";
+	for (int x = 0; x < sketches.size(); x++){
+		if (!sketches[x].opened){
+			cout << "!!!!!!!!!!!!!SketchGenomes ERROR:failed to open " << fastaFiles[x] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			continue;
+		}
+		for (int y = x+1; y < sketches.size(); y++){
+			if (!sketches[y].opened){
+				continue;
+			}
+			double jaccard = estimateJaccard(sketches[x], sketches[y], settings.sketchSize);
+			double identity = estimateIdentity(jaccard, settings.kmerSize);
+			pairs << sketches[x].name << "\t" << sketches[y].name << "\t" << jaccard << "\t" << identity << "\t";
+			if (identity > settings.maxIdentity){
+				pairs << "skip\tnear-identical (identity above " << settings.maxIdentity << ")\n";
+				skipped++;
+			}else if (identity < settings.minIdentity){
+				pairs << "skip\ttoo distant (identity below " << settings.minIdentity << ")\n";
+				skipped++;
+			}else{
+				pairs << "run\twithin " << settings.minIdentity << "-" << settings.maxIdentity << "\n";
+			}
+			total++;
+		}
+	}
+	pairs.close();
+	cout << total << " pairs, " << skipped << " skipped (see " << argv[1] << ")" << endl;
+	return 0;
+}
+
+
+////////////////////FUNCTIONS////////////////////////////////////////////////////////////////
+
+void sketchGenomes(vector<string>& fastaFiles, sketchSettings& settings, vector<genomeSketch>& sketches){
+	sketches.assign(fastaFiles.size(), genomeSketch());
+	atomic<int> next(0);
+	int threadCount = min<int>(max<int>(thread::hardware_concurrency(), 1), fastaFiles.size());
+	vector<thread> workers;
+	for (int t = 0; t < threadCount; t++){
+		workers.push_back(thread([&](){
+			for (int x = next++; x < fastaFiles.size(); x = next++){
+				sketchGenome(fastaFiles[x], settings, sketches[x]);
+			}
+		}));
+	}
+	for (int t = 0; t < workers.size(); t++){
+		workers[t].join();
+	}
+}
+
+void sketchGenome(string fileName, sketchSettings& settings, genomeSketch& sketch){
+	sketch.name = getGenomeName(fileName);
+	sketch.hashes.clear();
+	CompressedInput fasta; //inputs may be gzip or zstd compressed
+	fasta.open(fileName.c_str());
+	sketch.opened = fasta.is_open();
+	if (!sketch.opened){
+		return;
+	}
+	vector<uint64_t> hashes;
+	string sequence;
+	for (string line; getline(fasta, line);){
+		if (line.length() > 0 && line[0] == '>'){
+			addKmerHashes(sequence, settings.kmerSize, hashes);
+			sequence.clear();
+		}else{
+			sequence += line;
+		}
+		//keeps memory bounded for large proteomes: only the smallest unique hashes can end up in the sketch
+		if (hashes.size() > 4*(size_t)settings.sketchSize + (1 << 20)){
+			sort(hashes.begin(), hashes.end());
+			hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+			if (hashes.size() > settings.sketchSize){
+				hashes.resize(settings.sketchSize);
+			}
+		}
+	}
+	if (fasta.failed()){ //reported like a file that can't be opened
+		sketch.opened = false;
+		return;
+	}
+	addKmerHashes(sequence, settings.kmerSize, hashes);
+	sort(hashes.begin(), hashes.end());
+	hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+	if (hashes.size() > settings.sketchSize){
+		hashes.resize(settings.sketchSize);
+	}
+	sketch.hashes.swap(hashes);
+}
+
+//amino acids are packed 5 bits each (letters only, case-insensitive). k-mers containing anything else
+//(stop codons '*', gaps, line endings) are not counted
+void addKmerHashes(string& sequence, int kmerSize, vector<uint64_t>& hashes){
+	const uint64_t mask = (uint64_t(1) << (5*kmerSize)) - 1;
+	uint64_t packed = 0;
+	int valid = 0; //letters since the last character that isn't an amino acid
+	for (int x = 0; x < sequence.length(); x++){
+		char residue = toupper(sequence[x]);
+		if (residue < 'A' || residue > 'Z'){
+			valid = 0;
+			continue;
+		}
+		packed = ((packed << 5) | uint64_t(residue - 'A' + 1)) & mask;
+		valid++;
+		if (valid >= kmerSize){
+			hashes.push_back(mixHash(packed));
+		}
+	}
+}
+
+uint64_t mixHash(uint64_t value){
+	value += 0x9e3779b97f4a7c15ULL;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+	return value ^ (value >> 31);
+}
+
+double estimateJaccard(genomeSketch& first, genomeSketch& second, int sketchSize){
+	int x = 0, y = 0, shared = 0, seen = 0;
+	while (seen < sketchSize && x < first.hashes.size() && y < second.hashes.size()){
+		if (first.hashes[x] == second.hashes[y]){
+			shared++;
+			x++;
+			y++;
+		}else if (first.hashes[x] < second.hashes[y]){
+			x++;
+		}else{
+			y++;
+		}
+		seen++;
+	}
+	//the union runs out of one sketch before sketchSize hashes (small genomes)
+	while (seen < sketchSize && (x < first.hashes.size() || y < second.hashes.size())){
+		x < first.hashes.size() ? x++ : y++;
+		seen++;
+	}
+	return (seen == 0) ? 0.0 : double(shared)/seen;
+}
+
+double estimateIdentity(double jaccard, int kmerSize){
+	if (jaccard <= 0){
+		return 0.0;
+	}
+	double identity = 1.0 + log(2.0*jaccard/(1.0+jaccard))/kmerSize;
+	return (identity < 0) ? 0.0 : identity;
+}
+
+string getGenomeName(string fileAndPath){
+	string name = fileAndPath.substr(0, fileAndPath.rfind(".")); //removes file extension
+	return name.substr(name.rfind("/")+1); //removes path to file
+}
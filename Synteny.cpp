@@ -0,0 +1,113 @@
+/***************************************************************************************************
+Synteny
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is the part of libsynteny (see Synteny.h) shared by its steps: reading inputs, the
+		 proteins of a fasta and the parsed .brkeg. The steps are in SyntenyCompare.cpp,
+		 SyntenyCategories.cpp, SyntenyCounts.cpp and SyntenyTranslocation.cpp.
+****************************************************************************************************/
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include "CompressedInput.h"
+#include "FastaIndex.h"
+#include "BriteTree.h"
+#include "Synteny.h"
+#include "SyntenyInternal.h"
+
+using namespace std;
+
+namespace{
+
+//copies the records of a fasta index into the proteins of a genome
+void getGenomeProteins(fastaIndex& index, synteny::genome& result){
+	result.proteins.resize(index.records.size());
+	for (int x = 0; x < index.records.size(); x++){
+		fastaRecord& record = index.records[x];
+		synteny::protein& protein = result.proteins[x];
+		protein.id.swap(record.id);
+		protein.location.swap(record.location);
+		protein.start = record.start;
+		protein.end = record.end;
+		protein.complement = record.complement;
+	}
+}
+
+}
+
+namespace synteny{
+
+bool readInput(const string& fileName, string& text){
+	return readInputFile(fileName.c_str(), text);
+}
+
+void parseGenome(string_view fasta, genome& result){
+	fastaIndex index;
+	scanFastaMemory(fasta.data(), fasta.size(), index);
+	getGenomeProteins(index, result);
+}
+
+bool loadGenome(const string& fileName, genome& result){
+	fastaIndex index;
+	if (!getFastaIndex(fileName.c_str(), index)){
+		return false;
+	}
+	getGenomeProteins(index, result);
+	return true;
+}
+
+string findFile(const string& directory, const string& extension){
+	vector<string> files;
+	error_code error;
+	for (filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error)){
+		string name = entry->path().string();
+		if (name.length() > extension.length() && name.compare(name.length()-extension.length(), extension.length(), extension) == 0){
+			files.push_back(name);
+		}
+	}
+	sort(files.begin(), files.end());
+	return files.empty() ? "" : files[0];
+}
+
+void loadOrganisms(const string& genusDirectory, vector<organism>& organisms){
+	vector<string> directories;
+	error_code error;
+	for (filesystem::directory_iterator entry(genusDirectory, error), end; !error && entry != end; entry.increment(error)){
+		if (entry->is_directory()){
+			directories.push_back(entry->path().string());
+		}
+	}
+	sort(directories.begin(), directories.end());
+	for (int x = 0; x < directories.size(); x++){
+		string fastaFile = findFile(directories[x], ".fasta");
+		organism found;
+		if (fastaFile == "" || !loadGenome(fastaFile, found.proteins)){
+			continue;
+		}
+		found.directory = directories[x];
+		found.name = fastaFile.substr(0, fastaFile.rfind(".")); //removes file extension
+		found.name = found.name.substr(found.name.rfind("/")+1); //removes path to file
+		organisms.push_back(found);
+	}
+}
+
+categoryTree::categoryTree() : state(new categoryTreeState()){
+	for (int level = 0; level < BRITE_LEVELS; level++){
+		state->tree.levelSize[level] = 0;
+	}
+}
+
+void categoryTree::parse(string_view brkeg){
+	state.reset(new categoryTreeState());
+	MemoryInput kegFile(brkeg.data(), brkeg.size());
+	parseBriteTree(kegFile, state->tree);
+}
+
+int categoryTree::levelSize(int level) const{
+	return (level >= 0 && level < BRITE_LEVELS) ? state->tree.levelSize[level] : 0;
+}
+
+}
@@ -0,0 +1,275 @@
+/***************************************************************************************************
+Synteny (libsynteny)
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is the public interface of libsynteny, the library that 'CompareOrthologs', 'getKegResults',
+		 'FormatKegResults' and 'CheckTranslocation' are built on. Each step takes its inputs as text in
+		 memory and returns its outputs as text in memory, so a pair can be analysed in-process without
+		 starting the programs or writing temporary files:
+		 	comparePair - matches the orthologs of a pair and classifies their movement ('CompareOrthologs')
+		 	categorizePair - keeps the matches found in both directions, sorts them into the movement
+		 	                 categories and adds their BRITE categories and products ('getKegResults')
+		 	parseMovements, removeDuplicates, categoryCounter, movementConsensus - count the pairs of a
+		 	                 genus by category and movement category ('FormatKegResults')
+		 	checkTranslocation - compares the neighbourhoods of the blast hits ('CheckTranslocation')
+		 The text returned is exactly what the programs write to their files, the programs only read the
+		 files, call these and write the results.
+
+		 Only standard library types are used here (the parsed .brkeg and the counts are kept behind
+		 pointers to types defined in SyntenyInternal.h), so code built against this header doesn't
+		 depend on the headers the library is built from.
+		 SYNTENY_API_VERSION is increased whenever a declaration here changes:
+		 	1 - first version
+		 	2 - categoryTree and categoryCounter keep the BRITE types in SyntenyInternal.h (no tree())
+		 	3 - genBankGene/parseGenBank, findFile and organism/loadOrganisms
+
+		 Inputs are std::string_view (a std::string or any buffer is read without a copy) and must be
+		 uncompressed, readInput decompresses gzip and zstd files. Every function can be called from
+		 several threads at once. A categoryCounter is not synchronized (one per thread), a
+		 movementConsensus can be added to from several threads. Progress is counted like in the
+		 programs (see ProgressMetrics.h) and only written if the caller starts progressMetrics().
+
+		 Build (as in run_genus.sh):
+		 	g++ -O2 -std=c++17 -march=native -fPIC -c Synteny.cpp SyntenyCompare.cpp SyntenyCategories.cpp
+		 		SyntenyCounts.cpp SyntenyTranslocation.cpp
+		 	ar rcs libsynteny.a Synteny*.o
+		 	g++ -shared -o libsynteny.so Synteny*.o -lz -pthread
+		 and link with libsynteny.a (or -lsynteny) -lz -pthread. -march=native enables the SSE4/AVX2
+		 classifier of comparePair, leave it out for a library that runs on other machines.
+****************************************************************************************************/
+#ifndef SYNTENY_H
+#define SYNTENY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+#define SYNTENY_API_VERSION 3
+
+namespace synteny{
+
+////////////////////////////////////GENOMES/////////////////////////////////////////////////
+
+struct protein{ //one protein of a fasta, its rank is its position in genome.proteins
+	std::string id; //text after '>' up to the first space or tab
+	std::string location; //text of the '[location=...]' field, "" if there is none
+	long start; //lowest base of the location, -1 if there is no location
+	long end; //highest base of the location
+	bool complement; //true if encoded on the reverse strand
+};
+
+struct genome{
+	std::vector<protein> proteins; //in fasta order
+};
+
+//reads a whole file into 'text', gzip and zstd files are decompressed. returns false if it can't be read
+bool readInput(const std::string& fileName, std::string& text);
+
+//finds the proteins of a fasta from its headers
+void parseGenome(std::string_view fasta, genome& result);
+
+//reads the proteins of a fasta file from its saved .fidx index when it is up to date (see FastaIndex.h)
+//returns false if the fasta can't be read
+bool loadGenome(const std::string& fileName, genome& result);
+
+struct genBankGene{ //one CDS of a genbank, the values are upper case
+	std::string locusTag;
+	std::string oldLocusTag;
+	std::string proteinID; //without its version
+	std::string product; //"" if it has none
+};
+
+//finds the CDS of a genbank, as 'getKegResults' reads them
+void parseGenBank(std::string_view genbank, std::vector<genBankGene>& genes);
+
+////////////////////////////////////GENUS DIRECTORIES////////////////////////////////////////
+
+struct organism{ //one organism of a genus, a directory of fastas/<genus> with a .fasta
+	std::string directory;
+	std::string name; //fasta file name without the path or extension (the name 'synteny.sh' uses)
+	genome proteins;
+};
+
+//finds the first file of a directory with the extension (in sorted order), "" if there is none
+std::string findFile(const std::string& directory, const std::string& extension);
+
+//loads the fasta of every organism of a genus directory in sorted directory order. directories without a
+//.fasta, or whose fasta can't be read, are skipped
+void loadOrganisms(const std::string& genusDirectory, std::vector<organism>& organisms);
+
+////////////////////////////////////PAIRS ('CompareOrthologs')//////////////////////////////
+
+struct pairSettings{
+	int checkRange; //upstream and downstream proteins compared (-checkrange)
+	int rangeCutoff; //divergence that still counts as nearby (-rangecutoff)
+	double nearbyProteinCutoff; //fraction of nearby proteins below which a protein moved (-nearbycutoff)
+	bool syntenyBlocks; //classify with collinear synteny blocks (-blocks)
+	bool oneToOne; //match every protein at most once (-onetoone)
+	bool wholeGenome; //one circular sequence per genome instead of one per replicon (-wholegenome)
+};
+
+//the settings 'CompareOrthologs' uses without options
+pairSettings defaultPairSettings();
+
+//returns why the settings can't be used, "" if they can
+std::string checkPairSettings(const pairSettings& settings);
+
+struct pairDirection{ //the proteins of one genome (the subject) matched to the other (the query)
+	std::vector<int> matches; //rank of the query protein matched to each subject protein, -1 if none
+	std::vector<char> moved; //1 if the matched subject protein moved
+	std::vector<char> conserved; //1 if its neighbours are found together in the query
+	std::string results; //the *_MovementResults.csv
+	std::string blocks; //the *_SyntenyBlocks.csv, only with syntenyBlocks
+};
+
+struct pairComparison{
+	pairDirection forward; //subject proteins matched to the query
+	pairDirection reverse; //query proteins matched to the subject
+};
+
+//the forward blast has the query proteins in column 1 and the subject proteins in column 2
+//(subject_<subject>_query_<query>.txt), the reverse blast the other way around
+void comparePair(const genome& query, const genome& subject, std::string_view forwardBlast, std::string_view reverseBlast,
+				 const pairSettings& settings, pairComparison& result);
+
+////////////////////////////////////CATEGORIES ('getKegResults')////////////////////////////
+
+struct categoryTreeState;
+
+class categoryTree{ //a parsed .brkeg, shared (not copied) by the copies of the object
+	public:
+		categoryTree();
+
+		void parse(std::string_view brkeg);
+
+		//categories at a level (0 = top level, 1 = functional categories, 2 = pathways)
+		int levelSize(int level) const;
+
+	private:
+		std::shared_ptr<categoryTreeState> state;
+
+		friend struct categoryTreeAccess;
+};
+
+struct resultsSectionInfo{ //one entry of the offset index of a results text (see ResultsIndex.h)
+	std::string pair; //title of the pair
+	std::string section; //PAIR or the movement category
+	long long offset;
+	long long length;
+	long long entries; //protein pairs in the section
+};
+
+struct pairCategories{
+	std::string results; //the kegCounts.csv of the pair
+	std::vector<resultsSectionInfo> sections; //its offset index (saved as kegCounts.csv.idx)
+};
+
+//takes the genbank of the subject and both 'CompareOrthologs' results of a pair (forward first).
+//'title' is the name of the pair (the file name of the forward results), written in upper case
+void categorizePair(std::string_view genbank, const categoryTree& categories, std::string_view forwardResults,
+					std::string_view reverseResults, const std::string& title, pairCategories& result);
+
+////////////////////////////////////GENUS COUNTS ('FormatKegResults')///////////////////////
+
+const int MOVEMENT_CATEGORIES = 4; //0 NOT_MOVED, 1 MOVED_ADJACENT, 2 MOVED_CONSERVED, 3 MOVED_MUTUAL_CONSERVED
+const int REMOVED = -1; //movement category of a duplicate taken out by removeDuplicates
+
+struct movementCall{ //one protein pair of the 'getKegResults' results
+	std::string subject;
+	std::string query;
+	std::string categories; //tab separated BRITE paths (or UNCATEGORIZED)
+	std::string product; //product of the subject in its genbank
+	int move; //movement category
+	long long pair; //number of the genome pair it belongs to (one per '##' title)
+};
+
+//appends the protein pairs of the results of one or more genome pairs ('getKegResults' output or any
+//concatenation of it) to 'calls'. genome pairs are numbered from 'pair' on, the number after the last
+//one is returned so the next text can continue the numbering
+long long parseMovements(std::string_view results, std::vector<movementCall>& calls, long long pair = 0);
+
+//sets the movement category of every protein pair that shares a protein with another pair to REMOVED,
+//keeping the one with the highest movement category (the earliest on ties). returns the number removed
+long long removeDuplicates(std::vector<movementCall>& calls);
+
+struct categoryTables{ //the tables of category vs movement category as written to the .csv files
+	std::string levelA; //top level, "" if the .brkeg has none
+	std::string levelB; //functional categories
+	std::string levelC; //pathways, "" if the .brkeg has none
+};
+
+struct counterState;
+
+class categoryCounter{ //counts protein pairs at every category above their categories
+	public:
+		categoryCounter(const categoryTree& categories);
+		~categoryCounter();
+
+		void add(const movementCall& call); //REMOVED pairs are skipped
+		void add(const std::vector<movementCall>& calls);
+		void tables(categoryTables& result) const;
+
+	private:
+		categoryTree categories;
+		std::unique_ptr<counterState> state;
+
+		categoryCounter(const categoryCounter&); //not copyable
+		categoryCounter& operator=(const categoryCounter&);
+};
+
+struct consensusTables{ //see 'FormatKegResults' -consensus
+	std::string proteins; //calls of every protein
+	std::string families; //calls of every gene family (proteins with the same product)
+	long long proteinCount;
+	long long familyCount;
+};
+
+struct consensusState;
+
+class movementConsensus{ //counts how often every protein and family is called in each movement category
+	public:
+		movementConsensus();
+		~movementConsensus();
+
+		//adds the calls of every genome pair in a results text
+		void add(std::string_view results);
+		//adds calls from parseMovements, the calls of one genome pair must be added together
+		void add(const std::vector<movementCall>& calls);
+		void tables(consensusTables& result) const;
+
+	private:
+		std::unique_ptr<consensusState> state;
+
+		movementConsensus(const movementConsensus&); //not copyable
+		movementConsensus& operator=(const movementConsensus&);
+};
+
+////////////////////////////////////TRANSLOCATION ('CheckTranslocation')////////////////////
+
+struct translocationHit{ //one line of the blast results
+	std::string queryProtein;
+	std::string subjectProtein;
+	std::string eValue;
+	double percentIdentity;
+	bool moved;
+	std::string queryLocation; //"" if the protein has no location
+	std::string subjectLocation;
+};
+
+struct translocationResults{
+	std::vector<translocationHit> hits; //in blast order
+	std::string results; //the results.txt
+	long long moved; //hits predicted to have moved
+};
+
+//compares the neighbours of every blast hit (query proteins in column 1) with the neighbours of its subject
+//protein. 'distance' 0 compares a number of neighbouring proteins, otherwise all proteins within 'distance' bases
+void checkTranslocation(std::string_view blast, const genome& query, const genome& subject, long distance,
+						translocationResults& result);
+
+}
+
+#endif
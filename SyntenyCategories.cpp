@@ -0,0 +1,428 @@
+/***************************************************************************************************
+SyntenyCategories
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is categorizePair of libsynteny (see Synteny.h), the categorization of 'getKegResults'.
+		 The mismatches between the forward and reverse 'CompareOrthologs' results are removed, the
+		 remaining pairs are sorted into the movement categories, and the subject protein IDs are
+		 converted to locus tags with the genbank to find their categories in the .brkeg. The byte
+		 offsets of the pair and of each movement category are returned with the results so they can
+		 be saved as its offset index (see ResultsIndex.h).
+****************************************************************************************************/
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "BriteTree.h"
+#include "ResultsIndex.h"
+#include "ProgressMetrics.h"
+#include "Synteny.h"
+#include "SyntenyInternal.h"
+
+using namespace std;
+
+namespace{
+
+struct syntenyResult{ //stores parsed info from synteny results
+	string sub_prot;
+	string query_prot;
+	//int moved;
+	int moved_adjacent;
+	int moved_conserved;
+	int conserved_both;
+};
+
+struct sortedResults{ //stores synteny results sorted by movement category
+	vector<pair<string, string> > not_moved;
+	vector<pair<string, string> > moved;
+	vector<pair<string, string> > moved_conserved;
+	vector<pair<string, string> > conserved_both;
+};
+
+//takes the results from 'CompareOrthologs' and parses the information into a vector of structs
+void parseSyntenyResults(istream& syntenyResults, vector<syntenyResult>& parsedInfo);
+
+//takes the parsed information from the forward and reverse synteny results and removes any
+//mismatches or matches in one result that don't exist in the other
+void removeMismatches(vector<syntenyResult>& forward, vector<syntenyResult>& reverse);
+
+//takes the paresd forward and reverse synteny results and finds the proteins that enter
+//conserved regions from the forward and reverse perspective
+void findMutualConserved(vector<syntenyResult>& forward, vector<syntenyResult>& reverse);
+
+//sorts the results into the movement categories and stores that as a struct
+void sortResults(vector<syntenyResult> forward, vector<syntenyResult> reverse, sortedResults& results);
+
+//assigns keg functional categories to the parsed results and outputs to a text file
+//uses the genbank to convert protein IDs to locus tags which are used by the keg file
+//the offsets of every movement category are added to the index, after the PAIR section of the pair
+void categorizeResults(sortedResults results, vector<synteny::genBankGene> parsedGenBank, briteTree& kegTree, BufferedWriter& outputFile,
+					   resultsIndex& index);
+
+//called by categorizeResults
+//writes one movement category and adds its section to the index
+void outputCategory(string category, vector<pair<string, string> >& results, vector<synteny::genBankGene>& parsedGenBank, briteTree& kegTree,
+					BufferedWriter& outputFile, resultsIndex& index);
+
+//used by 'categorizeResults' function
+//finds the appropriate keg categories (if they exist) and exports the subject and query protein IDs
+//and the path of each keg category in the BRITE hierarchy to a text file
+void getCategoryCounts(vector<pair<string, string> > results, vector<synteny::genBankGene> parsedGenBank, briteTree& kegTree, BufferedWriter& outputFile);
+
+string parseValue(string line);
+string upperCase(string line);
+string removePosition(string proteinID);
+
+}
+
+namespace synteny{
+
+void categorizePair(string_view genbank, const categoryTree& categories, string_view forwardResults, string_view reverseResults,
+					const string& title, pairCategories& result){
+	MemoryInput forwardSyntenyFile(forwardResults.data(), forwardResults.size());
+	MemoryInput reverseSyntenyFile(reverseResults.data(), reverseResults.size());
+	briteTree& kegTree = categoryTreeAccess::tree(categories);
+	
+	vector<genBankGene> genBankParsed;
+	vector<syntenyResult> forwardResultsParsed, reverseResultsParsed;
+	sortedResults resultsSorted;
+	
+	//parses input into structs
+	parseGenBank(genbank, genBankParsed);
+	parseSyntenyResults(forwardSyntenyFile, forwardResultsParsed);
+	parseSyntenyResults(reverseSyntenyFile, reverseResultsParsed);
+	
+	//cleans up the synteny data
+	removeMismatches(forwardResultsParsed, reverseResultsParsed);
+	findMutualConserved(forwardResultsParsed, reverseResultsParsed);
+	sortResults(forwardResultsParsed, reverseResultsParsed, resultsSorted);
+	progressStage& categorized = progressMetrics().stage("categorize", "pairs");
+	categorized.expected += resultsSorted.not_moved.size() + resultsSorted.moved.size() + resultsSorted.moved_conserved.size() +
+							resultsSorted.conserved_both.size();
+	
+	//writes count information
+	result.results.clear();
+	BufferedWriter countFile;
+	countFile.attach(result.results);
+	countFile << "\n\n\n\n/////////////////////////////////////////////////\n\n";
+	resultsIndex index;
+	resultsSection pairSection = {upperCase(title), RESULTS_PAIR_SECTION, countFile.tell(), 0, (long long)forwardResultsParsed.size()};
+	index.sections.push_back(pairSection);
+	countFile << "##" << upperCase(title) << "\n";
+	countFile << "\n/////////////////////////////////////////////////\n";
+	countFile << "TOTAL: " << forwardResultsParsed.size() << "\n";
+	countFile << "NOT MOVED: " << resultsSorted.not_moved.size() << "\n";
+	countFile << "MOVED: " << resultsSorted.moved.size() << "\n";
+	countFile << "MOVED CONSERVED: " << resultsSorted.moved_conserved.size() << "\n";
+	countFile << "MOVED MUTUAL CONSERVED: " << resultsSorted.conserved_both.size() << "\n";
+	
+	//writes protein IDs and keg categories
+	categorizeResults(resultsSorted, genBankParsed, kegTree, countFile, index);
+	
+	progressMetrics().finish(categorized);
+	
+	//the pair ends with its last category
+	long long fileSize = countFile.tell();
+	index.sections[0].length = fileSize - index.sections[0].offset;
+	index.sections[0].entries = 0;
+	for (int x = 1; x < index.sections.size(); x++){
+		index.sections[0].entries += index.sections[x].entries;
+	}
+	countFile.close();
+	result.sections.resize(index.sections.size());
+	for (int x = 0; x < index.sections.size(); x++){
+		result.sections[x].pair = index.sections[x].pair;
+		result.sections[x].section = index.sections[x].section;
+		result.sections[x].offset = index.sections[x].offset;
+		result.sections[x].length = index.sections[x].length;
+		result.sections[x].entries = index.sections[x].entries;
+	}
+}
+
+//parses out the locus tag, old locus tag, and the corresponding protein id from the genbank
+//this will be used to link the keg information and the synteny results
+void parseGenBank(string_view genbank, vector<genBankGene>& parsedInfo){
+	MemoryInput genBankFile(genbank.data(), genbank.size());
+	string line;
+	genBankGene gene;
+	while(!genBankFile.eof()){
+		getline(genBankFile, line);
+		if (line.find("    CDS    ")!=string::npos){ //finds CDS
+			gene.locusTag = "";
+			gene.oldLocusTag = "";
+			gene.proteinID="";
+			gene.product="";
+			do{
+				getline(genBankFile, line);
+				if(line.find("/locus_tag=") != string::npos){ //finds locus tag
+					gene.locusTag = parseValue(line);
+
+				}
+				if(line.find("/old_locus_tag=") != string::npos){ //finds locus tag
+					gene.oldLocusTag = parseValue(line);
+
+				}
+				if(line.find("/product=") != string::npos){
+					gene.product = parseValue(line);
+
+				}
+				if(line.find("/protein_id=") != string::npos){ //find protein ID
+					gene.proteinID = parseValue(line);
+					gene.proteinID = gene.proteinID.substr(0, gene.proteinID.rfind(".")); //removes version number
+
+				}
+			}while((line.find("    gene    ")==string::npos) && (!genBankFile.eof()));
+			parsedInfo.push_back(gene); //adds struct to vector
+		}
+	}
+}
+
+}
+
+namespace{
+
+string parseValue(string line){
+	int pos = line.find("=");
+	string value;
+	pos+=2; //moves past '=' and '"'
+	for (pos; ((line[pos] != '\n') && (line[pos] != '"')) && (value.find("\" ") ==string::npos) && pos < line.length(); pos++){
+		value+=line[pos];
+	}
+	return upperCase(value);
+}
+
+//parses the results from 'CompareOrthologs' and stores them into a struct
+void parseSyntenyResults(istream& syntenyResults, vector<syntenyResult>& parsedInfo){
+	string line, temp;
+	syntenyResult result;
+	int pos;
+	while(!syntenyResults.eof()){
+		getline(syntenyResults, line);
+		temp = "";
+		if(line.find("lcl|")!=string::npos){ 
+		
+			//gets subject protein ID////
+			pos = line.find("_prot_");
+			pos+=6;
+			for (pos; ((line[pos] != '\n') && (line[pos-1] != ',')); pos++){
+				temp += line[pos]; 
+			}
+			temp = temp.substr(0,temp.rfind(","));
+			result.sub_prot = upperCase(temp);
+
+			
+			//gets query protein ID///
+			temp = "";
+			pos = line.rfind("_prot_");
+			pos+=6;
+			for (pos; ((line[pos] != '\n') && (line[pos-1] != ',')); pos++){
+				temp += line[pos];
+			}
+			temp = temp.substr(0,temp.rfind(","));
+			result.query_prot = upperCase(temp);
+			
+			//gets movement info//
+			line = line.substr(line.find(temp));
+			line = line.substr(line.find(",")+1); //moves past query protein
+			line = line.substr(line.find(",")+1); // moves past subject protein pos
+			line = line.substr(line.find(",")+1); // moves past query protein pos
+			result.moved_adjacent = line[0]-48; //-48 to convert char to int
+			line = line.substr(line.find(",")+1); //moves past 'moved adjacent'
+			result.moved_conserved = line[0]-48; //-48 to convert char to int
+			result.conserved_both = 0;
+			parsedInfo.push_back(result);
+		}
+	}
+}
+
+//any mismatches between the forward and reverse results will be removed
+//this does not filter out mismatches between movement into/from conserved regions
+void removeMismatches(vector<syntenyResult>& forward, vector<syntenyResult>& reverse){
+	int count = 0;
+	int matchCount=0;
+	vector<syntenyResult> forwardTemp, reverseTemp;
+	
+	//remove proteins with no matches in the reverse condition//
+	if(forward.size() < reverse.size()){
+		for (int x=0; x < forward.size(); x++){
+			for (int y=0; y < reverse.size(); y++){
+				if (forward[x].sub_prot == reverse[y].query_prot){
+					forwardTemp.push_back(forward[x]);
+					reverseTemp.push_back(reverse[y]);
+				}
+			}
+		}
+	}else{
+		for (int x=0; x < reverse.size(); x++){
+			for (int y=0; y < forward.size(); y++){
+				if (reverse[x].sub_prot == forward[y].query_prot){
+					reverseTemp.push_back(reverse[x]);
+					forwardTemp.push_back(forward[y]);
+				}
+			}
+		}
+	}
+	forward.clear();
+	reverse.clear();
+	forward = forwardTemp;
+	reverse = reverseTemp;
+	forwardTemp.clear();
+	reverseTemp.clear();
+	
+	//removes mismatches and pairs with divergence in movement classification
+	
+	for(int i = 0; i < forward.size(); i++){
+		for (int j =0; j < reverse.size(); j++){
+			if (forward[i].sub_prot == reverse[j].query_prot && forward[i].query_prot == reverse[j].sub_prot &&
+				forward[i].moved_adjacent == reverse[j].moved_adjacent){
+				forwardTemp.push_back(forward[i]);
+				reverseTemp.push_back(reverse[j]);
+			}
+		}
+	}
+	
+	forward.clear();
+	reverse.clear();
+	forward = forwardTemp;
+	reverse = reverseTemp;
+}
+
+
+//determines if the forward and reverse results match regarding the movement into a conserved region
+// if they match the variable 'conserved_both' is set to 1
+void findMutualConserved(vector<syntenyResult>& forward, vector<syntenyResult>& reverse){
+	int count = 0;
+	for (int i =0; i < forward.size(); i++){
+		for (int j = 0; j < reverse.size(); j++){
+			if (forward[i].sub_prot == reverse[j].query_prot){
+				if (forward[i].moved_adjacent ==1 &&forward[i].moved_conserved ==1 &&
+				    reverse[j].moved_adjacent ==1 &&reverse[j].moved_conserved ==1){
+					
+					forward[i].conserved_both = 1;
+					reverse[j].conserved_both = 1;
+					count++;
+				}
+			}
+		}
+	}
+}
+
+
+//sorts the synteny results into 5 categories and stores them in a struct
+void sortResults(vector<syntenyResult> forward, vector<syntenyResult> reverse, sortedResults& results){
+	pair<string, string> temp;
+	for (int i = 0; i < forward.size(); i++){
+		if (forward[i].moved_adjacent == 0){ //didnt move
+			temp.first = forward[i].sub_prot;
+			temp.second = forward[i].query_prot;
+			results.not_moved.push_back(temp);
+		}
+		if (forward[i].moved_adjacent == 1 && forward[i].moved_conserved == 0){ //moved based on adjacent proteins
+			temp.first = forward[i].sub_prot;
+			temp.second = forward[i].query_prot;
+			results.moved.push_back(temp);
+		}
+		if (forward[i].moved_adjacent == 1 && forward[i].moved_conserved == 1 && forward[i].conserved_both == 0){ //moved based upon adjacent proteins into a conserved region
+			temp.first = forward[i].sub_prot;
+			temp.second = forward[i].query_prot;
+			results.moved_conserved.push_back(temp);
+		}
+		//moved based upon adjacent proteins from a conserved region into a conserved region
+		if (forward[i].moved_adjacent == 1 && forward[i].moved_conserved == 1 && forward[i].conserved_both == 1){ 
+			temp.first = forward[i].sub_prot;
+			temp.second = forward[i].query_prot;
+			results.conserved_both.push_back(temp);
+		}
+		
+		//gets the pairs that moved into a conserved region from the reverse perspective
+		if (reverse[i].moved_adjacent == 1 && reverse[i].moved_conserved == 1 && reverse[i].conserved_both == 0){
+			temp.first = reverse[i].query_prot;
+			temp.second = reverse[i].sub_prot;
+			results.moved_conserved.push_back(temp);
+		}
+	}
+}
+
+
+void categorizeResults(sortedResults results, vector<synteny::genBankGene> parsedGenBank, briteTree& kegTree, BufferedWriter& outputFile,
+					   resultsIndex& index){
+	outputCategory("NOT_MOVED", results.not_moved, parsedGenBank, kegTree, outputFile, index);
+	outputCategory("MOVED_ADJACENT", results.moved, parsedGenBank, kegTree, outputFile, index);
+	outputCategory("MOVED_CONSERVED", results.moved_conserved, parsedGenBank, kegTree, outputFile, index);
+	outputCategory("MOVED_MUTUAL_CONSERVED", results.conserved_both, parsedGenBank, kegTree, outputFile, index);
+}
+
+void outputCategory(string category, vector<pair<string, string> >& results, vector<synteny::genBankGene>& parsedGenBank, briteTree& kegTree,
+					BufferedWriter& outputFile, resultsIndex& index){
+	resultsSection section = {index.sections[0].pair, category, outputFile.tell(), 0, (long long)results.size()};
+	outputFile << "!!" << category << "!!\n";
+	getCategoryCounts(results, parsedGenBank, kegTree, outputFile);
+	outputFile << "**\n";
+	section.length = outputFile.tell() - section.offset;
+	index.sections.push_back(section);
+}
+
+
+void getCategoryCounts(vector<pair<string, string> > results, vector<synteny::genBankGene> parsedGenBank, briteTree& kegTree, BufferedWriter& outputFile){
+	bool categorized = false;
+	vector<int> nodes;
+	int productIndex=0;
+	bool productFound = false;
+	progressStage& progress = progressMetrics().stage("categorize", "pairs");
+	for(int x=0; x< results.size(); x++){ //loops through protein pairs
+		progress.done.fetch_add(1, memory_order_relaxed);
+		outputFile << "$$\t" << results[x].first << "\t" << results[x].second << "\t";
+		productIndex = 0;
+		productFound = false;
+		for(int y=0; y < parsedGenBank.size(); y++){
+			if(removePosition(results[x].first) == parsedGenBank[y].proteinID){ //finds locus tag
+				productIndex = y;
+				productFound = true;
+				//gets the categories listed for either locus tag
+				nodes.clear();
+				unordered_map<string, vector<int> >::iterator found = kegTree.genes.find(parsedGenBank[y].oldLocusTag);
+				if (found != kegTree.genes.end()){
+					nodes.insert(nodes.end(), found->second.begin(), found->second.end());
+				}
+				found = kegTree.genes.find(parsedGenBank[y].locusTag);
+				if (found != kegTree.genes.end()){
+					nodes.insert(nodes.end(), found->second.begin(), found->second.end());
+				}
+				sort(nodes.begin(), nodes.end()); //keeps the .brkeg order
+				nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+				for(int z=0; z < nodes.size(); z++){
+					categorized = true; //controls whether or not a protein is assigned 'UNCATEGORIZED'
+					outputFile << getBritePath(kegTree, nodes[z]) << "\t";
+				}
+				break;
+			}
+		}
+		if(!categorized){
+			outputFile << "UNCATEGORIZED" << "\t";
+		}
+		if(productFound == true && parsedGenBank[productIndex].product != ""){
+			outputFile << "/product=" << parsedGenBank[productIndex].product << "\n";
+		}else{
+			outputFile << "\n";
+		}
+		
+		//outputFile <<endl;
+		categorized = false;
+	}
+}
+
+string upperCase(string line){
+	transform(line.begin(), line.end(), line.begin(), ::toupper);
+	return line;
+}
+
+string removePosition(string proteinID){
+	proteinID = proteinID.substr(0,proteinID.find("."));
+	return proteinID;
+}
+
+}
@@ -0,0 +1,176 @@
+/***************************************************************************************************
+SyntenyCompare
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is comparePair of libsynteny (see Synteny.h), the classification of 'CompareOrthologs'.
+		 The proteins of the subject are matched to the query with the blast results and classified
+		 with the neighbour windows (or the synteny blocks) of OrthologClassifier.h, for both
+		 directions of the pair.
+****************************************************************************************************/
+#include <string>
+#include <vector>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "OrthologClassifier.h"
+#include "ProgressMetrics.h"
+#include "Synteny.h"
+
+using namespace std;
+
+namespace{
+
+//matches one direction of the pair, classifies it and writes its results
+void compareDirection(vector<string>& subjectFastaProteins, vector<string>& queryFastaProteins, string_view blast,
+					  genomeSegments& subjectSegments, genomeSegments& querySegments, const synteny::pairSettings& settings,
+					  classifierParams& params, synteny::pairDirection& result);
+
+//writes all the protein matches and the movement classification information comma-delimited
+//if useSyntenyBlocks is true movement and conservation are looked up in the block index instead of
+//scanning the neighbouring proteins
+void outputAllResults(vector<int>& matchPositions, vector<string>& subjectFasta, vector<string>& queryFasta, BufferedWriter& outputFile,
+					  genomeSegments& subjectSegments, genomeSegments& querySegments, classifierParams& params,
+					  bool useSyntenyBlocks, blockIndex& blocks, synteny::pairDirection& result);
+
+//writes the synteny blocks comma-delimited
+void outputSyntenyBlocks(blockIndex& index, BufferedWriter& outputFile);
+
+}
+
+namespace synteny{
+
+pairSettings defaultPairSettings(){
+	pairSettings settings;
+	settings.checkRange = CHECK_RANGE;
+	settings.rangeCutoff = RANGE_CUTOFF;
+	settings.nearbyProteinCutoff = NEARBY_PROTEIN_CUTOFF;
+	settings.syntenyBlocks = false;
+	settings.oneToOne = false;
+	settings.wholeGenome = false;
+	return settings;
+}
+
+string checkPairSettings(const pairSettings& settings){
+	if (settings.checkRange < 1 || settings.checkRange > MAX_CHECK_RANGE || settings.rangeCutoff < 0 ||
+		settings.nearbyProteinCutoff < 0 || settings.nearbyProteinCutoff > 1){
+		return "-checkrange must be 1-" + to_string(MAX_CHECK_RANGE) + ", -rangecutoff >= 0 and -nearbycutoff 0-1";
+	}
+	return "";
+}
+
+void comparePair(const genome& query, const genome& subject, string_view forwardBlast, string_view reverseBlast,
+				 const pairSettings& settings, pairComparison& result){
+	classifierParams params;
+	params.checkRange = settings.checkRange;
+	params.rangeCutoff = settings.rangeCutoff;
+	params.nearbyProteinCutoff = settings.nearbyProteinCutoff;
+
+	//builds vectors of proteins for query and subject fasta
+	vector<string> queryFastaProteins(query.proteins.size()), subjectFastaProteins(subject.proteins.size());
+	for (int x = 0; x < query.proteins.size(); x++){
+		queryFastaProteins[x] = query.proteins[x].id;
+	}
+	for (int x = 0; x < subject.proteins.size(); x++){
+		subjectFastaProteins[x] = subject.proteins[x].id;
+	}
+
+	//neighbour windows and conservation scans stay within each replicon
+	genomeSegments querySegments, subjectSegments;
+	buildGenomeSegments(queryFastaProteins, !settings.wholeGenome, querySegments);
+	buildGenomeSegments(subjectFastaProteins, !settings.wholeGenome, subjectSegments);
+
+	progressStage& classified = progressMetrics().stage("classify", "genes");
+	classified.expected += subjectFastaProteins.size() + queryFastaProteins.size();
+	compareDirection(subjectFastaProteins, queryFastaProteins, forwardBlast, subjectSegments, querySegments, settings, params,
+					 result.forward);
+	compareDirection(queryFastaProteins, subjectFastaProteins, reverseBlast, querySegments, subjectSegments, settings, params,
+					 result.reverse);
+	progressMetrics().finish(classified);
+}
+
+}
+
+namespace{
+
+void compareDirection(vector<string>& subjectFastaProteins, vector<string>& queryFastaProteins, string_view blast,
+					  genomeSegments& subjectSegments, genomeSegments& querySegments, const synteny::pairSettings& settings,
+					  classifierParams& params, synteny::pairDirection& result){
+	//index= position of protein in subject fasta, value= position of protein in query fasta
+	MemoryInput blastResults(blast.data(), blast.size());
+	if (settings.oneToOne){
+		result.matches = getOneToOneMatches(blastResults, subjectFastaProteins, queryFastaProteins);
+	}else{
+		result.matches = getMatchPositions(blastResults, subjectFastaProteins, queryFastaProteins);
+	}
+	progressMetrics().finish(progressMetrics().stage("parse_hits", "hits"));
+
+	//chains the matches into synteny blocks
+	blockIndex blocks;
+	result.blocks.clear();
+	if (settings.syntenyBlocks){
+		buildSyntenyBlocks(result.matches, subjectSegments, querySegments, params, blocks);
+		BufferedWriter blocksOut;
+		blocksOut.attach(result.blocks);
+		outputSyntenyBlocks(blocks, blocksOut);
+	}
+
+	//checks for movement and writes the results
+	result.results.clear();
+	BufferedWriter outputFile;
+	outputFile.attach(result.results);
+	outputAllResults(result.matches, subjectFastaProteins, queryFastaProteins, outputFile, subjectSegments, querySegments, params,
+					 settings.syntenyBlocks, blocks, result);
+}
+
+void outputAllResults(vector<int>& matchPositions, vector<string>& subjectFasta, vector<string>& queryFasta, BufferedWriter& outputFile,
+					  genomeSegments& subjectSegments, genomeSegments& querySegments, classifierParams& params,
+					  bool useSyntenyBlocks, blockIndex& blocks, synteny::pairDirection& result){
+	outputFile << "S_Prot_Name, Q_Prot_Name,Subject.Protein,Query.Protein,Movement.Adjacent,Adjacent.Conserved\n";
+	vector<uint64_t> movedBits, conservedBits;
+	if (!useSyntenyBlocks){
+		classifyByNeighbours(matchPositions, subjectSegments, querySegments, params, movedBits, conservedBits);
+	}
+	result.moved.assign(matchPositions.size(), 0);
+	result.conserved.assign(matchPositions.size(), 0);
+	for (int x = 0; x < matchPositions.size(); x++){
+
+		if (matchPositions[x] >= 0){
+			outputFile << subjectFasta[x] << ",";
+			outputFile << queryFasta[matchPositions[x]] << ",";
+			outputFile << x << ",";
+
+			outputFile << matchPositions[x] << ",";
+			bool moved, conserved;
+			if (useSyntenyBlocks){
+				moved = (blocks.blockOf[x] == NO_PROTEIN); //moved if it isn't part of a block
+				conserved = isInSyntenyBlock(blocks, x);
+			}else{
+				moved = isMoved(movedBits, x);
+				conserved = isMoved(conservedBits, x);
+			}
+			outputFile << moved << ",";
+			outputFile << conserved;
+			result.moved[x] = moved;
+			result.conserved[x] = conserved;
+			outputFile << "\n";
+		}
+
+	}
+	progressMetrics().stage("classify", "genes").done.fetch_add(matchPositions.size(), memory_order_relaxed);
+}
+
+void outputSyntenyBlocks(blockIndex& index, BufferedWriter& outputFile){
+	outputFile << "Block,Subject.Start,Subject.End,Query.Start,Query.End,Orientation,Proteins\n";
+	for (int x = 0; x < index.blocks.size(); x++){
+		outputFile << x << ",";
+		outputFile << index.blocks[x].subjectStart << ",";
+		outputFile << index.blocks[x].subjectEnd << ",";
+		outputFile << index.blocks[x].queryStart << ",";
+		outputFile << index.blocks[x].queryEnd << ",";
+		outputFile << index.blocks[x].orientation << ",";
+		outputFile << index.blocks[x].anchors << "\n";
+	}
+}
+
+}
@@ -0,0 +1,393 @@
+/***************************************************************************************************
+SyntenyCounts
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is the counting of 'FormatKegResults' in libsynteny (see Synteny.h): the protein pairs
+		 are parsed from the 'getKegResults' results, duplicates (pairs sharing a protein) are removed,
+		 and the pairs are counted by BRITE category and movement category (see CategoryTable.h).
+		 movementConsensus counts how often every protein and gene family is called in each movement
+		 category. Its counts are split between CONSENSUS_SHARDS hash tables by the hash of the name,
+		 so threads adding at the same time rarely wait on the same table.
+****************************************************************************************************/
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "BriteTree.h"
+#include "CategoryTable.h"
+#include "ProgressMetrics.h"
+#include "Synteny.h"
+#include "SyntenyInternal.h"
+
+using namespace std;
+
+namespace{
+
+struct movementReader{ //reads results one protein pair at a time
+	istream* data;
+	int move; //movement category of the section being read
+	bool inSection; //between a '!!' line and its '**' line
+	long long pair; //'##' titles read so far
+};
+
+struct consensusCounter{ //movement calls of one protein or gene family
+	int counts[synteny::MOVEMENT_CATEGORIES];
+	string product; //of proteins, the product of the first pair that lists it as the subject
+};
+
+struct consensusCall{ //one call handed to a shard
+	string name;
+	string product;
+	int move;
+	bool family;
+};
+
+struct consensusShard{ //proteins and families whose names hash to the shard
+	mutex lock;
+	unordered_map<string, consensusCounter> proteins;
+	unordered_map<string, consensusCounter> families;
+};
+
+//reads the next protein pair of the results into 'result'
+//returns false at the end of the text
+bool readNextMovement(movementReader& reader, synteny::movementCall& result);
+
+//takes a parsed line from the results
+//returns an integer corresponding to the movement category
+int getMovementCategory(string line);
+
+//called by readNextMovement
+//takes a line from the results
+//parses the line into a struct
+void buildResult(string line, synteny::movementCall& result);
+
+//adds the highest call of every protein (and of every family of the subjects) of one pair to the shard buffers
+void addPairCalls(unordered_map<string, pair<int, string> >& proteinCalls, vector<vector<consensusCall> >& buffers,
+				  vector<consensusShard>& shards);
+
+//adds the buffered calls of a shard to its tables
+void flushConsensusCalls(vector<consensusCall>& calls, consensusShard& shard);
+
+//writes the proteins or the families with their most frequent movement category
+void outputConsensusTable(vector<pair<string, consensusCounter*> >& rows, string title, bool products, BufferedWriter& outputFile);
+
+const int CONSENSUS_SHARDS = 64; //hash tables the consensus counts are split between
+const int CONSENSUS_BUFFER = 4096; //calls buffered for a shard before taking its lock
+
+}
+
+namespace synteny{
+
+struct consensusState{
+	consensusState() : shards(CONSENSUS_SHARDS) {}
+	vector<consensusShard> shards;
+};
+
+long long parseMovements(string_view results, vector<movementCall>& calls, long long pair){
+	MemoryInput data(results.data(), results.size());
+	movementReader reader = {&data, -1, false, pair};
+	movementCall result;
+	while(readNextMovement(reader, result)){
+		result.pair = reader.pair;
+		calls.push_back(result);
+	}
+	return reader.pair;
+}
+
+long long removeDuplicates(vector<movementCall>& proteins){
+	long long count = 0;
+	int y;
+	progressStage& progress = progressMetrics().stage("remove_duplicates", "pairs");
+	progress.expected = proteins.size();
+	for(int x=0; x < proteins.size(); x++){ //loops through all proteins
+		progress.done.fetch_add(1, memory_order_relaxed);
+		if(proteins[x].subject.length() > 0){ //doesnt search for matches if already erased
+			y = x+1;
+			while(y < proteins.size()){ //loops through all downstream proteins //upstream ones have already been checked
+				//looks for a match
+				if ((proteins[x].subject == proteins[y].subject || proteins[x].subject == proteins[y].query ||
+				proteins[x].query == proteins[y].subject || proteins[x].query == proteins[y].subject)&& (x != y)
+				&&(proteins[x].subject.length() > 0) && (proteins[x].query.length() > 0)){
+					//erases the pair with the lower move category
+					if (proteins[y].move > proteins[x].move){
+							proteins[x].subject = "";
+							proteins[x].query = "";
+							proteins[x].move = REMOVED;
+							proteins[x].categories = "";
+							count++;
+							break;
+					}else{
+							proteins[y].subject = "";
+							proteins[y].query = "";
+							proteins[y].move = REMOVED;
+							proteins[y].categories = "";
+							count++;
+					}
+				}
+				y++;
+			}
+
+		}
+
+	}
+	progressMetrics().finish(progress);
+	return count;
+}
+
+categoryCounter::categoryCounter(const categoryTree& categories) : categories(categories), state(new counterState()){
+	initBriteCounts(categoryTreeAccess::tree(categories), state->counts);
+}
+
+categoryCounter::~categoryCounter(){
+}
+
+void categoryCounter::add(const movementCall& call){
+	countCategories(categoryTreeAccess::tree(categories), call.categories, call.move, state->counts, state->nodes);
+}
+
+void categoryCounter::add(const vector<movementCall>& calls){
+	for (int x = 0; x < calls.size(); x++){
+		add(calls[x]);
+	}
+}
+
+void categoryCounter::tables(categoryTables& result) const{
+	briteTree& kegTree = categoryTreeAccess::tree(categories);
+	string* levels[BRITE_LEVELS] = {&result.levelA, &result.levelB, &result.levelC};
+	for (int level = BRITE_A; level < BRITE_LEVELS; level++){
+		levels[level]->clear();
+		if (level != BRITE_B && kegTree.levelSize[level] == 0){
+			continue;
+		}
+		categoryCounts countData;
+		getLevelTable(kegTree, state->counts, level, countData);
+		BufferedWriter output;
+		output.attach(*levels[level]);
+		outputTable(countData, output);
+	}
+}
+
+movementConsensus::movementConsensus() : state(new consensusState()){
+}
+
+movementConsensus::~movementConsensus(){
+}
+
+void movementConsensus::add(string_view results){
+	vector<movementCall> calls;
+	parseMovements(results, calls);
+	add(calls);
+}
+
+//a protein listed more than once in a pair is one call, in its highest category
+void movementConsensus::add(const vector<movementCall>& calls){
+	vector<consensusShard>& shards = state->shards;
+	vector<vector<consensusCall> > buffers(shards.size());
+	unordered_map<string, pair<int, string> > proteinCalls; //protein -> highest call in the pair, product
+	progressStage& progress = progressMetrics().stage("consensus", "pairs");
+	for (int x = 0; x < calls.size(); x++){
+		const movementCall& result = calls[x];
+		if (x > 0 && result.pair != calls[x-1].pair){ //the calls of a pair are complete once the next one starts
+			addPairCalls(proteinCalls, buffers, shards);
+		}
+		string names[2] = {result.subject, result.query};
+		for (int y = 0; y < 2; y++){
+			if (names[y].length() == 0 || (y == 1 && names[1] == names[0])){
+				continue;
+			}
+			pair<int, string>& call = proteinCalls.emplace(names[y], make_pair(-1, string(""))).first->second;
+			call.first = max(call.first, result.move);
+			if (y == 0 && call.second == ""){
+				call.second = result.product;
+			}
+		}
+		progress.done.fetch_add(1, memory_order_relaxed);
+	}
+	addPairCalls(proteinCalls, buffers, shards);
+	for (int y = 0; y < buffers.size(); y++){
+		flushConsensusCalls(buffers[y], shards[y]);
+	}
+}
+
+void movementConsensus::tables(consensusTables& result) const{
+	vector<consensusShard>& shards = state->shards;
+	vector<pair<string, consensusCounter*> > proteins, families;
+	for (int x = 0; x < shards.size(); x++){
+		lock_guard<mutex> guard(shards[x].lock);
+		for (unordered_map<string, consensusCounter>::iterator it = shards[x].proteins.begin(); it != shards[x].proteins.end(); it++){
+			proteins.push_back(make_pair(it->first, &it->second));
+		}
+		for (unordered_map<string, consensusCounter>::iterator it = shards[x].families.begin(); it != shards[x].families.end(); it++){
+			families.push_back(make_pair(it->first, &it->second));
+		}
+	}
+	//sorted by name so the output doesn't depend on the shards or the threads
+	sort(proteins.begin(), proteins.end());
+	sort(families.begin(), families.end());
+	result.proteins.clear();
+	result.families.clear();
+	BufferedWriter proteinOutput, familyOutput;
+	proteinOutput.attach(result.proteins);
+	familyOutput.attach(result.families);
+	outputConsensusTable(proteins, "PROTEIN", true, proteinOutput);
+	outputConsensusTable(families, "FAMILY", false, familyOutput);
+	result.proteinCount = proteins.size();
+	result.familyCount = families.size();
+}
+
+}
+
+namespace{
+
+bool readNextMovement(movementReader& reader, synteny::movementCall& result){
+	string line = "";
+	while(getline(*reader.data, line)){
+		if (reader.inSection){
+			bool found = line.find("$$")!=string::npos; //'$$' indicates a line containing data
+			if (found){
+				buildResult(line, result);
+				result.move = reader.move;
+			}
+			if (line.find("**")!=string::npos){ //'**' indicates the end of the results
+				reader.inSection = false;
+			}
+			if (found){
+				return true;
+			}
+		}else if(line.find("!!")!= string::npos){ //indicates movement category line
+			reader.move = getMovementCategory(line);
+			reader.inSection = true;
+		}else if(line.compare(0, 2, "##") == 0){ //title of the next pair
+			reader.pair++;
+		}
+	}
+	return false;
+}
+
+
+int getMovementCategory(string line){
+	if (line.find("NOT_MOVED")!=string::npos){
+		return 0;
+	}
+	if (line.find("MOVED_ADJACENT")!=string::npos){
+		return 1;
+	}
+	if (line.find("MOVED_CONSERVED")!=string::npos){
+		return 2;
+	}
+	if (line.find("MOVED_MUTUAL_CONSERVED")!=string::npos){
+		return 3;
+	}
+	return -1;
+}
+
+void buildResult(string line, synteny::movementCall& result){
+	int pos=0;
+	int endPos;
+	string temp = "";
+	line =  line.substr(line.find("\t")+1); //moves past first tab
+	endPos = line.find("\t");
+	while(pos < endPos){
+		temp+=line[pos];
+		pos++;
+	}
+	result.subject = temp;
+	line = line.substr(line.find("\t")+1);//moves past subject
+	pos=0;
+	endPos = line.find("\t");
+	temp = "";
+	while(pos < endPos){
+		temp+=line[pos];
+		pos++;
+	}
+	result.query = temp;
+	line = line.substr(line.find("\t")+1); //moves past query
+	size_t product = line.find("/product=");
+	result.product = (product == string::npos) ? "" : line.substr(product+9);
+	line = line.substr(0,product); //doesnt include genbank product info
+	result.categories = line;
+}
+
+void addPairCalls(unordered_map<string, pair<int, string> >& proteinCalls, vector<vector<consensusCall> >& buffers,
+				  vector<consensusShard>& shards){
+	hash<string> hasher;
+	consensusCall call;
+	for (unordered_map<string, pair<int, string> >::iterator it = proteinCalls.begin(); it != proteinCalls.end(); it++){
+		call.name = it->first;
+		call.product = it->second.second;
+		call.move = it->second.first;
+		call.family = false;
+		if (call.move < 0){
+			continue;
+		}
+		int shard = hasher(call.name) % shards.size();
+		buffers[shard].push_back(call);
+		//a family is called once for every protein of the pair with its product that was listed as the subject
+		if (call.product != ""){
+			call.name = call.product;
+			call.product = "";
+			call.family = true;
+			shard = hasher(call.name) % shards.size();
+			buffers[shard].push_back(call);
+		}
+	}
+	proteinCalls.clear();
+	for (int x = 0; x < buffers.size(); x++){
+		if (buffers[x].size() >= CONSENSUS_BUFFER){
+			flushConsensusCalls(buffers[x], shards[x]);
+		}
+	}
+}
+
+void flushConsensusCalls(vector<consensusCall>& calls, consensusShard& shard){
+	lock_guard<mutex> guard(shard.lock);
+	for (int x = 0; x < calls.size(); x++){
+		unordered_map<string, consensusCounter>& table = calls[x].family ? shard.families : shard.proteins;
+		unordered_map<string, consensusCounter>::iterator found = table.find(calls[x].name);
+		if (found == table.end()){
+			consensusCounter counter = {{0, 0, 0, 0}, calls[x].product};
+			found = table.emplace(calls[x].name, counter).first;
+		}else if (found->second.product == ""){
+			found->second.product = calls[x].product;
+		}
+		found->second.counts[calls[x].move]++;
+	}
+	calls.clear();
+}
+
+void outputConsensusTable(vector<pair<string, consensusCounter*> >& rows, string title, bool products, BufferedWriter& outputFile){
+	outputFile << title << (products ? ",PRODUCT" : "") << ",PAIRS,UNMOVED,MOVED,MOVED.CONS,MUTUAL.CONS,CONSENSUS,AGREEMENT\n";
+	for (int x = 0; x < rows.size(); x++){
+		consensusCounter& counter = *rows[x].second;
+		string name = rows[x].first;
+		string product = counter.product;
+		//commas in products mess up the comma delimiting
+		name.erase(remove(name.begin(), name.end(), ','), name.end());
+		product.erase(remove(product.begin(), product.end(), ','), product.end());
+		int calls = 0;
+		int consensus = 0;
+		for (int move = 0; move < synteny::MOVEMENT_CATEGORIES; move++){
+			calls += counter.counts[move];
+			if (counter.counts[move] >= counter.counts[consensus]){ //ties go to the higher category
+				consensus = move;
+			}
+		}
+		outputFile << name << ",";
+		if (products){
+			outputFile << product << ",";
+		}
+		outputFile << calls;
+		for (int move = 0; move < synteny::MOVEMENT_CATEGORIES; move++){
+			outputFile << "," << counter.counts[move];
+		}
+		outputFile << "," << MOVEMENT_SECTIONS[consensus] << "," << (double)counter.counts[consensus]/calls << "\n";
+	}
+}
+
+}
@@ -0,0 +1,839 @@
+/***************************************************************************************************
+SyntenyDaemon
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This loads a genus once (the fasta, genbank and .brkeg of every organism and the blast
+		 results of every pair) and answers queries over a unix domain socket, so the movement of a
+		 gene or the counts of a category can be looked at with other settings without rerunning
+		 'synteny.sh' for every pair. Pairs are classified the same way as 'CompareOrthologs' (see
+		 OrthologClassifier.h) and the movement categories follow 'getKegResults'. The
+		 classification of every setting that has been asked for is kept in memory, so only the
+		 first query of a new setting classifies the pairs (on all cores).
+
+		 Queries are one line each, the reply is a tab-delimited table ending with a line 'END'
+		 (or 'ERROR<tab><message>' and 'END'):
+		 	PAIRS - the loaded pairs with their number of proteins and matches
+		 	GENE [settings] <protein> - movement of one protein against every organism it was paired
+		 	     with. The protein is a fasta ID, protein ID (with or without version) or locus tag
+		 	COUNT [settings] [category] - pairs of each movement category among the proteins of the
+		 	      category (a path or the name of any level of the BRITE tree with or without its commas,
+		 	      UNCATEGORIZED, or nothing for every protein), counted like 'FormatKegResults' counts the genus:
+		 	      the subject of each pair is its first organism and pairs that share a protein are
+		 	      removed as duplicates the same way
+		 	QUIT - closes the connection, SHUTDOWN - stops the daemon
+		 settings are the classification options of 'CompareOrthologs': -checkrange <n> -rangecutoff <n>
+		 -nearbycutoff <fraction> (e.g. 'COUNT -nearbycutoff 0.4 CARBOHYDRATE METABOLISM')
+
+Arguments: (1)socket path, (2)Name of directory/genus (no path, must be within 'fastas' directory)
+		   optional: -blast <directory> (directory holding the <organism>_and_<organism> blast results,
+		   			 repeatable, default blast_results/<genus> and blast_results)
+		   			 -wholegenome -onetoone (same as 'CompareOrthologs', used for every query)
+****************************************************************************************************/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "BriteTree.h"
+#include "OrthologClassifier.h"
+#include "Synteny.h"
+
+using namespace std;
+
+struct genomeData{ //one organism
+	string name; //fasta file name without the path or extension (the name 'synteny.sh' uses)
+	vector<string> proteinIDs; //fasta IDs in file order
+	vector<string> proteins; //protein as written by 'getKegResults' (text after '_prot_', upper case)
+	vector<bool> counted; //false for proteins 'getKegResults' skips (fasta IDs without 'lcl|')
+	vector<int> gene; //fasta position -> gene in the genbank (NO_PROTEIN if it isn't there)
+	vector<vector<string> > categories; //fasta position -> BRITE paths of its categories (empty = UNCATEGORIZED)
+	vector<synteny::genBankGene> genes;
+	genomeSegments segments;
+};
+
+struct genomePair{ //blast results of one pair (directory <first>_and_<second>)
+	int genomes[2]; //first and second organism
+	vector<int> matches[2]; //direction 0: first -> second (subject_<first>_query_<second>), 1: second -> first
+};
+
+struct pairClassification{ //moved and conserved bits of both directions of a pair
+	vector<uint64_t> movedBits[2];
+	vector<uint64_t> conservedBits[2];
+};
+
+struct countedProtein{ //a protein pair as listed by 'getKegResults' for the first organism of a pair
+	int pair;
+	int subject; //fasta position in the first organism
+	int query; //fasta position in the second organism
+	int move; //movementCategory
+};
+
+struct classifiedGenus{ //every pair classified with one setting
+	vector<pairClassification> pairs;
+	vector<countedProtein> counted; //proteins counted by COUNT (duplicates removed)
+};
+
+struct genusData{
+	vector<genomeData> genomes;
+	vector<genomePair> pairs; //sorted by directory name (the order 'FormatKegResults' reads them)
+	unordered_map<string, vector<pair<int, int> > > proteinsByName; //upper case fasta ID, protein or locus tag -> organism and fasta position
+	map<string, classifiedGenus> classified; //settings -> classification, built on first use
+	mutex classifiedLock;
+};
+
+struct clientConnections{ //connections being served, so SHUTDOWN can close them and wait for their threads
+	mutex lock;
+	map<int, int> sockets; //connection number -> socket, while the connection is open
+	vector<int> finished; //connections whose thread has closed its socket and is returning
+	map<int, thread> threads; //connection number -> thread serving it (only used by main)
+};
+
+enum movementCategory {NOT_MOVED = 0, MOVED_ADJACENT = 1, MOVED_CONSERVED = 2, MOVED_MUTUAL_CONSERVED = 3,
+					   NOT_MATCHED = -1, NOT_RECIPROCAL = -2};
+
+//finds the organisms of the genus (subdirectories of 'fastas/<genus>' with a .fasta) and loads them
+//returns false if there are fewer than two
+bool loadGenomes(string genusDirectory, bool splitReplicons, vector<genomeData>& genomes);
+
+//loads the genbank and .brkeg of one organism and matches them to its fasta. returns false if they can't be read
+bool loadGenome(synteny::organism& organism, bool splitReplicons, genomeData& genome);
+
+//indexes every protein by the names GENE accepts: its fasta ID, the protein of the fasta ID (text after
+//'_prot_') with and without its version, and the locus tags of its gene
+void indexProteinNames(genusData& genus);
+
+//finds the blast results of every pair of organisms in the blast directories and matches their proteins
+void loadPairs(vector<string>& blastDirectories, bool oneToOne, genusData& genus);
+
+//returns the classification of every pair with the settings, classifying them if it is the first query
+//with these settings. the returned classification is never changed again
+classifiedGenus& getClassification(genusData& genus, classifierParams& params);
+
+//classifies both directions of every pair with one thread per core
+void classifyPairs(genusData& genus, classifierParams& params, classifiedGenus& classified);
+
+//lists the protein pairs of every pair as 'getKegResults' does for the first organism and removes the
+//pairs 'FormatKegResults' removes as duplicates
+void buildCountedProteins(genusData& genus, classifiedGenus& classified);
+
+//marks the pairs that share a protein with an earlier kept pair, as 'FormatKegResults' removes duplicates: each
+//kept pair is compared with the later ones with its subject as their subject or query, or its query as their
+//subject (never query against query). the one with the lower movement category is removed (the later on ties)
+void removeDuplicatePairs(vector<int>& subjects, vector<int>& queries, vector<int>& moves, int proteins, vector<bool>& removed);
+
+//movement category of a subject protein of one direction of a pair (as 'getKegResults' sorts it)
+//NOT_RECIPROCAL if its match is matched to another protein or was classified differently the other way
+int getMovementCategory(genusData& genus, classifiedGenus& classified, int pair, int direction, int subject);
+
+//returns true if the socket path can be bound: removes the socket of a daemon that wasn't shut down (nothing
+//accepts connections on it), but not the socket of a running daemon or a file that isn't a socket
+bool removeStaleSocket(sockaddr_un& address);
+
+//reads the queries of one connection and writes the replies
+void serveClient(int connection, int client, genusData& genus, atomic<bool>& running, int server, clientConnections& connections);
+
+//takes a connection off the open sockets before its thread closes it, so main never shuts down a reused socket
+void closeConnection(clientConnections& connections, int connection);
+
+//answers one query, returns false if the connection should be closed
+bool answerQuery(string line, genusData& genus, BufferedWriter& reply, atomic<bool>& running);
+
+//takes the leading -checkrange/-rangecutoff/-nearbycutoff options of a query and returns the rest
+//returns false (with the error in 'error') if an option is not valid
+bool parseSettings(string& text, classifierParams& params, string& error);
+
+//query handlers
+void answerPairs(genusData& genus, BufferedWriter& reply);
+void answerGene(genusData& genus, classifierParams& params, string protein, BufferedWriter& reply);
+void answerCount(genusData& genus, classifierParams& params, string category, BufferedWriter& reply);
+
+//returns true if 'category' is one of the paths of a protein, one of their ancestors or the name of any level
+//commas are ignored, so the names written in the .csv tables (without their commas) can be used
+bool inCategory(vector<string>& paths, string& category);
+
+string getMovementName(int move);
+string upperCase(string line);
+string removePosition(string proteinID);
+string removeCommas(string name);
+
+const int LISTEN_BACKLOG = 16; //connections waiting to be accepted
+
+
+////////////////////////////MAIN//////////////////////////////////////////////////////
+int main(int argc, char *argv[]){
+	if (argc < 3){
+		cout << "missing arguments! Provide: socket path and the name of the genus (directory in 'fastas')" << endl;
+		cout << "optional: -blast <directory> (blast results of the pairs, default blast_results/<genus> and blast_results)" << endl;
+		cout << "          -wholegenome -onetoone (same as CompareOrthologs)" << endl;
+		return 0;
+	}
+	string socketPath = argv[1];
+	string genusName = argv[2];
+	vector<string> blastDirectories;
+	bool splitReplicons = true;
+	bool oneToOne = false;
+	for (int i = 3; i < argc; i++){
+		if (string(argv[i]) == "-blast" && i+1 < argc){
+			blastDirectories.push_back(argv[++i]);
+		}else if (string(argv[i]) == "-wholegenome"){
+			splitReplicons = false;
+		}else if (string(argv[i]) == "-onetoone"){
+			oneToOne = true;
+		}else{
+			cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:unknown option " << argv[i] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			return 0;
+		}
+	}
+	if (blastDirectories.empty()){ //after and before 'merge_genus.sh' moves them
+		blastDirectories.push_back("blast_results/" + genusName);
+		blastDirectories.push_back("blast_results");
+	}
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.length() >= sizeof(address.sun_path)){
+		cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:socket path is longer than " << sizeof(address.sun_path)-1 << " characters!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	strcpy(address.sun_path, socketPath.c_str());
+	//checked before loading the genus so a second daemon on the same socket stops right away
+	if (!removeStaleSocket(address)){
+		cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:" << socketPath << " is in use by a running daemon or is not a socket!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+
+	genusData genus;
+	cout << "Loading " << genusName << "..." << endl;
+	if (!loadGenomes("fastas/" + genusName, splitReplicons, genus.genomes)){
+		cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:fewer than two organisms in fastas/" << genusName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	loadPairs(blastDirectories, oneToOne, genus);
+	indexProteinNames(genus);
+	if (genus.pairs.empty()){
+		cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:no blast results found for the pairs of " << genusName << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	classifierParams defaults = {CHECK_RANGE, RANGE_CUTOFF, NEARBY_PROTEIN_CUTOFF};
+	getClassification(genus, defaults); //the default setting is ready before the first query
+	cout << genus.genomes.size() << " organisms, " << genus.pairs.size() << " pairs loaded" << endl;
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0 || bind(server, (sockaddr*)&address, sizeof(address)) != 0 || listen(server, LISTEN_BACKLOG) != 0){
+		cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:failed to listen on " << socketPath << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return 0;
+	}
+	signal(SIGPIPE, SIG_IGN); //a client that disconnects early only ends its own connection
+	cout << "Listening on " << socketPath << endl;
+
+	//every connection is served on its own thread, the loaded genus is shared
+	atomic<bool> running(true);
+	clientConnections connections;
+	vector<int> finished;
+	int connection = 0;
+	while (running){
+		int client = accept(server, NULL, NULL);
+		if (client < 0){
+			continue; //interrupted, or the socket was shut down by SHUTDOWN
+		}
+		{
+			lock_guard<mutex> lock(connections.lock);
+			finished.swap(connections.finished);
+			connections.sockets[connection] = client;
+		}
+		for (int x = 0; x < finished.size(); x++){ //threads of closed connections
+			connections.threads[finished[x]].join();
+			connections.threads.erase(finished[x]);
+		}
+		finished.clear();
+		connections.threads[connection] = thread(serveClient, connection, client, ref(genus), ref(running), server, ref(connections));
+		connection++;
+	}
+	close(server);
+	unlink(socketPath.c_str());
+	//connections waiting for a query stop reading, then every thread is done with the genus before it is freed
+	{
+		lock_guard<mutex> lock(connections.lock);
+		for (map<int, int>::iterator open = connections.sockets.begin(); open != connections.sockets.end(); open++){
+			shutdown(open->second, SHUT_RDWR);
+		}
+	}
+	for (map<int, thread>::iterator served = connections.threads.begin(); served != connections.threads.end(); served++){
+		served->second.join();
+	}
+	return 0;
+}
+
+
+////////////////////FUNCTIONS////////////////////////////////////////////////////////////////
+
+bool loadGenomes(string genusDirectory, bool splitReplicons, vector<genomeData>& genomes){
+	vector<synteny::organism> organisms;
+	synteny::loadOrganisms(genusDirectory, organisms);
+	for (int x = 0; x < organisms.size(); x++){
+		genomeData genome;
+		if (loadGenome(organisms[x], splitReplicons, genome)){
+			genomes.push_back(genome);
+		}
+	}
+	return genomes.size() >= 2;
+}
+
+bool loadGenome(synteny::organism& organism, bool splitReplicons, genomeData& genome){
+	genome.name = organism.name;
+	for (int x = 0; x < organism.proteins.proteins.size(); x++){
+		genome.proteinIDs.push_back(organism.proteins.proteins[x].id);
+	}
+	buildGenomeSegments(genome.proteinIDs, splitReplicons, genome.segments);
+
+	string genBank, keg; //inputs may be gzip or zstd compressed
+	briteTree kegTree;
+	string genBankName = synteny::findFile(organism.directory, ".gb");
+	string kegName = synteny::findFile(organism.directory, ".brkeg");
+	if (genBankName == "" || kegName == ""){
+		cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:no genbank or .brkeg for " << genome.name << ", its proteins are UNCATEGORIZED!!!!!!!!!!!!!!!!!!!!!" << endl;
+	}
+	if ((genBankName != "" && !synteny::readInput(genBankName, genBank)) || (kegName != "" && !synteny::readInput(kegName, keg))){
+		cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:failed to read the genbank or .brkeg of " << genome.name << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+		return false;
+	}
+	synteny::parseGenBank(genBank, genome.genes);
+	MemoryInput kegFile(keg.data(), keg.size());
+	parseBriteTree(kegFile, kegTree);
+	unordered_map<string, int> geneOf; //protein ID -> first gene of the genbank with it
+	for (int x = genome.genes.size()-1; x >= 0; x--){
+		geneOf[genome.genes[x].proteinID] = x;
+	}
+
+	int size = genome.proteinIDs.size();
+	genome.proteins.resize(size);
+	genome.counted.resize(size);
+	genome.gene.assign(size, NO_PROTEIN);
+	genome.categories.resize(size);
+	vector<int> nodes;
+	for (int x = 0; x < size; x++){
+		string& id = genome.proteinIDs[x];
+		size_t pos = id.find("_prot_");
+		genome.proteins[x] = upperCase((pos == string::npos) ? id : id.substr(pos+6));
+		genome.counted[x] = (id.find("lcl|") != string::npos);
+		unordered_map<string, int>::iterator found = geneOf.find(removePosition(genome.proteins[x]));
+		if (found == geneOf.end()){
+			continue;
+		}
+		genome.gene[x] = found->second;
+		//gets the categories listed for either locus tag
+		nodes.clear();
+		synteny::genBankGene& gene = genome.genes[found->second];
+		unordered_map<string, vector<int> >::iterator keg = kegTree.genes.find(gene.oldLocusTag);
+		if (keg != kegTree.genes.end()){
+			nodes.insert(nodes.end(), keg->second.begin(), keg->second.end());
+		}
+		keg = kegTree.genes.find(gene.locusTag);
+		if (keg != kegTree.genes.end()){
+			nodes.insert(nodes.end(), keg->second.begin(), keg->second.end());
+		}
+		sort(nodes.begin(), nodes.end()); //keeps the .brkeg order
+		nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+		for (int z = 0; z < nodes.size(); z++){
+			genome.categories[x].push_back(getBritePath(kegTree, nodes[z]));
+		}
+	}
+	return true;
+}
+
+void indexProteinNames(genusData& genus){
+	vector<string> names;
+	for (int g = 0; g < genus.genomes.size(); g++){
+		genomeData& genome = genus.genomes[g];
+		for (int x = 0; x < genome.proteinIDs.size(); x++){
+			names.clear();
+			names.push_back(upperCase(genome.proteinIDs[x]));
+			names.push_back(genome.proteins[x]);
+			names.push_back(removePosition(genome.proteins[x]));
+			if (genome.gene[x] != NO_PROTEIN){
+				names.push_back(genome.genes[genome.gene[x]].locusTag);
+				names.push_back(genome.genes[genome.gene[x]].oldLocusTag);
+			}
+			sort(names.begin(), names.end());
+			names.erase(unique(names.begin(), names.end()), names.end());
+			for (int n = 0; n < names.size(); n++){
+				if (names[n] != ""){
+					genus.proteinsByName[names[n]].push_back(make_pair(g, x));
+				}
+			}
+		}
+	}
+}
+
+//the blast results of the pair <first>_and_<second> are subject_<first>_query_<second>.txt and the
+//other direction, named as 'synteny.sh' names them
+void loadPairs(vector<string>& blastDirectories, bool oneToOne, genusData& genus){
+	vector<pair<string, genomePair> > found;
+	for (int x = 0; x < genus.genomes.size(); x++){
+		for (int y = 0; y < genus.genomes.size(); y++){
+			if (x == y){
+				continue;
+			}
+			string pairName = genus.genomes[x].name + "_and_" + genus.genomes[y].name;
+			for (int d = 0; d < blastDirectories.size(); d++){
+				string directory = blastDirectories[d] + "/" + pairName + "/";
+				CompressedInput forwardBlast, reverseBlast; //inputs may be gzip or zstd compressed
+				forwardBlast.open((directory + "subject_" + genus.genomes[x].name + "_query_" + genus.genomes[y].name + ".txt").c_str());
+				reverseBlast.open((directory + "subject_" + genus.genomes[y].name + "_query_" + genus.genomes[x].name + ".txt").c_str());
+				if (!forwardBlast.is_open() || !reverseBlast.is_open()){
+					continue;
+				}
+				genomePair genomes;
+				genomes.genomes[0] = x;
+				genomes.genomes[1] = y;
+				vector<string>& first = genus.genomes[x].proteinIDs;
+				vector<string>& second = genus.genomes[y].proteinIDs;
+				if (oneToOne){
+					genomes.matches[0] = getOneToOneMatches(forwardBlast, first, second);
+					genomes.matches[1] = getOneToOneMatches(reverseBlast, second, first);
+				}else{
+					genomes.matches[0] = getMatchPositions(forwardBlast, first, second);
+					genomes.matches[1] = getMatchPositions(reverseBlast, second, first);
+				}
+				if (forwardBlast.failed() || reverseBlast.failed()){ //e.g. a truncated .gz
+					cout << "!!!!!!!!!!!!!SyntenyDaemon ERROR:failed to read the blast results in " << directory << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+					break;
+				}
+				found.push_back(make_pair(pairName, genomes));
+				break; //the first directory that has the pair is used
+			}
+		}
+	}
+	sort(found.begin(), found.end(), [](const pair<string, genomePair>& a, const pair<string, genomePair>& b){
+		return a.first < b.first;
+	});
+	for (int x = 0; x < found.size(); x++){
+		genus.pairs.push_back(found[x].second);
+	}
+}
+
+classifiedGenus& getClassification(genusData& genus, classifierParams& params){
+	string key = to_string(params.checkRange) + " " + to_string(params.rangeCutoff) + " " + to_string(params.nearbyProteinCutoff);
+	lock_guard<mutex> lock(genus.classifiedLock); //queries with a new setting wait for the first one to classify it
+	map<string, classifiedGenus>::iterator found = genus.classified.find(key);
+	if (found != genus.classified.end()){
+		return found->second;
+	}
+	classifiedGenus& classified = genus.classified[key];
+	classifyPairs(genus, params, classified);
+	buildCountedProteins(genus, classified);
+	return classified;
+}
+
+void classifyPairs(genusData& genus, classifierParams& params, classifiedGenus& classified){
+	classified.pairs.assign(genus.pairs.size(), pairClassification());
+	int tasks = genus.pairs.size()*2; //each direction of each pair
+	atomic<int> next(0);
+	int threadCount = min<int>(max<int>(thread::hardware_concurrency(), 1), tasks);
+	vector<thread> workers;
+	for (int t = 0; t < threadCount; t++){
+		workers.push_back(thread([&](){
+			for (int task = next++; task < tasks; task = next++){
+				genomePair& pair = genus.pairs[task/2];
+				int direction = task%2;
+				genomeData& subject = genus.genomes[pair.genomes[direction]];
+				genomeData& query = genus.genomes[pair.genomes[1-direction]];
+				classifierParams settings = params;
+				classifyByNeighbours(pair.matches[direction], subject.segments, query.segments, settings,
+									 classified.pairs[task/2].movedBits[direction], classified.pairs[task/2].conservedBits[direction]);
+			}
+		}));
+	}
+	for (int t = 0; t < workers.size(); t++){
+		workers[t].join();
+	}
+}
+
+int getMovementCategory(genusData& genus, classifiedGenus& classified, int pair, int direction, int subject){
+	genomePair& genomes = genus.pairs[pair];
+	pairClassification& bits = classified.pairs[pair];
+	int query = genomes.matches[direction][subject];
+	if (query == NO_PROTEIN){
+		return NOT_MATCHED;
+	}
+	//'getKegResults' only keeps reciprocal matches that moved (or didn't) in both directions
+	bool moved = isMoved(bits.movedBits[direction], subject);
+	if (genomes.matches[1-direction][query] != subject || isMoved(bits.movedBits[1-direction], query) != moved){
+		return NOT_RECIPROCAL;
+	}
+	if (!moved){
+		return NOT_MOVED;
+	}
+	if (!isMoved(bits.conservedBits[direction], subject)){
+		return MOVED_ADJACENT;
+	}
+	return isMoved(bits.conservedBits[1-direction], query) ? MOVED_MUTUAL_CONSERVED : MOVED_CONSERVED;
+}
+
+//'getKegResults' lists the kept pairs in the order of the smaller direction (the forward direction if it
+//has fewer matches, otherwise the reverse), category by category. A pair that moved into a conserved region
+//only from the reverse perspective is listed as MOVED_ADJACENT and again as MOVED_CONSERVED
+void buildCountedProteins(genusData& genus, classifiedGenus& classified){
+	vector<countedProtein> listed;
+	vector<countedProtein> categories[4];
+	for (int p = 0; p < genus.pairs.size(); p++){
+		genomePair& genomes = genus.pairs[p];
+		genomeData& subject = genus.genomes[genomes.genomes[0]];
+		genomeData& query = genus.genomes[genomes.genomes[1]];
+		int matched[2] = {0, 0};
+		for (int direction = 0; direction < 2; direction++){
+			genomeData& genome = genus.genomes[genomes.genomes[direction]];
+			for (int x = 0; x < genomes.matches[direction].size(); x++){
+				int match = genomes.matches[direction][x];
+				matched[direction] += (match != NO_PROTEIN && (genome.counted[x] || genus.genomes[genomes.genomes[1-direction]].counted[match]));
+			}
+		}
+		int order = (matched[0] < matched[1]) ? 0 : 1; //direction whose subject order is kept
+		for (int c = 0; c < 4; c++){
+			categories[c].clear();
+		}
+		for (int x = 0; x < genomes.matches[order].size(); x++){
+			int s = (order == 0) ? x : genomes.matches[1][x];
+			if (s == NO_PROTEIN || (order == 1 && genomes.matches[0][s] != x)){
+				continue;
+			}
+			int move = getMovementCategory(genus, classified, p, 0, s);
+			if (move < 0 || (!subject.counted[s] && !query.counted[genomes.matches[0][s]])){
+				continue;
+			}
+			countedProtein protein = {p, s, genomes.matches[0][s], move};
+			categories[move].push_back(protein);
+			if (move == MOVED_ADJACENT && isMoved(classified.pairs[p].conservedBits[1], protein.query)){
+				protein.move = MOVED_CONSERVED;
+				categories[MOVED_CONSERVED].push_back(protein);
+			}
+		}
+		for (int c = 0; c < 4; c++){
+			listed.insert(listed.end(), categories[c].begin(), categories[c].end());
+		}
+	}
+
+	//numbers the proteins so the pairs sharing one can be listed
+	unordered_map<string, int> numbers; //protein -> number
+	vector<int> subjects(listed.size()), queries(listed.size()), moves(listed.size());
+	for (int x = 0; x < listed.size(); x++){
+		genomePair& genomes = genus.pairs[listed[x].pair];
+		string& subject = genus.genomes[genomes.genomes[0]].proteins[listed[x].subject];
+		string& query = genus.genomes[genomes.genomes[1]].proteins[listed[x].query];
+		subjects[x] = numbers.insert(make_pair(subject, numbers.size())).first->second;
+		queries[x] = numbers.insert(make_pair(query, numbers.size())).first->second;
+		moves[x] = listed[x].move;
+	}
+	vector<bool> removed(listed.size(), false);
+	removeDuplicatePairs(subjects, queries, moves, numbers.size(), removed);
+	for (int x = 0; x < listed.size(); x++){
+		if (!removed[x]){
+			classified.counted.push_back(listed[x]);
+		}
+	}
+}
+
+void removeDuplicatePairs(vector<int>& subjects, vector<int>& queries, vector<int>& moves, int proteins, vector<bool>& removed){
+	//pairs listing every protein as the subject and as the query, in listed order
+	vector<vector<int> > subjectPairs(proteins), queryPairs(proteins);
+	for (int x = 0; x < moves.size(); x++){
+		subjectPairs[subjects[x]].push_back(x);
+		queryPairs[queries[x]].push_back(x);
+	}
+	for (int x = 0; x < moves.size(); x++){
+		if (removed[x]){
+			continue;
+		}
+		//the later pairs with the subject as their subject or query and with the query as their subject
+		vector<int>* lists[3] = {&subjectPairs[subjects[x]], &queryPairs[subjects[x]], &subjectPairs[queries[x]]};
+		vector<int>::iterator next[3];
+		for (int y = 0; y < 3; y++){
+			next[y] = upper_bound(lists[y]->begin(), lists[y]->end(), x);
+		}
+		//walks the three lists together so the pairs are compared in listed order
+		while (!removed[x]){
+			int y = -1;
+			for (int k = 0; k < 3; k++){
+				if (next[k] != lists[k]->end() && (y < 0 || *next[k] < y)){
+					y = *next[k];
+				}
+			}
+			if (y < 0){
+				break;
+			}
+			for (int k = 0; k < 3; k++){
+				if (next[k] != lists[k]->end() && *next[k] == y){
+					next[k]++;
+				}
+			}
+			if (removed[y]){
+				continue;
+			}
+			//removes the pair with the lower move category
+			if (moves[y] > moves[x]){
+				removed[x] = true;
+			}else{
+				removed[y] = true;
+			}
+		}
+	}
+}
+
+bool removeStaleSocket(sockaddr_un& address){
+	struct stat info;
+	if (lstat(address.sun_path, &info) != 0){
+		return errno == ENOENT; //nothing to remove
+	}
+	if (!S_ISSOCK(info.st_mode)){
+		return false;
+	}
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (probe < 0){
+		return false;
+	}
+	bool listening = (connect(probe, (sockaddr*)&address, sizeof(address)) == 0);
+	int error = errno;
+	close(probe);
+	if (listening || error != ECONNREFUSED){
+		return false;
+	}
+	return unlink(address.sun_path) == 0;
+}
+
+void serveClient(int connection, int client, genusData& genus, atomic<bool>& running, int server, clientConnections& connections){
+	FILE* input = fdopen(client, "r");
+	FILE* output = fdopen(dup(client), "w");
+	if (input == NULL || output == NULL){
+		closeConnection(connections, connection);
+		if (input != NULL){
+			fclose(input);
+		}else{
+			close(client);
+		}
+		if (output != NULL){
+			fclose(output);
+		}
+		return;
+	}
+	BufferedWriter reply;
+	reply.attach(output);
+	char* buffer = NULL;
+	size_t capacity = 0;
+	ssize_t length;
+	while ((length = getline(&buffer, &capacity, input)) >= 0){
+		string line(buffer, length);
+		while (!line.empty() && (line.back() == '\n' || line.back() == '\r')){
+			line.pop_back();
+		}
+		bool open = answerQuery(line, genus, reply, running);
+		reply.flush();
+		if (!open){
+			break;
+		}
+	}
+	free(buffer);
+	reply.close();
+	if (!running){
+		shutdown(server, SHUT_RDWR); //wakes the accept loop so the daemon can exit
+	}
+	closeConnection(connections, connection);
+	fclose(output);
+	fclose(input);
+}
+
+void closeConnection(clientConnections& connections, int connection){
+	lock_guard<mutex> lock(connections.lock);
+	connections.sockets.erase(connection);
+	connections.finished.push_back(connection);
+}
+
+bool answerQuery(string line, genusData& genus, BufferedWriter& reply, atomic<bool>& running){
+	size_t start = line.find_first_not_of(" \t");
+	line = (start == string::npos) ? "" : line.substr(start);
+	size_t end = line.find_first_of(" \t");
+	string command = upperCase(line.substr(0, end));
+	start = (end == string::npos) ? string::npos : line.find_first_not_of(" \t", end);
+	string rest = (start == string::npos) ? "" : line.substr(start); //settings and the protein or category
+	if (command == ""){
+		return true;
+	}
+	if (command == "QUIT"){
+		return false;
+	}
+	if (command == "SHUTDOWN"){
+		running = false;
+		reply << "END\n";
+		return false;
+	}
+	classifierParams params = {CHECK_RANGE, RANGE_CUTOFF, NEARBY_PROTEIN_CUTOFF};
+	string error;
+	if (command == "PAIRS"){
+		answerPairs(genus, reply);
+	}else if (command != "GENE" && command != "COUNT"){
+		reply << "ERROR\tunknown query " << command << " (PAIRS, GENE, COUNT, QUIT or SHUTDOWN)\n";
+	}else if (!parseSettings(rest, params, error)){
+		reply << "ERROR\t" << error << "\n";
+	}else if (command == "GENE"){
+		answerGene(genus, params, rest, reply);
+	}else{
+		answerCount(genus, params, rest, reply);
+	}
+	reply << "END\n";
+	return true;
+}
+
+bool parseSettings(string& text, classifierParams& params, string& error){
+	while (text.length() > 0 && text[0] == '-'){
+		size_t end = text.find_first_of(" \t");
+		string option = text.substr(0, end);
+		size_t valueStart = (end == string::npos) ? string::npos : text.find_first_not_of(" \t", end);
+		if (valueStart == string::npos){
+			error = option + " needs a value";
+			return false;
+		}
+		size_t valueEnd = text.find_first_of(" \t", valueStart);
+		string value = text.substr(valueStart, valueEnd-valueStart);
+		if (option == "-checkrange"){
+			params.checkRange = atoi(value.c_str());
+		}else if (option == "-rangecutoff"){
+			params.rangeCutoff = atoi(value.c_str());
+		}else if (option == "-nearbycutoff"){
+			params.nearbyProteinCutoff = atof(value.c_str());
+		}else{
+			error = "unknown option " + option;
+			return false;
+		}
+		size_t next = (valueEnd == string::npos) ? string::npos : text.find_first_not_of(" \t", valueEnd);
+		text = (next == string::npos) ? "" : text.substr(next);
+	}
+	if (params.checkRange < 1 || params.checkRange > MAX_CHECK_RANGE || params.rangeCutoff < 0 ||
+		params.nearbyProteinCutoff < 0 || params.nearbyProteinCutoff > 1){
+		error = "-checkrange must be 1-" + to_string(MAX_CHECK_RANGE) + ", -rangecutoff >= 0 and -nearbycutoff 0-1";
+		return false;
+	}
+	return true;
+}
+
+void answerPairs(genusData& genus, BufferedWriter& reply){
+	reply << "Genome1\tGenome2\tProteins1\tProteins2\tMatched1\tMatched2\n";
+	for (int p = 0; p < genus.pairs.size(); p++){
+		genomePair& genomes = genus.pairs[p];
+		int matched[2] = {0, 0};
+		for (int direction = 0; direction < 2; direction++){
+			for (int x = 0; x < genomes.matches[direction].size(); x++){
+				matched[direction] += (genomes.matches[direction][x] != NO_PROTEIN);
+			}
+		}
+		reply << genus.genomes[genomes.genomes[0]].name << "\t" << genus.genomes[genomes.genomes[1]].name << "\t"
+			  << (int)genomes.matches[0].size() << "\t" << (int)genomes.matches[1].size() << "\t" << matched[0] << "\t" << matched[1] << "\n";
+	}
+}
+
+void answerGene(genusData& genus, classifierParams& params, string protein, BufferedWriter& reply){
+	protein = upperCase(protein);
+	unordered_map<string, vector<pair<int, int> > >::iterator found = genus.proteinsByName.find(protein);
+	if (found == genus.proteinsByName.end()){
+		reply << "ERROR\tno protein or locus tag " << protein << "\n";
+		return;
+	}
+	classifiedGenus& classified = getClassification(genus, params);
+	reply << "Genome\tProtein\tLocusTag\tOther\tOtherProtein\tMoved\tConserved\tOtherConserved\tMovement\tCategories\n";
+	for (int f = 0; f < found->second.size(); f++){
+		int g = found->second[f].first;
+		int x = found->second[f].second;
+		genomeData& genome = genus.genomes[g];
+		synteny::genBankGene* gene = (genome.gene[x] == NO_PROTEIN) ? NULL : &genome.genes[genome.gene[x]];
+		string categories = "UNCATEGORIZED";
+		for (int c = 0; c < genome.categories[x].size(); c++){
+			categories = (c == 0) ? genome.categories[x][c] : categories + ";" + genome.categories[x][c];
+		}
+		//every pair the organism is part of, from its side
+		for (int p = 0; p < genus.pairs.size(); p++){
+			genomePair& genomes = genus.pairs[p];
+			if (genomes.genomes[0] != g && genomes.genomes[1] != g){
+				continue;
+			}
+			int direction = (genomes.genomes[0] == g) ? 0 : 1;
+			genomeData& other = genus.genomes[genomes.genomes[1-direction]];
+			int match = genomes.matches[direction][x];
+			reply << genome.name << "\t" << genome.proteinIDs[x] << "\t" << ((gene == NULL) ? "" : gene->locusTag) << "\t" << other.name << "\t";
+			if (match == NO_PROTEIN){
+				reply << "\t\t\t\t";
+			}else{
+				pairClassification& bits = classified.pairs[p];
+				reply << other.proteinIDs[match] << "\t" << isMoved(bits.movedBits[direction], x) << "\t"
+					  << isMoved(bits.conservedBits[direction], x) << "\t" << isMoved(bits.conservedBits[1-direction], match) << "\t";
+			}
+			reply << getMovementName(getMovementCategory(genus, classified, p, direction, x)) << "\t" << categories << "\n";
+		}
+	}
+}
+
+void answerCount(genusData& genus, classifierParams& params, string category, BufferedWriter& reply){
+	category = upperCase(category);
+	classifiedGenus& classified = getClassification(genus, params);
+	int counts[4] = {0, 0, 0, 0};
+	for (int x = 0; x < classified.counted.size(); x++){
+		countedProtein& protein = classified.counted[x];
+		vector<string>& paths = genus.genomes[genus.pairs[protein.pair].genomes[0]].categories[protein.subject];
+		if (category == "" || (category == "UNCATEGORIZED" && paths.empty()) || inCategory(paths, category)){
+			counts[protein.move]++;
+		}
+	}
+	reply << "Category\tNOT_MOVED\tMOVED_ADJACENT\tMOVED_CONSERVED\tMOVED_MUTUAL_CONSERVED\n";
+	reply << ((category == "") ? "TOTAL" : category) << "\t" << counts[NOT_MOVED] << "\t" << counts[MOVED_ADJACENT] << "\t"
+		  << counts[MOVED_CONSERVED] << "\t" << counts[MOVED_MUTUAL_CONSERVED] << "\n";
+}
+
+bool inCategory(vector<string>& paths, string& category){
+	string wrapped = removeCommas(BRITE_PATH_SEPARATOR + category + BRITE_PATH_SEPARATOR);
+	for (int x = 0; x < paths.size(); x++){
+		if (removeCommas(BRITE_PATH_SEPARATOR + paths[x] + BRITE_PATH_SEPARATOR).find(wrapped) != string::npos){
+			return true;
+		}
+	}
+	return false;
+}
+
+string getMovementName(int move){
+	switch (move){
+		case NOT_MOVED : return "NOT_MOVED";
+		case MOVED_ADJACENT : return "MOVED_ADJACENT";
+		case MOVED_CONSERVED : return "MOVED_CONSERVED";
+		case MOVED_MUTUAL_CONSERVED : return "MOVED_MUTUAL_CONSERVED";
+		case NOT_MATCHED : return "NOT_MATCHED";
+	}
+	return "NOT_RECIPROCAL";
+}
+
+string upperCase(string line){
+	transform(line.begin(), line.end(), line.begin(), ::toupper);
+	return line;
+}
+
+string removePosition(string proteinID){
+	proteinID = proteinID.substr(0,proteinID.find("."));
+	return proteinID;
+}
+
+string removeCommas(string name){
+	name.erase(remove(name.begin(), name.end(), ','), name.end());
+	return name;
+}
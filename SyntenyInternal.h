@@ -0,0 +1,39 @@
+/***************************************************************************************************
+SyntenyInternal
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is the part of libsynteny that is only included by its own translation units: the
+		 objects that Synteny.h keeps behind pointers (the parsed .brkeg and the category counts).
+		 It uses the headers the library is built from, so it is not installed with Synteny.h and
+		 can change without changing SYNTENY_API_VERSION.
+****************************************************************************************************/
+#ifndef SYNTENY_INTERNAL_H
+#define SYNTENY_INTERNAL_H
+
+#include <vector>
+#include "BriteTree.h"
+#include "CategoryTable.h"
+#include "Synteny.h"
+
+namespace synteny{
+
+struct categoryTreeState{ //the parsed .brkeg of a categoryTree
+	briteTree tree;
+};
+
+struct categoryTreeAccess{ //gives the library the parsed .brkeg of a categoryTree
+	static briteTree& tree(const categoryTree& categories){
+		return categories.state->tree;
+	}
+};
+
+struct counterState{ //counts of a categoryCounter
+	briteCounts counts;
+	std::vector<int> nodes; //scratch space of countCategories
+};
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+/***************************************************************************************************
+SyntenyPlot
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This program renders the synteny plots of many 'CompareOrthologs' results into a single
+		 .svg in one process (e.g. every comparison within a genus) instead of starting R once per
+		 plot. Each results file becomes one panel of a grid, coloured the same way as
+		 makeSyntenyPlot.r (black = unmoved, blue = moved, red = moved into a conserved region).
+
+Arguments: (1)name of output .svg, (2...)any number of 'CompareOrthologs' results files
+****************************************************************************************************/
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+#include <cmath>
+#include "SyntenyPlot.h"
+
+using namespace std;
+
+//parses a 'CompareOrthologs' results file into a plot panel. returns false if it can't be opened
+bool parseMovementResults(string fileName, syntenyPanel& panel);
+
+//parses out the file name without the path or extension
+string getPanelTitle(string fileAndPath);
+
+int main(int argc, char *argv[]){
+	if (argc < 3){
+		cout << "missing arguments! Provide: output .svg and one or more 'CompareOrthologs' results files" << endl;
+		return 0;
+	}
+	vector<syntenyPanel> panels;
+	for (int i = 2; i < argc; i++){
+		syntenyPanel panel;
+		if (!parseMovementResults(argv[i], panel)){
+			cout << "!!!!!!!!!!!!!SyntenyPlot ERROR:failed to open " << argv[i] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+			continue;
+		}
+		panel.title = getPanelTitle(argv[i]);
+		panels.push_back(panel);
+	}
+	int columns = ceil(sqrt(double(panels.size()))); //keeps the grid roughly square
+	if (!writeSyntenyPlot(argv[1], panels, columns)){
+		cout << "!!!!!!!!!!!!!SyntenyPlot ERROR:failed to open " << argv[1] << "!!!!!!!!!!!!!!!!!!!!!" << endl;
+	}
+	return 0;
+}
+
+//columns: S_Prot_Name, Q_Prot_Name, Subject.Protein, Query.Protein, Movement.Adjacent, Adjacent.Conserved
+bool parseMovementResults(string fileName, syntenyPanel& panel){
+	ifstream results(fileName.c_str());
+	if (!results.is_open()){
+		return false;
+	}
+	panel.points.clear();
+	panel.maxSubject = 0;
+	panel.maxQuery = 0;
+	string line;
+	getline(results, line); //header
+	while (getline(results, line)){
+		int values[4];
+		int pos = 0;
+		for (int column = 0; column < 2 && pos != string::npos; column++){ //moves past the protein names
+			pos = line.find(",", pos);
+			if (pos != string::npos){
+				pos++;
+			}
+		}
+		if (pos == string::npos){
+			continue;
+		}
+		for (int column = 0; column < 4; column++){
+			values[column] = atoi(line.c_str() + pos);
+			pos = line.find(",", pos);
+			pos = (pos == string::npos) ? line.length() : pos+1;
+		}
+		int category = PLOT_UNMOVED;
+		if (values[2] > 0){
+			category = (values[3] > 0) ? PLOT_MOVED_CONSERVED : PLOT_MOVED;
+		}
+		addPlotPoint(panel, values[0], values[1], category);
+	}
+	return true;
+}
+
+string getPanelTitle(string fileAndPath){
+	string title = fileAndPath.substr(fileAndPath.rfind("/")+1); //removes path
+	return title.substr(0, title.rfind("."));
+}
@@ -0,0 +1,161 @@
+/***************************************************************************************************
+SyntenyPlot
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This renders synteny plots as SVG without starting R. Every matched protein is a point at
+		 (query position, subject position), coloured by its movement classification the same way
+		 as makeSyntenyPlot.r:
+		 	black = unmoved
+		 	blue = moved without adjacent proteins
+		 	red = moved without adjacent proteins into a conserved region
+		 A plot can hold a grid of panels so a whole genus can be rendered into one file.
+****************************************************************************************************/
+#ifndef SYNTENY_PLOT_H
+#define SYNTENY_PLOT_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include "BufferedWriter.h"
+
+enum plotCategory {PLOT_UNMOVED = 0, PLOT_MOVED = 1, PLOT_MOVED_CONSERVED = 2};
+
+struct plotPoint{ //one matched protein
+	int subject; //position in the subject fasta
+	int query; //position in the query fasta
+	int category; //plotCategory
+};
+
+struct syntenyPanel{ //one genome pair
+	std::string title;
+	std::vector<plotPoint> points;
+	int maxSubject; //largest subject position (y axis limit)
+	int maxQuery; //largest query position (x axis limit)
+};
+
+const int PLOT_PANEL_SIZE = 500; //width and height of each panel in pixels
+const int PLOT_MARGIN = 55; //space for the axes and title around each panel
+
+//adds a point to a panel and updates the axis limits
+inline void addPlotPoint(syntenyPanel& panel, int subject, int query, int category){
+	if (panel.points.empty()){
+		panel.maxSubject = 0;
+		panel.maxQuery = 0;
+	}
+	plotPoint point;
+	point.subject = subject;
+	point.query = query;
+	point.category = category;
+	panel.points.push_back(point);
+	if (subject > panel.maxSubject){
+		panel.maxSubject = subject;
+	}
+	if (query > panel.maxQuery){
+		panel.maxQuery = query;
+	}
+}
+
+//picks a round tick spacing that gives about 5 ticks up to 'limit'
+inline int getTickSpacing(int limit){
+	int spacing = 1;
+	while (limit / spacing > 5){
+		if (limit / (spacing*2) <= 5){
+			return spacing*2;
+		}
+		if (limit / (spacing*5) <= 5){
+			return spacing*5;
+		}
+		spacing*=10;
+	}
+	return spacing;
+}
+
+//replaces the characters xml reserves (& < > " ') so titles built from file names are valid svg text
+inline std::string escapeXml(const std::string& text){
+	std::string escaped;
+	escaped.reserve(text.length());
+	for (char c : text){
+		switch (c){
+			case '&': escaped += "&amp;"; break;
+			case '<': escaped += "&lt;"; break;
+			case '>': escaped += "&gt;"; break;
+			case '"': escaped += "&quot;"; break;
+			case '\'': escaped += "&apos;"; break;
+			default: escaped += c;
+		}
+	}
+	return escaped;
+}
+
+//draws one panel with its top left corner at (left, top)
+inline void renderSyntenyPanel(BufferedWriter& svg, syntenyPanel& panel, int left, int top){
+	const char* colours[3] = {"black", "blue", "red"};
+	int plotLeft = left + PLOT_MARGIN;
+	int plotTop = top + PLOT_MARGIN/2;
+	int size = PLOT_PANEL_SIZE - PLOT_MARGIN*3/2;
+	int maxQuery = (panel.points.empty() || panel.maxQuery < 1) ? 1 : panel.maxQuery;
+	int maxSubject = (panel.points.empty() || panel.maxSubject < 1) ? 1 : panel.maxSubject;
+	double xScale = double(size) / maxQuery;
+	double yScale = double(size) / maxSubject;
+
+	svg << "<g>\n";
+	svg << "<text x=\"" << plotLeft + size/2 << "\" y=\"" << top + PLOT_MARGIN/4 + 4 << "\" text-anchor=\"middle\" font-size=\"12\">" << escapeXml(panel.title) << "</text>\n";
+	svg << "<rect x=\"" << plotLeft << "\" y=\"" << plotTop << "\" width=\"" << size << "\" height=\"" << size << "\" fill=\"white\" stroke=\"black\"/>\n";
+
+	//grid lines and tick labels
+	int spacing = getTickSpacing(maxQuery);
+	for (int tick = 0; tick <= maxQuery; tick+=spacing){
+		double x = plotLeft + tick*xScale;
+		svg << "<line x1=\"" << x << "\" y1=\"" << plotTop << "\" x2=\"" << x << "\" y2=\"" << plotTop + size << "\" stroke=\"#e0e0e0\"/>\n";
+		svg << "<text x=\"" << x << "\" y=\"" << plotTop + size + 14 << "\" text-anchor=\"middle\" font-size=\"10\">" << tick << "</text>\n";
+	}
+	spacing = getTickSpacing(maxSubject);
+	for (int tick = 0; tick <= maxSubject; tick+=spacing){
+		double y = plotTop + size - tick*yScale;
+		svg << "<line x1=\"" << plotLeft << "\" y1=\"" << y << "\" x2=\"" << plotLeft + size << "\" y2=\"" << y << "\" stroke=\"#e0e0e0\"/>\n";
+		svg << "<text x=\"" << plotLeft - 4 << "\" y=\"" << y + 3 << "\" text-anchor=\"end\" font-size=\"10\">" << tick << "</text>\n";
+	}
+	svg << "<text x=\"" << plotLeft + size/2 << "\" y=\"" << plotTop + size + 30 << "\" text-anchor=\"middle\" font-size=\"11\">Query.Protein</text>\n";
+	svg << "<text x=\"" << left + 12 << "\" y=\"" << plotTop + size/2 << "\" text-anchor=\"middle\" font-size=\"11\" transform=\"rotate(-90 " << left + 12 << " " << plotTop + size/2 << ")\">Subject.Protein</text>\n";
+
+	//points are drawn in layers so moved proteins are on top like the R plot
+	for (int category = PLOT_UNMOVED; category <= PLOT_MOVED_CONSERVED; category++){
+		svg << "<g fill=\"none\" stroke=\"" << colours[category] << "\">\n";
+		for (int x = 0; x < panel.points.size(); x++){
+			if (panel.points[x].category >= category){
+				svg << "<circle cx=\"" << plotLeft + panel.points[x].query*xScale << "\" cy=\"" << plotTop + size - panel.points[x].subject*yScale << "\" r=\"2\"/>\n";
+			}
+		}
+		svg << "</g>\n";
+	}
+	svg << "</g>\n";
+}
+
+//writes all panels to an svg, 'columns' panels per row. returns false if the file can't be opened
+inline bool writeSyntenyPlot(std::string fileName, std::vector<syntenyPanel>& panels, int columns){
+	BufferedWriter svg;
+	if (!svg.open(fileName.c_str())){
+		return false;
+	}
+	if (columns < 1){
+		columns = 1;
+	}
+	int rows = (panels.size() + columns-1) / columns;
+	if (rows < 1){
+		rows = 1;
+	}
+	int width = PLOT_PANEL_SIZE * ((int)panels.size() < columns ? (panels.empty() ? 1 : (int)panels.size()) : columns);
+	int height = PLOT_PANEL_SIZE * rows;
+	svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height << "\" font-family=\"sans-serif\">\n";
+	svg << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+	for (int x = 0; x < panels.size(); x++){
+		renderSyntenyPanel(svg, panels[x], (x % columns)*PLOT_PANEL_SIZE, (x / columns)*PLOT_PANEL_SIZE);
+	}
+	svg << "</svg>\n";
+	svg.close();
+	return true;
+}
+
+#endif
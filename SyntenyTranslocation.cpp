@@ -0,0 +1,418 @@
+/***************************************************************************************************
+SyntenyTranslocation
+Purpose: This is a component of a series of programs designed to classify protein
+		 'movement' when comparing two organisms and determine if proteins belonging
+		 to different functional categories are more likely to 'move'
+
+		 This is checkTranslocation of libsynteny (see Synteny.h), the classification of
+		 'CheckTranslocation'. The subject proteins matched by the blast hits near a hit are compared to
+		 the proteins near its subject protein in the subject fasta, either a number of neighbouring hits
+		 and proteins or every protein within a distance in bases (using the locations in the fasta
+		 headers). A hit moved if fewer than THRESHOLD of its neighbours are shared.
+****************************************************************************************************/
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include "BufferedWriter.h"
+#include "CompressedInput.h"
+#include "Synteny.h"
+
+using namespace std;
+
+namespace{
+
+struct proteinLocation{ //coordinates parsed from the '[location=...]' field of a fasta header
+	string replicon; //sequence the protein is encoded on (e.g. NC_002163.1)
+	long start; //lowest base of the coding region
+	long end; //highest base of the coding region
+	bool complement; //true if encoded on the reverse strand
+	string text; //the whole location as written in the header (nested ones such as complement(join(...)) are no longer cut at the first ')')
+};
+
+struct proteinAlignment{
+	string qProtein;
+	string sProtein;
+	string eValue;
+	double percentIdentity;
+	string qPosition;
+	string sPosition;
+	proteinLocation qLocation;
+	proteinLocation sLocation;
+	bool hasMoved; 
+};
+
+struct locatedProtein{ //entry of the interval index
+	long start;
+	long end;
+	string protein;
+	bool operator<(const locatedProtein& other) const { return start < other.start; }
+};
+
+struct repliconIntervals{ //proteins of one replicon sorted by start position
+	vector<locatedProtein> proteins;
+	long maxLength; //longest protein, bounds how far back an overlap query has to look
+};
+
+typedef map<string, repliconIntervals> locationIndex; //replicon -> sorted intervals
+
+void parseBlastResults(istream& results, vector<proteinAlignment>& parsedResults);
+
+string getProteinName(string line);
+
+//converts the '[location=...]' field and replicon of a fasta header into a location
+//returns false if the header has no location
+bool getProteinLocation(const synteny::protein& record, proteinLocation& location);
+
+//parses the replicon out of a seqID (the text between 'lcl|' and '_prot_')
+string getRepliconName(string line);
+
+//adds subject and query positions to the structs using the locations parsed from both fastas
+void assignProteinLocations(vector<proteinAlignment>& parsedResults, unordered_map<string, proteinLocation>& queryLocations,
+							unordered_map<string, proteinLocation>& subjectLocations);
+
+//sorts the parsed locations into an interval index per replicon
+void buildLocationIndex(unordered_map<string, proteinLocation>& locations, locationIndex& index);
+
+//finds all proteins that overlap the region 'distance' bases up and downstream of a location (not including the protein itself)
+vector<string> findNearbyProteins(locationIndex& index, proteinLocation& location, string proteinName, long distance);
+
+vector<string> getProteinOrder(const synteny::genome& fasta, unordered_map<string, proteinLocation>& locations);
+
+//converts the subject order to a map of protein ID -> position (rank) in the subject fasta
+unordered_map<string, int> getProteinRanks(vector<string>& proteinOrder);
+
+//looks up the subject fasta rank of the subject protein of every blast result (NO_RANK if it isn't in the fasta)
+vector<int> getBlastRanks(vector<proteinAlignment>& parsedResults, unordered_map<string, int>& subjectRanks);
+
+void checkForTranslocation(int proteinsToCheck, double threshold, vector<string>& subjectProteins, vector<proteinAlignment>& parsedResults);
+
+//same as checkForTranslocation, but the neighbourhoods are all proteins within 'distance' bases instead of a number of proteins
+void checkForTranslocationByDistance(long distance, double threshold, locationIndex& queryIndex, locationIndex& subjectIndex,
+									 vector<string>& subjectProteins, vector<proteinAlignment>& parsedResults);
+
+//compares the subject ranks of the proteins near a match in the blast results to the ones near it in the fasta
+//both vectors are sorted in place
+bool isTranslocated(double threshold, vector<int>& nearbyBlastRanks, vector<int>& nearbyFastaRanks);
+
+void outputToFile(vector<proteinAlignment>& parsedResults, BufferedWriter& outputFile);
+
+const int CHECK_RANGE = 6; //number of upstream/downstream proteins to check for translocation
+
+const double THRESHOLD = 0.5; // cutoff for what is considered to have not moved
+
+const int NO_RANK = -1; //the protein is not in the subject fasta
+
+}
+
+namespace synteny{
+
+void checkTranslocation(string_view blast, const genome& query, const genome& subject, long distance, translocationResults& result){
+	vector<proteinAlignment> parsedResults; //vector of all protein alignment results
+	MemoryInput blastResults(blast.data(), blast.size());
+	parseBlastResults(blastResults, parsedResults); //parses data into vector of structs
+	
+	unordered_map<string, proteinLocation> queryLocations, subjectLocations;
+	vector<string> queryProteinOrder = getProteinOrder(query, queryLocations); //parses out a list of proteins in order of position from a fasta
+	vector<string> subjectProteinOrder = getProteinOrder(subject, subjectLocations);
+	assignProteinLocations(parsedResults, queryLocations, subjectLocations);
+	
+	if (distance > 0){
+		locationIndex queryIndex, subjectIndex;
+		buildLocationIndex(queryLocations, queryIndex);
+		buildLocationIndex(subjectLocations, subjectIndex);
+		checkForTranslocationByDistance(distance, THRESHOLD, queryIndex, subjectIndex, subjectProteinOrder, parsedResults);
+	}else{
+		checkForTranslocation(CHECK_RANGE, THRESHOLD, subjectProteinOrder, parsedResults); //checks all subject proteins for evidence of movement in genome
+	}
+	
+	result.results.clear();
+	BufferedWriter outputFile;
+	outputFile.attach(result.results);
+	outputToFile(parsedResults, outputFile);
+	outputFile.close();
+	result.hits.resize(parsedResults.size());
+	result.moved = 0;
+	for (int x = 0; x < parsedResults.size(); x++){
+		translocationHit& hit = result.hits[x];
+		hit.queryProtein = parsedResults[x].qProtein;
+		hit.subjectProtein = parsedResults[x].sProtein;
+		hit.eValue = parsedResults[x].eValue;
+		hit.percentIdentity = parsedResults[x].percentIdentity;
+		hit.moved = parsedResults[x].hasMoved;
+		hit.queryLocation = parsedResults[x].qPosition;
+		hit.subjectLocation = parsedResults[x].sPosition;
+		result.moved += hit.moved;
+	}
+}
+
+}
+
+namespace{
+
+//parses tab-delimited data and stores in approprate variables
+void parseBlastResults(istream& results, vector<proteinAlignment>& parsedResults){
+	proteinAlignment proteinData = proteinAlignment(); //fields missing from a line keep the values of the line before
+	for (string line; getline(results, line);){
+		int pos;
+		for (int x = 0; x < 4; x++){
+			pos = line.find("\t");
+			switch(x){	//can add more case statements as needed
+				case 0: proteinData.qProtein = getProteinName(line.substr(0, pos));
+				case 1: proteinData.sProtein = getProteinName(line.substr(0, pos));
+				case 2: proteinData.eValue = line.substr(0, pos);
+				case 3: proteinData.percentIdentity = atof(line.substr(0, line.length()).c_str());//converting to double
+			}
+			line = line.substr(pos+1, line.length()-pos);
+		}
+		parsedResults.push_back(proteinData);
+	}
+}
+
+string getProteinName(string line){ //parses out protein IDs from seqIDS
+	string proteinName = "";
+	int namePos = line.find("_prot_");
+	for (int x = (namePos+6); x < line.length() && line[x-2] != '.'; x++){ //ends after the version or at the end of an ID without one
+		proteinName+=line[x];
+	}
+	return proteinName;
+}
+
+//uses the proteins of a .fasta to make a vector of protein IDs in order of position in genome
+//the location of each protein is stored in 'locations'
+vector<string> getProteinOrder(const synteny::genome& fasta, unordered_map<string, proteinLocation>& locations){
+	vector<string> proteinOrder;
+	proteinLocation location;
+	for (int x = 0; x < fasta.proteins.size(); x++){
+		string proteinName = getProteinName(fasta.proteins[x].id);
+		proteinOrder.push_back(proteinName); //adds protein name to vector of proteins in order of location
+		if (getProteinLocation(fasta.proteins[x], location)){
+			locations[proteinName] = location;
+		}
+	}
+	return proteinOrder;
+}
+
+string getRepliconName(string line){
+	int pos = line.find("lcl|");
+	int endPos = line.find("_prot_");
+	if (pos == string::npos || endPos == string::npos || endPos < pos){
+		return "";
+	}
+	pos+=4;
+	return line.substr(pos, endPos-pos);
+}
+
+//the coordinates are parsed by the fasta index: simple ranges (123..456), partial ends (<123..>456),
+//complement(...) and join(...,...), spanning from the lowest to the highest base of all parts
+bool getProteinLocation(const synteny::protein& record, proteinLocation& location){
+	if (record.start < 0){
+		return false;
+	}
+	location.text = record.location;
+	location.replicon = getRepliconName(record.id);
+	location.complement = record.complement;
+	location.start = record.start;
+	location.end = record.end;
+	return true;
+}
+
+void assignProteinLocations(vector<proteinAlignment>& parsedResults, unordered_map<string, proteinLocation>& queryLocations,
+							unordered_map<string, proteinLocation>& subjectLocations){
+	unordered_map<string, proteinLocation>::iterator found;
+	for (int x = 0; x < parsedResults.size(); x++){
+		parsedResults[x].qLocation.start = -1;
+		parsedResults[x].sLocation.start = -1;
+		found = queryLocations.find(parsedResults[x].qProtein);
+		if (found != queryLocations.end()){
+			parsedResults[x].qLocation = found->second;
+			parsedResults[x].qPosition = found->second.text;
+		}
+		found = subjectLocations.find(parsedResults[x].sProtein);
+		if (found != subjectLocations.end()){
+			parsedResults[x].sLocation = found->second;
+			parsedResults[x].sPosition = found->second.text;
+		}
+	}
+}
+
+void buildLocationIndex(unordered_map<string, proteinLocation>& locations, locationIndex& index){
+	locatedProtein entry;
+	for (unordered_map<string, proteinLocation>::iterator it = locations.begin(); it != locations.end(); it++){
+		entry.start = it->second.start;
+		entry.end = it->second.end;
+		entry.protein = it->first;
+		repliconIntervals& replicon = index[it->second.replicon];
+		if (replicon.proteins.empty()){
+			replicon.maxLength = 0;
+		}
+		replicon.proteins.push_back(entry);
+		replicon.maxLength = max(replicon.maxLength, entry.end - entry.start);
+	}
+	for (locationIndex::iterator it = index.begin(); it != index.end(); it++){
+		sort(it->second.proteins.begin(), it->second.proteins.end());
+	}
+}
+
+//a protein overlaps [from, to] if it starts no later than 'to' and ends no earlier than 'from'. since no protein
+//is longer than maxLength only proteins starting at or after from-maxLength have to be checked
+vector<string> findNearbyProteins(locationIndex& index, proteinLocation& location, string proteinName, long distance){
+	vector<string> nearbyProteins;
+	if (location.start < 0){
+		return nearbyProteins;
+	}
+	locationIndex::iterator replicon = index.find(location.replicon);
+	if (replicon == index.end()){
+		return nearbyProteins;
+	}
+	long from = location.start - distance;
+	long to = location.end + distance;
+	vector<locatedProtein>& proteins = replicon->second.proteins;
+	locatedProtein first;
+	first.start = from - replicon->second.maxLength;
+	vector<locatedProtein>::iterator it = lower_bound(proteins.begin(), proteins.end(), first);
+	for (; it != proteins.end() && it->start <= to; it++){
+		if (it->end >= from && it->protein != proteinName){
+			nearbyProteins.push_back(it->protein);
+		}
+	}
+	return nearbyProteins;
+}
+
+//the blast neighbourhood of a match is the subject proteins matched by the query proteins near the query protein
+//this is compared to the subject proteins near the subject protein
+void checkForTranslocationByDistance(long distance, double threshold, locationIndex& queryIndex, locationIndex& subjectIndex,
+									 vector<string>& subjectProteins, vector<proteinAlignment>& parsedResults){
+	unordered_map<string, int> subjectRanks = getProteinRanks(subjectProteins);
+	vector<int> blastRanks = getBlastRanks(parsedResults, subjectRanks);
+	unordered_map<string, vector<int> > hitsByQuery; //query protein -> rows of the blast results
+	for (int x = 0; x < parsedResults.size(); x++){
+		hitsByQuery[parsedResults[x].qProtein].push_back(x);
+	}
+	vector<string> nearbyQueryProteins, nearbySubjectProteins;
+	vector<int> sBlastNearbyRanks, sFastaNearbyRanks;
+	for (int x = 0; x < parsedResults.size(); x++){
+		sBlastNearbyRanks.clear();
+		sFastaNearbyRanks.clear();
+		nearbyQueryProteins = findNearbyProteins(queryIndex, parsedResults[x].qLocation, parsedResults[x].qProtein, distance);
+		for (int y = 0; y < nearbyQueryProteins.size(); y++){
+			unordered_map<string, vector<int> >::iterator hits = hitsByQuery.find(nearbyQueryProteins[y]);
+			if (hits != hitsByQuery.end()){
+				for (int z = 0; z < hits->second.size(); z++){
+					sBlastNearbyRanks.push_back(blastRanks[hits->second[z]]);
+				}
+			}
+		}
+		nearbySubjectProteins = findNearbyProteins(subjectIndex, parsedResults[x].sLocation, parsedResults[x].sProtein, distance);
+		for (int y = 0; y < nearbySubjectProteins.size(); y++){
+			sFastaNearbyRanks.push_back(subjectRanks[nearbySubjectProteins[y]]);
+		}
+		parsedResults[x].hasMoved = isTranslocated(threshold, sBlastNearbyRanks, sFastaNearbyRanks);
+	}
+}
+
+
+unordered_map<string, int> getProteinRanks(vector<string>& proteinOrder){
+	unordered_map<string, int> ranks;
+	ranks.reserve(proteinOrder.size());
+	for (int x = 0; x < proteinOrder.size(); x++){
+		ranks.insert(make_pair(proteinOrder[x], x)); //keeps the first position if an ID is repeated
+	}
+	return ranks;
+}
+
+vector<int> getBlastRanks(vector<proteinAlignment>& parsedResults, unordered_map<string, int>& subjectRanks){
+	vector<int> blastRanks(parsedResults.size(), NO_RANK);
+	for (int x = 0; x < parsedResults.size(); x++){
+		unordered_map<string, int>::iterator found = subjectRanks.find(parsedResults[x].sProtein);
+		if (found != subjectRanks.end()){
+			blastRanks[x] = found->second;
+		}
+	}
+	return blastRanks;
+}
+
+//the neighbours of a match are the subject proteins of the 'proteinsToCheck' blast results before and after it
+//and the 'proteinsToCheck' proteins before and after its subject protein in the fasta. both wrap around
+//the end of the chromosome. all comparisons are done on subject fasta ranks
+void checkForTranslocation(int proteinsToCheck, double threshold, vector<string>& subjectProteins, vector<proteinAlignment>& parsedResults){
+	unordered_map<string, int> subjectRanks = getProteinRanks(subjectProteins);
+	vector<int> blastRanks = getBlastRanks(parsedResults, subjectRanks);
+	int totalResults = parsedResults.size();
+	int totalProteins = subjectProteins.size();
+	vector<int> sBlastNearbyRanks(proteinsToCheck*2), sFastaNearbyRanks(proteinsToCheck*2);
+	for (int x = 0; x < totalResults; x++){
+		int y = blastRanks[x];
+		if (y == NO_RANK){ //the subject protein isn't in the fasta so there is nothing to compare
+			parsedResults[x].hasMoved = false;
+			continue;
+		}
+		sBlastNearbyRanks.resize(proteinsToCheck*2);
+		sFastaNearbyRanks.resize(proteinsToCheck*2);
+		for (int z = 1; z <= proteinsToCheck; z++){
+			//downstream of the match, connecting the end of the chromosome with the start
+			sBlastNearbyRanks[proteinsToCheck+z-1] = blastRanks[(x+z) % totalResults];
+			sFastaNearbyRanks[proteinsToCheck+z-1] = (y+z) % totalProteins;
+			//upstream of the match (negative direction in the circular chromosome)
+			sBlastNearbyRanks[proteinsToCheck-z] = blastRanks[((x-z) % totalResults + totalResults) % totalResults];
+			sFastaNearbyRanks[proteinsToCheck-z] = ((y-z) % totalProteins + totalProteins) % totalProteins;
+		}
+		parsedResults[x].hasMoved = isTranslocated(threshold, sBlastNearbyRanks, sFastaNearbyRanks);
+	}
+}
+
+//counts every pair of equal ranks between the two neighbourhoods with a merge of the sorted lists
+bool isTranslocated(double threshold, vector<int>& nearbyBlastRanks, vector<int>& nearbyFastaRanks){
+	double matches = 0.0;
+	sort(nearbyBlastRanks.begin(), nearbyBlastRanks.end());
+	sort(nearbyFastaRanks.begin(), nearbyFastaRanks.end());
+	int x = 0;
+	int y = 0;
+	while (x < nearbyBlastRanks.size() && y < nearbyFastaRanks.size()){
+		if (nearbyBlastRanks[x] < nearbyFastaRanks[y]){
+			x++;
+		}else if (nearbyFastaRanks[y] < nearbyBlastRanks[x]){
+			y++;
+		}else{
+			int rank = nearbyBlastRanks[x];
+			int blastCount = 0;
+			int fastaCount = 0;
+			for (; x < nearbyBlastRanks.size() && nearbyBlastRanks[x] == rank; x++){
+				blastCount++;
+			}
+			for (; y < nearbyFastaRanks.size() && nearbyFastaRanks[y] == rank; y++){
+				fastaCount++;
+			}
+			if (rank != NO_RANK){
+				matches += blastCount*fastaCount;
+			}
+		}
+	}
+	if (matches/double(nearbyBlastRanks.size()) < threshold){
+		return true;
+	} else {
+		return false;
+	}
+}
+
+void outputToFile(vector<proteinAlignment>& parsedResults, BufferedWriter& outputFile){
+	outputFile << "query ID" << "\t" << "subject ID" << "\t" << "evalue" << "\t" << "Percent Identity" << "\t";
+	outputFile << "Moved" << "\t" << "query location" << "\t" << "subject location" << "\n";
+	for (int x = 0; x < parsedResults.size(); x++){
+		outputFile << parsedResults[x].qProtein << "\t";
+		outputFile << parsedResults[x].sProtein << "\t";
+		outputFile << parsedResults[x].eValue << "\t";
+		outputFile << parsedResults[x].percentIdentity << "\t";
+		if (parsedResults[x].hasMoved == true){
+			outputFile << "true" << "\t";
+		}else{
+			outputFile << "false" << "\t";
+		}
+		outputFile << parsedResults[x].qPosition << "\t";
+		outputFile << parsedResults[x].sPosition << "\n";
+	}
+}
+
+}
@@ -0,0 +1,65 @@
+#!/bin/sh
+
+############################################################################################
+#check_daemon_count.sh
+#Purpose: This is a component of a series of programs designed to classify protein
+#		  'movement' when comparing two organisms and determine if proteins belonging
+#		  to different functional categories are more likely to 'move'
+#
+#		 This script checks that the COUNT queries of 'SyntenyDaemon' give the same counts as the
+#		 table 'FormatKegResults' writes for the genus. It starts the daemon on a temporary socket,
+#		 asks COUNT for every category of the table and stops it. Exits 1 if a row differs.
+#		 Run it from the directory holding fastas/ and blast_results/, with the results made with
+#		 the default settings of 'CompareOrthologs'
+#
+#Arguments: (1)name of the genus (directory in 'fastas'), (2).brkeg file, (3)genus results from
+#		   'getKegResults' (anything 'FormatKegResults' reads), optional: any further arguments are
+#		   passed to 'SyntenyDaemon' (-blast <directory>, -wholegenome, -onetoone)
+#Environment: SYNTENY_BIN directory of the compiled programs (default: current directory)
+#			  needs 'nc' with unix socket support (-U) or 'socat'
+###########################################################################################
+
+bin=${SYNTENY_BIN:-.}
+if [ -z "$3" ]; then
+	echo "missing arguments! Provide: genus, .brkeg file and the genus results of 'getKegResults'"
+	exit 1
+fi
+genus=$1
+keg=$2
+results=$3
+shift 3
+work=$(mktemp -d "${TMPDIR:-/tmp}/check_daemon_count.XXXXXX") || exit 1
+trap 'rm -rf "$work"' EXIT
+
+${bin}/FormatKegResults $keg $results ${work}/format.csv > /dev/null
+
+${bin}/SyntenyDaemon ${work}/daemon.sock $genus "$@" > ${work}/daemon.log &
+daemon=$!
+while [ ! -S ${work}/daemon.sock ]; do
+	if ! kill -0 $daemon 2>/dev/null; then
+		cat ${work}/daemon.log
+		echo "!!!!!!!!!!!!!check_daemon_count ERROR:SyntenyDaemon did not start!!!!!!!!!!!!!!!!!!!!!"
+		exit 1
+	fi
+	sleep 1
+done
+
+#one COUNT per row of the table (the first line is the header), the connection ends with SHUTDOWN
+tail -n +2 ${work}/format.csv | cut -d, -f1 | sed 's/^/COUNT /' > ${work}/queries
+echo "SHUTDOWN" >> ${work}/queries
+if command -v nc > /dev/null; then
+	nc -U ${work}/daemon.sock < ${work}/queries > ${work}/replies
+else
+	socat - UNIX-CONNECT:${work}/daemon.sock < ${work}/queries > ${work}/replies
+fi
+wait $daemon
+
+#the count rows of the replies written like the rows of the table
+awk -F '\t' 'NF == 5 && $1 != "Category" {print $1 "," $2 "," $3 "," $4 "," $5}' ${work}/replies > ${work}/daemon.csv
+if ! tail -n +2 ${work}/format.csv | cmp -s - ${work}/daemon.csv; then
+	echo "!!!!!!!!!!!!!check_daemon_count ERROR:COUNT differs from the table of FormatKegResults!!!!!!!!!!!!!!!!!!!!!"
+	tail -n +2 ${work}/format.csv | diff - ${work}/daemon.csv
+	exit 1
+fi
+echo "SyntenyDaemon counts the genus the same as FormatKegResults"
+exit 0
@@ -0,0 +1,55 @@
+#!/bin/sh
+
+############################################################################################
+#check_format_memory.sh
+#Purpose: This is a component of a series of programs designed to classify protein
+#		  'movement' when comparing two organisms and determine if proteins belonging
+#		  to different functional categories are more likely to 'move'
+#
+#		 This script checks that 'FormatKegResults' writes the same tables with -memory (duplicates
+#		 removed out of core) as without it. Without arguments it checks pairs where the
+#		 duplicates have to be removed in file order: (A,B) removes (B,C), so (B,C) must not also
+#		 remove (C,D). Exits 1 if the tables differ
+#
+#Arguments: (1)optional: .brkeg file, (2)genus results from 'getKegResults' (anything
+#		   'FormatKegResults' reads), (3)optional: memory cap in MB (default 1)
+#Environment: SYNTENY_BIN directory of the compiled programs (default: current directory)
+###########################################################################################
+
+bin=${SYNTENY_BIN:-.}
+work=$(mktemp -d "${TMPDIR:-/tmp}/check_format_memory.XXXXXX") || exit 1
+trap 'rm -rf "$work"' EXIT
+
+if [ -n "$2" ]; then
+	keg=$1
+	results=$2
+else
+	keg=${work}/check.brkeg
+	results=${work}/check_kegCounts.csv
+	printf 'C\t<Cat1>\nG\t<A>\nG\t<B>\nG\t<C>\nG\t<D>\n' > $keg
+	printf '##PAIR1\n!!MOVED_CONSERVED!!\n$$\tA\tB\tCAT1\t/product=a\n**\n' > $results
+	printf '##PAIR2\n!!NOT_MOVED!!\n$$\tC\tD\tCAT1\t/product=c\n**\n' >> $results
+	printf '##PAIR3\n!!MOVED_ADJACENT!!\n$$\tB\tC\tCAT1\t/product=b\n**\n' >> $results
+fi
+memory=${3:-1}
+
+${bin}/FormatKegResults $keg $results ${work}/default.csv > /dev/null
+${bin}/FormatKegResults $keg $results ${work}/memory.csv -memory $memory -tmp $work > /dev/null
+
+#the A and C level tables are only written when the .brkeg has those levels
+status=0
+for table in default.csv default_levelA.csv default_levelC.csv; do
+	other=memory${table#default}
+	if [ ! -f ${work}/${table} ] && [ ! -f ${work}/${other} ]; then
+		continue
+	fi
+	if ! cmp -s ${work}/${table} ${work}/${other}; then
+		echo "!!!!!!!!!!!!!check_format_memory ERROR:${table} differs with -memory!!!!!!!!!!!!!!!!!!!!!"
+		diff ${work}/${table} ${work}/${other}
+		status=1
+	fi
+done
+if [ $status -eq 0 ]; then
+	echo "FormatKegResults writes the same tables with and without -memory"
+fi
+exit $status
@@ -0,0 +1,68 @@
+#!/bin/sh
+
+############################################################################################
+#genus_metrics.sh
+#Purpose: This is a component of a series of programs designed to classify protein
+#		  'movement' when comparing two organisms and determine if proteins belonging
+#		  to different functional categories are more likely to 'move'
+#
+#		 This script writes the progress of a genus run (pairs completed and remaining, pairs
+#		 per second and the ETA) in the Prometheus text format to
+#		 $SYNTENY_METRICS_DIR/synteny_genus_<genus>.prom, for a node-exporter textfile collector.
+#		 The file is written under a temporary name and renamed so it is never read half written.
+#		 It is run by 'run_genus.sh' and 'queue_genus.sh' after every pair and does nothing when
+#		 SYNTENY_METRICS_DIR is not set. The programs of each pair write their own stages next to it
+#		 (see ProgressMetrics.h)
+#
+#Arguments: (1)Name of directory/genus, (2)stage (pairs, merge or done), (3)pairs completed,
+#		   (4)pairs in the genus, (5)start of the run (unix time), (6)optional: current time (unix time,
+#		   default the clock of this machine)
+###########################################################################################
+
+if [ -z "$SYNTENY_METRICS_DIR" ]; then
+	exit 0
+fi
+genus=$1
+stage=$2
+completed=$3
+total=$4
+start=$5
+now=${6:-$(date +%s)}
+
+metrics=${SYNTENY_METRICS_DIR}/synteny_genus_${genus}.prom
+temp=${SYNTENY_METRICS_DIR}/.synteny_genus_${genus}.prom.$$
+
+awk -v genus="$genus" -v stage="$stage" -v completed=$completed -v total=$total -v start=$start -v now=$now 'BEGIN {
+	labels = "{genus=\"" genus "\"}"
+	elapsed = now - start
+	rate = (elapsed > 0) ? completed / elapsed : 0
+	remaining = (total > completed) ? total - completed : 0
+	if (remaining == 0) eta = 0
+	else if (rate > 0) eta = remaining / rate
+	else eta = "NaN"
+	print "# HELP synteny_genus_pairs_total Pairs of the genus that are compared"
+	print "# TYPE synteny_genus_pairs_total gauge"
+	print "synteny_genus_pairs_total" labels " " total
+	print "# HELP synteny_genus_pairs_completed Pairs that are done"
+	print "# TYPE synteny_genus_pairs_completed gauge"
+	print "synteny_genus_pairs_completed" labels " " completed
+	print "# HELP synteny_genus_pairs_remaining Pairs that are not done"
+	print "# TYPE synteny_genus_pairs_remaining gauge"
+	print "synteny_genus_pairs_remaining" labels " " remaining
+	print "# HELP synteny_genus_pairs_per_second Pairs completed per second since the run started"
+	print "# TYPE synteny_genus_pairs_per_second gauge"
+	print "synteny_genus_pairs_per_second" labels " " rate
+	print "# HELP synteny_genus_eta_seconds Estimated seconds until every pair is done"
+	print "# TYPE synteny_genus_eta_seconds gauge"
+	print "synteny_genus_eta_seconds" labels " " eta
+	print "# HELP synteny_genus_stage Stage of the run (1 for the current stage)"
+	print "# TYPE synteny_genus_stage gauge"
+	split("pairs merge done", stages, " ")
+	for (x = 1; x <= 3; x++) print "synteny_genus_stage{genus=\"" genus "\",stage=\"" stages[x] "\"} " (stages[x] == stage)
+	print "# HELP synteny_genus_start_time_seconds Start of the run (unix time)"
+	print "# TYPE synteny_genus_start_time_seconds gauge"
+	print "synteny_genus_start_time_seconds" labels " " start
+	print "# HELP synteny_genus_last_update_timestamp_seconds Time the metrics were written (unix time)"
+	print "# TYPE synteny_genus_last_update_timestamp_seconds gauge"
+	print "synteny_genus_last_update_timestamp_seconds" labels " " now
+}' > $temp && mv $temp $metrics
@@ -0,0 +1,75 @@
+#!/bin/sh
+
+############################################################################################
+#merge_genus.sh
+#Purpose: This is a component of a series of programs designed to classify protein
+#		  'movement' when comparing two organisms and determine if proteins belonging
+#		  to different functional categories are more likely to 'move'
+#
+#		 This script gathers the results of every pairwise comparison of a genus (made by
+#		 'synteny.sh') into one directory for the entire genus. It renders the genus synteny
+#		 plot, formats the 'getKegResults' output of every comparison with 'FormatKegResults'
+#		 into a table of keg category counts vs movement category and runs getPoissonValues.r
+#		 on the table. The movement of every protein in every pair is also stored with
+#		 'MovementMatrix', so the table can be recounted for a subset of pairs or organisms,
+#		 and the proteins of the genus are grouped into orthogroups with 'BuildOrthogroups'. It is run by 'run_genus.sh' and by the last worker of 'queue_genus.sh'
+#
+#Arguments: (1)Name of directory/genus (no path, must be within 'fastas' directory)
+#		   (2).brkeg used to build the table of categories
+#		   (3)optional: memory cap in MB for 'FormatKegResults'
+#Environment: SYNTENY_BIN directory of the compiled programs (default: current directory)
+###########################################################################################
+
+genus=$1
+g=${genus:0:1}
+keg=$2
+format_memory=$3
+bin=${SYNTENY_BIN:-.}
+
+mkdir synteny_results/${genus}
+
+#moves all synteny_results into a directory named after the genus
+for dir in synteny_results/${g}_*; do
+	mv ${dir} synteny_results/${genus}
+done
+if [ -f synteny_results/${genus}_sketchPairs.tsv ]; then #pairs that were skipped by 'SketchGenomes' and why
+	mv synteny_results/${genus}_sketchPairs.tsv synteny_results/${genus}/${genus}_sketchPairs.tsv
+fi
+
+#renders the synteny maps of every comparison in the genus as a single grid
+echo "Making genus synteny plot..."
+${bin}/SyntenyPlot synteny_results/${genus}/${genus}_syntenyMaps.svg synteny_results/${genus}/${g}_*/*_MovementResults.csv
+
+#moves all the blast results to a single directory named after the genus
+mkdir blast_results/${genus}
+mv blast_results/${g}_* blast_results/${genus}
+
+#joins the reciprocal best hits of every pair into orthogroups and counts the movement of each orthogroup over all pairs
+echo "Building orthogroups..."
+${bin}/BuildOrthogroups ${genus} synteny_results/${genus}/${genus}
+
+#parses the kegCounts.csv of every comparison in the genus directory (no concatenated copy is needed), counts the hits for each keg category base upon movement category, and stores in a .csv as a table
+#the offsets of every pair and movement category are saved to <genus>_movedProteins.idx so a subset of pairs can be re-aggregated with -pairs
+#how often each protein and gene family moved over all the pairs is written to <genus>_movementConsensus.csv and <genus>_movementConsensus_families.csv
+echo "Formatting genus KEGG results..."
+if [ -n "$format_memory" ]
+then
+	${bin}/FormatKegResults $keg synteny_results/${genus} synteny_results/${genus}/${genus}_formatted_movedProteins.csv -memory $format_memory -index synteny_results/${genus}/${genus}_movedProteins.idx -consensus synteny_results/${genus}/${genus}_movementConsensus.csv
+else
+	${bin}/FormatKegResults $keg synteny_results/${genus} synteny_results/${genus}/${genus}_formatted_movedProteins.csv -index synteny_results/${genus}/${genus}_movedProteins.idx -consensus synteny_results/${genus}/${genus}_movementConsensus.csv
+fi
+
+#stores the movement category of every protein in every pair, queried with 'MovementMatrix' row/column/count/table
+echo "Building movement matrix..."
+${bin}/MovementMatrix build synteny_results/${genus}/${genus}_movementMatrix.mtx synteny_results/${genus}
+
+#uses poisson distribution to determine probability of category counts occuring
+echo "Running Poisson approximations..."
+Rscript getPoissonValues.r synteny_results/${genus}/${genus}_formatted_movedProteins.csv synteny_results/${genus}/${genus}_poisson.csv synteny_results/${genus}/${genus}_Summary_Table.csv
+#top level (A) and pathway (C) tables are only made when the .brkeg files have those levels
+for level in A C; do
+	if [ -f synteny_results/${genus}/${genus}_formatted_movedProteins_level${level}.csv ]
+	then
+		Rscript getPoissonValues.r synteny_results/${genus}/${genus}_formatted_movedProteins_level${level}.csv synteny_results/${genus}/${genus}_poisson_level${level}.csv synteny_results/${genus}/${genus}_Summary_Table_level${level}.csv
+	fi
+done
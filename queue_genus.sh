@@ -0,0 +1,239 @@
+#!/bin/bash
+
+############################################################################################
+#queue_genus.sh
+#Purpose: This is a script designed to run another script made to run a series of programs
+#		  designed to classify protein 'movement' when comparing two organisms and determine
+#		  if proteins belonging to different functional categories are more likely to 'move'
+#
+#		 This does the same work as 'run_genus.sh', but the pairwise comparisons are shared
+#		 by any number of workers through a queue in a shared directory, so a large genus can
+#		 be run by several machines (or several processes on one machine) at once. Start the
+#		 same command on every machine from the same directory (on the shared filesystem).
+#		 There is no central service, everything is done with files in queue/<genus>:
+#			tasks/<pair>	one file per comparison (written once by the first worker)
+#			claims/<pair>	a worker owns a comparison while this directory exists (mkdir is atomic)
+#			claims/<pair>/lease	touched by the owner every LEASE/3 seconds. A claim whose lease
+#					hasn't been touched for LEASE seconds belongs to a dead worker and is taken over
+#			done/<pair>	the comparison finished (or failed MAX_ATTEMPTS times)
+#		 The blast databases of every organism are built before any comparison starts so two
+#		 comparisons never build the same database. When every comparison is done, the first
+#		 worker to see the queue empty runs 'merge_genus.sh' to merge the results of the genus
+#		 (if it dies while merging, remove queue/<genus>/merge and start a worker again).
+#		 Pairs are named after the fasta files like the directories made by 'synteny.sh'.
+#
+#Arguments: (1)Name of directory/genus (no path, must be within 'fastas' directory)
+#		   (2)optional: memory cap in MB for 'FormatKegResults' (for genera whose results don't fit in memory)
+#		   (3)optional: lease in seconds (default 600)
+#Environment: SYNTENY_MIN_IDENTITY, SYNTENY_MAX_IDENTITY band of estimated amino acid identity of the pairs
+#			 that are compared (see 'run_genus.sh')
+#			 SYNTENY_METRICS_DIR directory for the progress metrics of this machine (see 'run_genus.sh')
+###########################################################################################
+
+genus=$1
+g=${genus:0:1}
+format_memory=$2
+lease=${3:-600}
+
+queue=queue/${genus}
+worker=$(hostname)"."$$ #identifies the claims of this worker
+heartbeat=$((lease / 3))
+if [ $heartbeat -lt 1 ]; then
+	heartbeat=1
+fi
+MAX_ATTEMPTS=3 #a comparison that fails this many times is marked done so the genus can still be merged
+POLL=30 #seconds between checks while the remaining comparisons are claimed by other workers
+
+#the programs are compiled once per machine (machines may have different CPUs because of -march=native)
+#-lz -pthread are needed to read gzip/zstd compressed inputs (add -DSYNTENY_ZSTD -lzstd to use libzstd instead of the zstd program)
+export SYNTENY_BIN=bin/$(hostname)
+if mkdir -p bin && mkdir ${SYNTENY_BIN} 2>/dev/null
+then
+	#libsynteny (see Synteny.h) holds the analysis of CompareOrthologs, getKegResults and FormatKegResults
+	#BuildOrthogroups and SyntenyDaemon also use it to find the organisms of a genus and read their genbanks
+	for LIBRARY_SOURCE in Synteny SyntenyCompare SyntenyCategories SyntenyCounts SyntenyTranslocation
+	do
+		g++ -O2 -std=c++17 -march=native -fPIC -c ${LIBRARY_SOURCE}.cpp -o ${SYNTENY_BIN}/${LIBRARY_SOURCE}.o #-march=native enables the SSE4/AVX2 classifier
+	done
+	ar rcs ${SYNTENY_BIN}/libsynteny.a ${SYNTENY_BIN}/Synteny*.o
+	g++ -shared -o ${SYNTENY_BIN}/libsynteny.so ${SYNTENY_BIN}/Synteny*.o -lz -pthread
+	rm -f ${SYNTENY_BIN}/Synteny*.o
+	g++ -O2 -std=c++17 CompareOrthologs.cpp ${SYNTENY_BIN}/libsynteny.a -o ${SYNTENY_BIN}/CompareOrthologs -lz -pthread
+	g++ -O2 -std=c++17 getKegResults.cpp ${SYNTENY_BIN}/libsynteny.a -o ${SYNTENY_BIN}/getKegResults -lz -pthread
+	g++ -O2 -std=c++17 FormatKegResults.cpp ${SYNTENY_BIN}/libsynteny.a -o ${SYNTENY_BIN}/FormatKegResults -lz -pthread
+	g++ -O2 -std=c++17 MovementMatrix.cpp -o ${SYNTENY_BIN}/MovementMatrix -lz -pthread
+	g++ -O2 -std=c++17 -march=native BuildOrthogroups.cpp ${SYNTENY_BIN}/libsynteny.a -o ${SYNTENY_BIN}/BuildOrthogroups -lz -pthread
+	g++ -O2 -std=c++17 SyntenyPlot.cpp -o ${SYNTENY_BIN}/SyntenyPlot
+	g++ -O2 -std=c++17 SketchGenomes.cpp -o ${SYNTENY_BIN}/SketchGenomes -lz -pthread
+	g++ -O2 -std=c++17 -march=native SyntenyDaemon.cpp ${SYNTENY_BIN}/libsynteny.a -o ${SYNTENY_BIN}/SyntenyDaemon -lz -pthread
+	cp runBlastp.sh ${SYNTENY_BIN}/ #synteny.sh runs blast from SYNTENY_BIN like the programs
+	touch ${SYNTENY_BIN}/built
+fi
+while [ ! -f ${SYNTENY_BIN}/built ]; do #another process on this machine is compiling
+	sleep 5
+done
+
+#fasta file name without the path or extension (the name 'synteny.sh' uses for the organism)
+fasta_name() {
+	local name=$(echo $1/*.fasta)
+	name=${name%.*}
+	echo ${name##*/}
+}
+
+#current time of the shared filesystem (the clocks of the machines may not agree)
+shared_time() {
+	touch ${queue}/clock.${worker}
+	stat -c %Y ${queue}/clock.${worker}
+}
+
+#seconds since the lease of a claim was last touched (or the claim was made, if its owner died before
+#writing the lease), empty if the claim is gone
+lease_age() {
+	local touched
+	touched=$(stat -c %Y $1/lease 2>/dev/null || stat -c %Y $1 2>/dev/null) || return
+	echo $(( $(shared_time) - touched ))
+}
+
+#the first worker writes the task list and builds the blast databases, the others wait for it
+mkdir -p ${queue}
+if mkdir ${queue}/init 2>/dev/null
+then
+	echo "Building task list and blast databases..."
+	mkdir -p ${queue}/tasks ${queue}/claims ${queue}/done ${queue}/failed ${queue}/stale databases synteny_results
+	#pairs outside the identity band get no task (see 'SketchGenomes')
+	sketch_pairs=synteny_results/${genus}_sketchPairs.tsv
+	${SYNTENY_BIN}/SketchGenomes $sketch_pairs fastas/${genus}/${g}_*/*.fasta -min ${SYNTENY_MIN_IDENTITY:-0} -max ${SYNTENY_MAX_IDENTITY:-1}
+	for org1 in fastas/${genus}/${g}_*; do
+		name1=$(fasta_name ${org1})
+		if [ ! -d databases/${name1} ]; then
+			mkdir databases/${name1}
+			makeblastdb -in ${org1}/*.fasta -out databases/${name1}/${name1}
+		fi
+		#same pairs as run_genus.sh: each pair once, in the order it first appears
+		found=0
+		for org2 in fastas/${genus}/${g}_*; do
+			name2=$(fasta_name ${org2})
+			if [ $found -eq 1 ] && ! awk -F'\t' -v a=$name1 -v b=$name2 '$1 == a && $2 == b && $5 == "skip" {found = 1} END {exit !found}' $sketch_pairs
+			then
+				echo "$org1 $org2" > ${queue}/tasks/${name1}_and_${name2}
+			fi
+			if [ "$org1" = "$org2" ]; then
+				found=1
+			fi
+		done
+	done
+	touch ${queue}/ready
+fi
+while [ ! -f ${queue}/ready ]; do
+	sleep 5
+done
+
+#runs one claimed comparison while a background loop keeps its lease fresh
+run_task() {
+	local pair=$1
+	local claim=${queue}/claims/${pair}
+	local org1 org2
+	read org1 org2 < ${queue}/tasks/${pair}
+	( while [ -f ${claim}/owner ]; do touch ${claim}/lease 2>/dev/null; sleep ${heartbeat}; done ) &
+	local keeper=$!
+
+	#output left by a worker that died during this comparison would be reused by synteny.sh
+	rm -rf blast_results/${pair} synteny_results/${pair}
+	echo $pair
+	./synteny.sh ${org1}/*.fasta ${org2}/*.fasta ${org1}/*.gb ${org1}/*.brkeg
+
+	kill ${keeper} 2>/dev/null
+	wait ${keeper} 2>/dev/null
+	if [ "$(cat ${claim}/owner 2>/dev/null)" != "${worker}" ]; then
+		echo "lost the claim on ${pair}, its results are left to the worker that took it over"
+		return
+	fi
+	if [ -f synteny_results/${pair}/kegCounts.csv ]; then
+		touch ${queue}/done/${pair}
+	else
+		echo ${worker} >> ${queue}/failed/${pair}
+		if [ $(wc -l < ${queue}/failed/${pair}) -ge ${MAX_ATTEMPTS} ]; then
+			echo "!!!!!!!!!!!!!queue_genus ERROR:${pair} failed ${MAX_ATTEMPTS} times, it is left out of the genus results!!!!!!!!!!!!!!!!!!!!!"
+			touch ${queue}/done/${pair}
+		fi
+	fi
+	rm -rf ${claim}
+}
+
+#takes the claim of a pair. an expired claim is moved aside (rename is atomic, so only one worker can take
+#it over) and checked again in case its owner renewed it in the meantime
+claim_task() {
+	local pair=$1
+	local claim=${queue}/claims/${pair}
+	if ! mkdir ${claim} 2>/dev/null; then
+		local age=$(lease_age ${claim})
+		if [ -z "$age" ] || [ $age -lt $lease ]; then
+			return 1 #claimed by a live worker
+		fi
+		local aside=${queue}/stale/${pair}.${worker}
+		mv ${claim} ${aside} 2>/dev/null || return 1
+		age=$(lease_age ${aside})
+		if [ -n "$age" ] && [ $age -lt $lease ]; then
+			mv ${aside} ${claim} 2>/dev/null
+			return 1
+		fi
+		echo "taking over ${pair} from $(cat ${aside}/owner 2>/dev/null)"
+		rm -rf ${aside}
+		mkdir ${claim} 2>/dev/null || return 1
+	fi
+	touch ${claim}/lease
+	echo ${worker} > ${claim}/owner
+	if [ -f ${queue}/done/${pair} ]; then #finished by another worker since the queue was checked
+		rm -rf ${claim}
+		return 1
+	fi
+	return 0
+}
+
+#progress of the whole queue as seen by this worker (in shared filesystem time)
+write_metrics() {
+	local completed=$(ls ${queue}/done | wc -l)
+	local total=$(ls ${queue}/tasks | wc -l)
+	./genus_metrics.sh $genus $1 $completed $total $(stat -c %Y ${queue}/ready) $(shared_time)
+}
+
+#drains the queue
+while true; do
+	remaining=0
+	ran=0
+	for task in ${queue}/tasks/*; do
+		pair=${task##*/}
+		if [ -f ${queue}/done/${pair} ]; then
+			continue
+		fi
+		remaining=$((remaining + 1))
+		if claim_task ${pair}; then
+			run_task ${pair}
+			write_metrics pairs
+			ran=1
+		fi
+	done
+	if [ $remaining -eq 0 ]; then
+		break
+	fi
+	if [ $ran -eq 0 ]; then #everything left is claimed by other workers, checks again later
+		write_metrics pairs
+		sleep ${POLL}
+	fi
+done
+write_metrics pairs
+rm -f ${queue}/clock.${worker}
+
+#the first worker to find the queue empty merges the results
+if mkdir ${queue}/merge 2>/dev/null
+then
+	for org in fastas/${genus}/${g}_*; do
+		keg=${org}/*.brkeg
+	done
+	./genus_metrics.sh $genus merge $(ls ${queue}/done | wc -l) $(ls ${queue}/tasks | wc -l) $(stat -c %Y ${queue}/ready)
+	./merge_genus.sh $genus $keg $format_memory
+	touch ${queue}/merged
+	./genus_metrics.sh $genus done $(ls ${queue}/done | wc -l) $(ls ${queue}/tasks | wc -l) $(stat -c %Y ${queue}/ready)
+else
+	echo "all comparisons are done, the results are merged by another worker"
+fi
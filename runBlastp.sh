@@ -1,14 +1,62 @@
 #!/bin/sh
+
+############################################################################################
+#runBlastp.sh
+#Purpose: This is a component of a series of programs designed to classify protein
+#		  'movement' when comparing two organisms and determine if proteins belonging
+#		  to different functional categories are more likely to 'move'
+#
+#		 This runs blastp for one direction of a comparison. When the fasta the database was
+#		 made from is given, the results are kept in a cache (blast_cache/, or $SYNTENY_BLAST_CACHE)
+#		 named after the contents of the query fasta, the database fasta and the blast settings:
+#			<sha256 of query>_<sha256 of database fasta>_<sha256 of settings>.tsv.gz
+#		 so the same direction is never blasted twice, whatever the pair, directory or genome
+#		 files are called (e.g. subject A/query B of the pair 'B_and_A' is the same search as in
+#		 'A_and_B'). The cache holds the gzip compressed hit table (6 qseqid sseqid evalue pident)
+#
+#Arguments: (1)query .fasta, (2)blast database, (3)output file, (4)optional: .fasta the database was made from
+###########################################################################################
+
 sequence=$1
 database=$2
 out_file=$3
+database_fasta=$4
+
+#blast settings, any change to them is part of the cache key
+evalue="1E-20"
+outfmt="6 qseqid sseqid evalue pident"
+max_targets=1
+
+cache=${SYNTENY_BLAST_CACHE:-blast_cache}
+
+run_blastp() {
+	blastp\
+	 -query $sequence\
+	 -db $database\
+	 -evalue $evalue\
+	 -out $1\
+	 -outfmt "$outfmt"\
+	 -max_target_seqs $max_targets\
+	 -num_threads 8
+}
+
+if [ -z "$database_fasta" ]; then
+	run_blastp $out_file
+	exit
+fi
+
+query_hash=$(sha256sum < $sequence | cut -c1-64)
+database_hash=$(sha256sum < $database_fasta | cut -c1-64)
+settings_hash=$(echo "blastp $evalue $outfmt $max_targets" | sha256sum | cut -c1-64)
+cached=${cache}/${query_hash}_${database_hash}_${settings_hash}.tsv.gz
 
-blastp\
- -query $sequence\
- -db $database\
- -evalue 1E-20\
- -out $out_file\
- -outfmt "6 qseqid sseqid evalue pident"\
- -max_target_seqs 1\
- -num_threads 8
+if [ -f $cached ]; then
+	echo "blast results loaded from cache ($cached)"
+	gzip -dc $cached > $out_file
+	exit
+fi
 
+mkdir -p $cache
+run_blastp $out_file || exit 1
+#written under a temporary name first so a parallel run never reads a partial cache entry
+gzip -c $out_file > ${cached}.$$ && mv ${cached}.$$ $cached
@@ -11,23 +11,55 @@
 #		  if proteins belonging to different functional categories are more likely to 'move'
 #		 
 #		 This script is used to run 'synteny.sh' for each subdirectory of a given directory.
-#		 It also concatenates the 'getKegResults' output into a single file for the entire
-#		 directory. This is then parsed and formatted by 'FormatKegResults' to produce a
-#		 .csv file containing a table of keg category counts vs movement category. These
-#		 combined results are used by getPoissonValues.r to determine statistical significance
+#		 It then runs 'merge_genus.sh', which gathers the 'getKegResults' output of every comparison
+#		 into one directory for the entire directory. These are then parsed and formatted by
+#		 'FormatKegResults' to produce a .csv file containing a table of keg category counts vs
+#		 movement category. These combined results are used by getPoissonValues.r to determine
+#		 statistical significance
+#		 (use 'queue_genus.sh' instead to share the comparisons between several machines)
 #
 #Arguments: (1)Name of directory/genus (no path, must be within 'fastas' directory)
+#		   (2)optional: memory cap in MB for 'FormatKegResults' (for genera whose results don't fit in memory)
+#Environment: SYNTENY_MIN_IDENTITY, SYNTENY_MAX_IDENTITY band of estimated amino acid identity (from
+#			 'SketchGenomes') of the pairs that are compared (default 0-1, every pair)
+#			 SYNTENY_METRICS_DIR directory for the progress metrics of the run and of its programs
+#			 (Prometheus textfiles, see 'genus_metrics.sh')
 ###########################################################################################
 
 
-g++ CompareOrthologs.cpp -o CompareOrthologs
-g++ getKegResults.cpp -o getKegResults
-g++ FormatKegResults.cpp -o FormatKegResults
+#-lz -pthread are needed to read gzip/zstd compressed inputs (add -DSYNTENY_ZSTD -lzstd to use libzstd instead of the zstd program)
+#libsynteny (see Synteny.h) holds the analysis of CompareOrthologs, getKegResults, FormatKegResults and CheckTranslocation
+#BuildOrthogroups and SyntenyDaemon also use it to find the organisms of a genus and read their genbanks
+g++ -O2 -std=c++17 -march=native -fPIC -c Synteny.cpp SyntenyCompare.cpp SyntenyCategories.cpp SyntenyCounts.cpp SyntenyTranslocation.cpp #-march=native enables the SSE4/AVX2 classifier
+ar rcs libsynteny.a Synteny*.o
+g++ -shared -o libsynteny.so Synteny*.o -lz -pthread
+rm -f Synteny*.o
+g++ -O2 -std=c++17 CompareOrthologs.cpp libsynteny.a -o CompareOrthologs -lz -pthread
+g++ -O2 -std=c++17 getKegResults.cpp libsynteny.a -o getKegResults -lz -pthread
+g++ -O2 -std=c++17 FormatKegResults.cpp libsynteny.a -o FormatKegResults -lz -pthread
+g++ -O2 -std=c++17 MovementMatrix.cpp -o MovementMatrix -lz -pthread
+g++ -O2 -std=c++17 -march=native BuildOrthogroups.cpp libsynteny.a -o BuildOrthogroups -lz -pthread
+g++ -O2 -std=c++17 SyntenyPlot.cpp -o SyntenyPlot
+g++ -O2 -std=c++17 SketchGenomes.cpp -o SketchGenomes -lz -pthread
+g++ -O2 -std=c++17 -march=native SyntenyDaemon.cpp libsynteny.a -o SyntenyDaemon -lz -pthread #optional, answers queries on a loaded genus (see documentation)
 
 #the only argument passed is the name of the genus
 #this should match the directory where the fastas are stored in fastas/
 genus=$1
 g=${genus:0:1}
+format_memory=$2
+
+#estimates the similarity of every pair from MinHash sketches of the proteomes and marks the pairs outside the
+#identity band as skipped (the reasons are kept in the genus results as sketchPairs.tsv)
+mkdir -p synteny_results
+sketch_pairs=synteny_results/${genus}_sketchPairs.tsv
+./SketchGenomes $sketch_pairs fastas/${genus}/${g}_*/*.fasta -min ${SYNTENY_MIN_IDENTITY:-0} -max ${SYNTENY_MAX_IDENTITY:-1}
+
+#progress of the run for monitoring (pairs that weren't skipped by 'SketchGenomes')
+start_time=$(date +%s)
+pairs_total=$(awk -F'\t' 'NR > 1 && $5 == "run"' $sketch_pairs | wc -l)
+pairs_done=0
+./genus_metrics.sh $genus pairs $pairs_done $pairs_total $start_time
 
 #runs avery pairwise comparison without duplicates
 for org1 in fastas/${genus}/${g}_*; do
@@ -44,34 +76,24 @@ for org1 in fastas/${genus}/${g}_*; do
 		file2Name=${file2Name##*/}
 		if [ $org1 != $org2 ] && [ ! -d "blast_results/"$file2Name"_and_"$file1Name ] #makes sure this hasen't been run before
 		then
+			if awk -F'\t' -v a=$(basename $fasta1 .fasta) -v b=$(basename $fasta2 .fasta) \
+				'(($1 == a && $2 == b) || ($1 == b && $2 == a)) && $5 == "skip" {found = 1} END {exit !found}' $sketch_pairs
+			then
+				echo skipping $file1Name and $file2Name
+				continue
+			fi
 			echo $file1Name and $file2Name
 			#echo $fasta1 and $fasta2
 			./synteny.sh $fasta1 $fasta2 $gb1 $keg1
+			pairs_done=$((pairs_done + 1))
+			./genus_metrics.sh $genus pairs $pairs_done $pairs_total $start_time
 		fi
 	done
 done
 
 
 
-mkdir synteny_results/${genus}
-touch synteny_results/${genus}/${genus}_movedProteins.txt
-
-#moves all synteny_results into a directory named after the genus
-for dir in synteny_results/${g}_*; do
-	cat ${dir}/kegCounts.csv >> synteny_results/${genus}/${genus}_movedProteins.txt #concatenates all results for a genus into a single file
-	mv ${dir} synteny_results/${genus}
-done
-
-#moves all the blast results to a single directory named after the genus
-mkdir blast_results/${genus}
-mv blast_results/${g}_* blast_results/${genus}
-
-#parses the concatenated results, counts the hits for each keg category base upon movement category, and stores in a .csv as a table
-echo "Formatting genus KEGG results..."
-./FormatKegResults $keg1 synteny_results/${genus}/${genus}_movedProteins.txt synteny_results/${genus}/${genus}_formatted_movedProteins.csv
-
-#uses poisson distribution to determine probability of category counts occuring
-echo "Running Poisson approximations..."
-Rscript getPoissonValues.r synteny_results/${genus}/${genus}_formatted_movedProteins.csv synteny_results/${genus}/${genus}_poisson.csv synteny_results/${genus}/${genus}_Summary_Table.csv
-
-
+#gathers the results of the genus, formats the KEGG results and runs the Poisson approximations
+./genus_metrics.sh $genus merge $pairs_done $pairs_total $start_time
+./merge_genus.sh $genus $keg1 $format_memory
+./genus_metrics.sh $genus done $pairs_done $pairs_total $start_time
@@ -12,13 +12,14 @@
 #		 
 #		 This script runs all the programs necessary for a single pairwise comparison
 #		 between two fasta files. It makes blast databases for both fasta files,
-#		 runs blastp in both directions, runs 'CompareOrthologs' to get the synteny results,
-#		 Makes a synteny map from these results, and runs 'getKegResults' with the synteny results
+#		 runs blastp in both directions, runs 'CompareOrthologs' to get the synteny results
+#		 and synteny maps, and runs 'getKegResults' with the synteny results
 #		 to classify the proteins by function
 #	
 #
 #Arguments: (1)Subject .fasta (protein), (2)Query .fasta (protein), (3)subject genbank
 #			(4) subject .brkeg
+#Environment: SYNTENY_BIN directory of the compiled programs and runBlastp.sh (default: current directory)
 ###########################################################################################
 
 
@@ -30,6 +31,7 @@ keg=$4
 db_path="databases/"
 results_path="blast_results/"
 synteny_path="synteny_results/"
+bin=${SYNTENY_BIN:-.}
 
 
 seq1Name=${sequence1%.*} #removes file extension
@@ -73,13 +75,13 @@ blast_results_1=${blast_results_dir}"/subject_"${seq2Name}"_query_"${seq1Name}".
 blast_results_2=${blast_results_dir}"/subject_"${seq1Name}"_query_"${seq2Name}".txt"
 
 
-if [ ! -d "$blast_results_dir" ]; then
+if [ ! -s "$blast_results_1" ] || [ ! -s "$blast_results_2" ]; then
 	echo "Running blastp....."
-	mkdir $blast_results_dir
-	#runs blast both directions
-	./runBlastp.sh $sequence1 $db_2 $blast_results_1 &
+	mkdir -p $blast_results_dir
+	#runs blast both directions (directions already blasted for any pair are loaded from blast_cache/)
+	${bin}/runBlastp.sh $sequence1 $db_2 $blast_results_1 $sequence2 &
 	P1=$!
-	./runBlastp.sh $sequence2 $db_1 $blast_results_2 &
+	${bin}/runBlastp.sh $sequence2 $db_1 $blast_results_2 $sequence1 &
 	P2=$!
 	wait $P1 $P2
 else
@@ -92,24 +94,22 @@ mkdir ${synteny_dir}
 
 echo "Finding Moved Proteins..."
 #compares ortholog positions and finds proteins that moved
-./CompareOrthologs\
+#-plot makes the synteny charts both directions (_syntenyMap.svg) without starting R
+#(makeSyntenyPlot.r can still be run on the results for .pdf charts)
+${bin}/CompareOrthologs\
  $sequence1\
  $sequence2\
  $blast_results_1\
  $blast_results_2\
  ${synteny_dir}"/subject_"${seq2Name}"_query_"${seq1Name}"_MovementResults.csv"\
- ${synteny_dir}"/subject_"${seq1Name}"_query_"${seq2Name}"_MovementResults.csv"
- 
-#makes the synteny charts both directions
-echo "Making Synteny Plots..."
-Rscript makeSyntenyPlot.r ${synteny_dir}"/" "subject_"${seq2Name}"_query_"${seq1Name}"_MovementResults.csv" "subject_"${seq2Name}"_query_"${seq1Name}"_syntenyMap.pdf"
-Rscript makeSyntenyPlot.r ${synteny_dir}"/" "subject_"${seq1Name}"_query_"${seq2Name}"_MovementResults.csv" "subject_"${seq1Name}"_query_"${seq2Name}"_syntenyMap.pdf"
+ ${synteny_dir}"/subject_"${seq1Name}"_query_"${seq2Name}"_MovementResults.csv"\
+ -plot
 
 #call program that parses genbank and .keg, and converts CompareOrtholog results to keg categories
 
 echo "Assigning KEGG classifications..."
 echo " "
-./getKegResults\
+${bin}/getKegResults\
  $genbank\
  $keg\
  ${synteny_dir}"/subject_"${seq1Name}"_query_"${seq2Name}"_MovementResults.csv"\